@@ -20,6 +20,10 @@ outputs audio and messages. */
 #endif
 
 #include "binarymsg.c"
+#include "pdshm.c"
+#ifdef PD_TILDE_SHM
+#include <sys/stat.h>
+#endif
 
 #if defined(__linux__) || defined(__FreeBSD__) || defined(__FreeBSD_kernel__)\
      || defined(__GNU__)
@@ -81,6 +85,142 @@ static int readbinmessage(t_binbuf *b)
     }
 }
 
+    /* send a message to a receiver named by its first atom */
+static void pd_extern_dispatch(int n, t_atom *ap)
+{
+    if (n > 1 && ap[0].a_type == A_SYMBOL)
+    {
+        t_pd *whom = ap[0].a_w.w_symbol->s_thing;
+        if (!whom)
+            error("%s: no such object", ap[0].a_w.w_symbol->s_name);
+        else if (ap[1].a_type == A_SYMBOL)
+            typedmess(whom, ap[1].a_w.w_symbol, n-2, ap+2);
+        else pd_list(whom, 0, n-1, ap+1);
+    }
+}
+
+#ifdef PD_TILDE_SHM
+    /* shared memory transport (see pdshm.c).  The stdout object hands its
+    messages to whatever is bound to "#pd_shm_stdio", which puts them in
+    the ring back to pd~. */
+static t_pdshm *pdsched_shm;
+static t_class *pd_shmstdio_class;
+
+static void pd_shmstdio_anything(t_pd *dummy, t_symbol *s, int argc,
+    t_atom *argv)
+{
+    if (!pdshm_putmessage(&pdsched_shm->s_fromchild, s, argc, argv))
+        fprintf(stderr, "pd-extern: output buffer overflow\n");
+}
+
+static void pd_shmstdio_bang(t_pd *dummy)
+{
+    pd_shmstdio_anything(dummy, &s_bang, 0, 0);
+}
+
+static void pd_shmstdio_float(t_pd *dummy, t_float f)
+{
+    t_atom at;
+    SETFLOAT(&at, f);
+    pd_shmstdio_anything(dummy, &s_float, 1, &at);
+}
+
+static void pd_shmstdio_symbol(t_pd *dummy, t_symbol *s)
+{
+    t_atom at;
+    SETSYMBOL(&at, s);
+    pd_shmstdio_anything(dummy, &s_symbol, 1, &at);
+}
+
+static void pd_shmstdio_list(t_pd *dummy, t_symbol *s, int argc,
+    t_atom *argv)
+{
+    pd_shmstdio_anything(dummy, &s_list, argc, argv);
+}
+
+    /* dispatch the messages pd~ has sent, separated by semicolons */
+static void pd_extern_shmmessages(t_binbuf *b)
+{
+    t_atom *ap;
+    int n, i, start = 0;
+    binbuf_clear(b);
+    if (!pdshm_getmessages(&pdsched_shm->s_tochild, b))
+        return;
+    ap = binbuf_getvec(b);
+    n = binbuf_getnatom(b);
+    for (i = 0; i < n; i++)
+        if (ap[i].a_type == A_SEMI)
+    {
+        pd_extern_dispatch(i - start, ap + start);
+        start = i + 1;
+    }
+}
+
+static int pd_extern_shmsched(int fd, int chin, int chout, t_binbuf *b)
+{
+    struct stat statbuf;
+    t_pdshm *s;
+    pid_t parent = getppid();
+    int i;
+    if (fstat(fd, &statbuf) < 0 || statbuf.st_size < (off_t)sizeof(t_pdshm) ||
+        (s = (t_pdshm *)mmap(0, statbuf.st_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        perror("pd-extern: shared memory");
+        return (1);
+    }
+    close(fd);
+    if (s->s_magic != PDSHM_MAGIC || s->s_ninsig != chin ||
+        s->s_noutsig != chout || s->s_nslot < 1 || statbuf.st_size <
+            (off_t)pdshm_size(s->s_ninsig, s->s_noutsig, s->s_nslot))
+    {
+        fprintf(stderr, "pd-extern: shared memory doesn't match\n");
+        return (1);
+    }
+    pdsched_shm = s;
+    pd_shmstdio_class = class_new(gensym("pd~"), 0, 0, sizeof(t_pd),
+        CLASS_PD, 0);
+    class_addbang(pd_shmstdio_class, pd_shmstdio_bang);
+    class_addfloat(pd_shmstdio_class, pd_shmstdio_float);
+    class_addsymbol(pd_shmstdio_class, pd_shmstdio_symbol);
+    class_addlist(pd_shmstdio_class, pd_shmstdio_list);
+    class_addanything(pd_shmstdio_class, pd_shmstdio_anything);
+    pd_bind(&pd_shmstdio_class, gensym("#pd_shm_stdio"));
+        /* nobody reads our stdout now; send anything printed there on to
+        stderr so we can't block on a full pipe */
+    dup2(2, 1);
+    s->s_attached = 1;
+    while (!s->s_closed && getppid() == parent)
+    {
+        uint32_t block = s->s_done;
+        int ready = pdshm_wait(&s->s_sent, block + 1, &s->s_sentwait);
+        float *fp;
+        t_sample *sp;
+        pd_extern_shmmessages(b);
+        if (!ready)
+            continue;
+        for (i = chin * DEFDACBLKSIZE, fp = pdshm_slot(s, block),
+            sp = sys_soundin; i--; )
+                *sp++ = *fp++;
+        sched_tick();
+        sys_pollgui();
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__FreeBSD_kernel__)\
+     || defined(__GNU__)
+        pollwatchdog();
+#endif
+        for (i = chout * DEFDACBLKSIZE, sp = sys_soundout; i--; sp++)
+        {
+            *fp++ = *sp;
+            *sp = 0;
+        }
+        __sync_synchronize();
+        s->s_done = block + 1;
+        pdshm_wake(&s->s_done, &s->s_donewait);
+    }
+    return (0);
+}
+#endif /* PD_TILDE_SHM */
+
 int pd_extern_sched(char *flags)
 {
     int naudioindev, audioindev[MAXAUDIOINDEV], chindev[MAXAUDIOINDEV];
@@ -95,6 +235,16 @@ int pd_extern_sched(char *flags)
 
     chin = (naudioindev < 1 ? 0 : chindev[0]);
     chout = (naudiooutdev < 1 ? 0 : choutdev[0]);
+#ifdef PD_TILDE_SHM
+    if (flags && flags[0] == 's')
+    {
+        sys_setchsr(chin, chout, rate);
+        sys_audioapi = API_NONE;
+        i = pd_extern_shmsched(atoi(flags+1), chin, chout, b);
+        binbuf_free(b);
+        return (i);
+    }
+#endif
     if (!flags || flags[0] != 'a')
     {
             /* signal to stdout object to do binary by attaching an object
@@ -155,15 +305,7 @@ int pd_extern_sched(char *flags)
             else putchar(A_SEMI);
             fflush(stdout);
         }
-        else if (n > 1 && ap[0].a_type == A_SYMBOL)
-        {
-            t_pd *whom = ap[0].a_w.w_symbol->s_thing;
-            if (!whom)
-                error("%s: no such object", ap[0].a_w.w_symbol->s_name);
-            else if (ap[1].a_type == A_SYMBOL)
-                typedmess(whom, ap[1].a_w.w_symbol, n-2, ap+2);
-            else pd_list(whom, 0, n-1, ap+1);
-        }
+        else pd_extern_dispatch(n, ap);
     }
     binbuf_free(b);
     return (0);
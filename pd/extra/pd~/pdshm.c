@@ -0,0 +1,203 @@
+/* Shared-memory transport between pd~ and its subprocess (pdsched.c),
+used instead of the stdio pipes when pd~ is given the "-shm" flag.
+
+The parent creates an anonymous shared file (memfd), which the child
+inherits; its number is passed in -extraflags as "s<fd>".  The file holds
+a header, two byte rings carrying messages in the binarymsg.c format, and
+a ring of audio slots, each with room for one block of input and output
+as 32-bit floats.  The parent hands block k to the child by filling slot
+k % s_nslot and advancing s_sent; the child runs a tick, puts the output
+in the same slot, and advances s_done.  With a fifo of n blocks there are
+n+1 slots, and the parent picks up the output of block k-n, so that with
+"-fifo 1" parent and child run in parallel with a round trip of one block.
+Either side sleeps on the other's counter with a futex, but only after
+spinning briefly, and only wakes the other if it's known to be waiting. */
+
+#if defined(__linux__)
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#if defined(SYS_memfd_create) && defined(SYS_futex)
+#define PD_TILDE_SHM
+#endif
+#endif
+
+#ifdef PD_TILDE_SHM
+
+#define PDSHM_MAGIC 0x70647e31      /* "pd~1" */
+#define PDSHM_MSGSIZE 65536         /* each message ring, a power of two */
+#define PDSHM_SPIN 2000             /* polls before sleeping */
+
+typedef struct _pdshmring
+{
+    volatile uint32_t r_head;       /* bytes written, advanced by writer */
+    volatile uint32_t r_tail;       /* bytes read, advanced by reader */
+    unsigned char r_buf[PDSHM_MSGSIZE];
+} t_pdshmring;
+
+typedef struct _pdshm
+{
+    uint32_t s_magic;
+    int s_ninsig;
+    int s_noutsig;
+    int s_nslot;
+    volatile uint32_t s_sent;       /* blocks handed to the child */
+    volatile uint32_t s_done;       /* blocks the child has finished */
+    volatile int s_sentwait;        /* child is sleeping on s_sent */
+    volatile int s_donewait;        /* parent is sleeping on s_done */
+    volatile int s_attached;        /* child is up and running */
+    volatile int s_closed;          /* parent is going away */
+    t_pdshmring s_tochild;
+    t_pdshmring s_fromchild;
+} t_pdshm;
+
+static size_t pdshm_size(int ninsig, int noutsig, int nslot)
+{
+    return (sizeof(t_pdshm) +
+        (size_t)nslot * (ninsig + noutsig) * DEFDACBLKSIZE * sizeof(float));
+}
+
+    /* the input of a slot; the output follows it */
+static float *pdshm_slot(t_pdshm *s, uint32_t block)
+{
+    return ((float *)(s + 1) + (size_t)(block % s->s_nslot) *
+        (s->s_ninsig + s->s_noutsig) * DEFDACBLKSIZE);
+}
+
+    /* wait until *p has reached "want", or a tenth of a second has passed,
+    so the caller can check that the other side is still there.  "waiting"
+    tells the other side to wake us; it's raised before *p is looked at
+    the last time so no wakeup can get lost. */
+static int pdshm_wait(volatile uint32_t *p, uint32_t want,
+    volatile int *waiting)
+{
+    uint32_t v;
+    int i;
+    struct timespec ts;
+    for (i = 0; i < PDSHM_SPIN; i++)
+        if ((int32_t)(*p - want) >= 0)
+            return (1);
+    *waiting = 1;
+    __sync_synchronize();
+    if ((int32_t)((v = *p) - want) < 0)
+    {
+        ts.tv_sec = 0;
+        ts.tv_nsec = 100000000;
+        syscall(SYS_futex, p, FUTEX_WAIT, v, &ts, 0, 0);
+    }
+    *waiting = 0;
+    __sync_synchronize();
+    return ((int32_t)(*p - want) >= 0);
+}
+
+static void pdshm_wake(volatile uint32_t *p, volatile int *waiting)
+{
+    __sync_synchronize();
+    if (*waiting)
+        syscall(SYS_futex, p, FUTEX_WAKE, 1, 0, 0, 0);
+}
+
+    /* messages.  A whole message is written or none of it, so the reader
+    never sees a partial one. */
+static int pdshm_msgsize(t_symbol *s, int argc, t_atom *argv)
+{
+    int size = (s ? 2 + strlen(s->s_name) : 0) + 1;
+    for (; argc--; argv++)
+        if (argv->a_type == A_FLOAT)
+            size += 1 + sizeof(float);
+        else if (argv->a_type == A_SYMBOL)
+            size += 2 + strlen(argv->a_w.w_symbol->s_name);
+    return (size);
+}
+
+static void pdshm_putbytes(t_pdshmring *r, uint32_t *head, const void *vp,
+    int n)
+{
+    const unsigned char *bp = (const unsigned char *)vp;
+    while (n--)
+        r->r_buf[(*head)++ & (PDSHM_MSGSIZE-1)] = *bp++;
+}
+
+static void pdshm_putsym(t_pdshmring *r, uint32_t *head, t_symbol *s)
+{
+    unsigned char type = A_SYMBOL;
+    pdshm_putbytes(r, head, &type, 1);
+    pdshm_putbytes(r, head, s->s_name, strlen(s->s_name) + 1);
+}
+
+    /* write a message ("s" may be null for a list); returns 0 if full */
+static int pdshm_putmessage(t_pdshmring *r, t_symbol *s, int argc,
+    t_atom *argv)
+{
+    uint32_t head = r->r_head;
+    unsigned char type;
+    if (pdshm_msgsize(s, argc, argv) >
+        PDSHM_MSGSIZE - (int)(head - r->r_tail))
+            return (0);
+    if (s)
+        pdshm_putsym(r, &head, s);
+    for (; argc--; argv++)
+    {
+        if (argv->a_type == A_FLOAT)
+        {
+            float f = argv->a_w.w_float;
+            type = A_FLOAT;
+            pdshm_putbytes(r, &head, &type, 1);
+            pdshm_putbytes(r, &head, &f, sizeof(f));
+        }
+        else if (argv->a_type == A_SYMBOL)
+            pdshm_putsym(r, &head, argv->a_w.w_symbol);
+    }
+    type = A_SEMI;
+    pdshm_putbytes(r, &head, &type, 1);
+    __sync_synchronize();
+    r->r_head = head;
+    return (1);
+}
+
+    /* read all complete messages into a binbuf, each ending with a
+    semicolon; returns the number read */
+static int pdshm_getmessages(t_pdshmring *r, t_binbuf *b)
+{
+    uint32_t head = r->r_head, tail = r->r_tail;
+    char sbuf[MAXPDSTRING];
+    int n = 0;
+    t_atom at;
+    __sync_synchronize();
+    while (tail != head)
+    {
+        int type = r->r_buf[tail++ & (PDSHM_MSGSIZE-1)], i;
+        if (type == A_SEMI)
+        {
+            SETSEMI(&at);
+            n++;
+        }
+        else if (type == A_FLOAT)
+        {
+            float f;
+            unsigned char *fp = (unsigned char *)&f;
+            for (i = 0; i < (int)sizeof(f); i++)
+                fp[i] = r->r_buf[tail++ & (PDSHM_MSGSIZE-1)];
+            SETFLOAT(&at, f);
+        }
+        else
+        {
+            for (i = 0; (sbuf[i < MAXPDSTRING-1 ? i : MAXPDSTRING-1] =
+                r->r_buf[tail++ & (PDSHM_MSGSIZE-1)]); i++)
+                    ;
+            sbuf[MAXPDSTRING-1] = 0;
+            SETSYMBOL(&at, gensym(sbuf));
+        }
+        binbuf_add(b, 1, &at);
+    }
+    __sync_synchronize();
+    r->r_tail = tail;
+    return (n);
+}
+
+#endif /* PD_TILDE_SHM */
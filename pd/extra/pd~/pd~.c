@@ -78,6 +78,9 @@ static char pd_tilde_dllextent[] = ".m_i386", pd_tilde_dllextent2[] = ".dll";
 
 #define FOOFOO
 #include "binarymsg.c"
+#ifdef PD
+#include "pdshm.c"
+#endif
 
 /* ------------------------ pd_tilde~ ----------------------------- */
 
@@ -104,6 +107,12 @@ typedef struct _pd_tilde
     int x_noutsig;
     int x_fifo;
     int x_binary;
+    int x_useshm;               /* "-shm" flag: use shared memory */
+#ifdef PD_TILDE_SHM
+    t_pdshm *x_shm;             /* shared memory while running with -shm */
+    size_t x_shmsize;
+    int x_shmwarm;              /* blocks sent while filling the fifo */
+#endif
     t_float x_sr;
     t_symbol *x_pddir;
     t_symbol *x_schedlibdir;
@@ -129,6 +138,16 @@ static void pd_tilde_close(t_pd_tilde *x)
 {
 #ifdef _WIN32
     int termstat;
+#endif
+#ifdef PD_TILDE_SHM
+    if (x->x_shm)
+    {
+        x->x_shm->s_closed = 1;
+        __sync_synchronize();
+        syscall(SYS_futex, &x->x_shm->s_sent, FUTEX_WAKE, 1, 0, 0, 0);
+        munmap(x->x_shm, x->x_shmsize);
+        x->x_shm = 0;
+    }
 #endif
     if (x->x_outfd)
         fclose(x->x_outfd);
@@ -195,6 +214,56 @@ static void pd_tilde_readmessages(t_pd_tilde *x)
     clock_delay(x->x_clock, 0);
 }
 
+#ifdef PD_TILDE_SHM
+    /* make the shared memory the child will inherit; returns its fd */
+static int pd_tilde_shmopen(t_pd_tilde *x, int ninsig, int noutsig,
+    int fifo)
+{
+    int fd;
+    size_t size = pdshm_size(ninsig, noutsig, fifo + 1);
+    void *mem;
+    if ((fd = syscall(SYS_memfd_create, "pd~", 0)) < 0)
+    {
+        PDERROR "pd~: can't create shared memory: %s", strerror(errno));
+        return (-1);
+    }
+    if (ftruncate(fd, size) < 0 || (mem = mmap(0, size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        PDERROR "pd~: can't map shared memory: %s", strerror(errno));
+        close(fd);
+        return (-1);
+    }
+    x->x_shm = (t_pdshm *)mem;
+    x->x_shmsize = size;
+    x->x_shmwarm = 0;
+    x->x_shm->s_ninsig = ninsig;
+    x->x_shm->s_noutsig = noutsig;
+    x->x_shm->s_nslot = fifo + 1;
+    x->x_shm->s_magic = PDSHM_MAGIC;
+    return (fd);
+}
+
+    /* check that the child hasn't exited, reaping it if it has */
+static int pd_tilde_shmalive(t_pd_tilde *x)
+{
+    if (x->x_childpid <= 0)
+        return (0);
+    if (waitpid(x->x_childpid, 0, WNOHANG) == x->x_childpid)
+    {
+        x->x_childpid = -1;
+        return (0);
+    }
+    return (1);
+}
+
+static void pd_tilde_shmreadmessages(t_pd_tilde *x)
+{
+    if (pdshm_getmessages(&x->x_shm->s_fromchild, x->x_binbuf))
+        clock_delay(x->x_clock, 0);
+}
+#endif /* PD_TILDE_SHM */
+
 #define FIXEDARG 14
 #define MAXARG 100
 #ifdef _WIN32
@@ -212,6 +281,10 @@ static void pd_tilde_donew(t_pd_tilde *x, char *pddir, char *schedlibdir,
     char *execargv[FIXEDARG+MAXARG+1], ninsigstr[20], noutsigstr[20],
         sampleratestr[40];
     struct stat statbuf;
+#ifdef PD_TILDE_SHM
+    char flagstr[20];
+    int shmfd = -1;
+#endif
     x->x_infd = x->x_outfd = 0;
     x->x_childpid = -1;
     if (argc > MAXARG)
@@ -286,6 +359,16 @@ static void pd_tilde_donew(t_pd_tilde *x, char *pddir, char *schedlibdir,
 #endif
     execargv[4] = "-extraflags";
     execargv[5] = (x->x_binary ? "b" : "a");
+#ifdef PD_TILDE_SHM
+        /* in shared memory mode the flag names the inherited file */
+    if (x->x_useshm)
+    {
+        if ((shmfd = pd_tilde_shmopen(x, ninsig, noutsig, fifo)) < 0)
+            goto fail1;
+        sprintf(flagstr, "s%d", shmfd);
+        execargv[5] = flagstr;
+    }
+#endif
     execargv[6] = "-path";
 #ifdef _WIN32
     char quoted_patchdir[MAXPDSTRING];
@@ -412,6 +495,26 @@ static void pd_tilde_donew(t_pd_tilde *x, char *pddir, char *schedlibdir,
     x->x_outfd = fdopen(pipe1[1], "w");
     x->x_infd = fdopen(pipe2[0], "r");
     x->x_childpid = pid;
+#ifdef PD_TILDE_SHM
+    if (x->x_shm)
+    {
+            /* wait for the child to load its patch and attach */
+        close(shmfd);
+        while (!x->x_shm->s_attached)
+        {
+            if (!pd_tilde_shmalive(x))
+            {
+                PDERROR "pd~: subprocess exited");
+                pd_tilde_close(x);
+                return;
+            }
+            usleep(1000);
+        }
+        binbuf_clear(x->x_binbuf);
+        pd_tilde_shmreadmessages(x);
+        return;
+    }
+#endif
     for (i = 0; i < fifo; i++)
         if (x->x_binary)
     {
@@ -436,17 +539,85 @@ fail2:
     close(pipe1[0]);
     close(pipe1[1]);
 fail1:
+#ifdef PD_TILDE_SHM
+    if (x->x_shm)
+    {
+        munmap(x->x_shm, x->x_shmsize);
+        x->x_shm = 0;
+        close(shmfd);
+    }
+#endif
     x->x_infd = x->x_outfd = 0;
     x->x_childpid = -1;
     return;
 }
 
+#ifdef PD_TILDE_SHM
+    /* hand this block to the child and pick up the one from "fifo" blocks
+    ago, which the child has usually finished while we were computing. */
+static t_int *pd_tilde_shmperform(t_int *w)
+{
+    t_pd_tilde *x = (t_pd_tilde *)(w[1]);
+    int n = (int)(w[2]), i, j;
+    t_pdshm *s = x->x_shm;
+    uint32_t block = s->s_sent;
+    float *fp = pdshm_slot(s, block);
+    if (n > DEFDACBLKSIZE)
+        n = DEFDACBLKSIZE;
+    for (i = 0; i < x->x_ninsig; i++)
+    {
+        t_sample *sp = x->x_insig[i];
+        for (j = 0; j < n; j++)
+            fp[j] = sp[j];
+        for (; j < DEFDACBLKSIZE; j++)
+            fp[j] = 0;
+        fp += DEFDACBLKSIZE;
+    }
+    __sync_synchronize();
+    s->s_sent = block + 1;
+    pdshm_wake(&s->s_sent, &s->s_sentwait);
+    if (x->x_shmwarm < x->x_fifo)
+    {
+        x->x_shmwarm++;
+        goto zeroit;
+    }
+    block -= x->x_fifo;
+    while (!pdshm_wait(&s->s_done, block + 1, &s->s_donewait))
+    {
+        if (!pd_tilde_shmalive(x))
+        {
+            PDERROR "pd~: subprocess exited");
+            pd_tilde_close(x);
+            goto zeroit;
+        }
+    }
+    fp = pdshm_slot(s, block) + x->x_ninsig * DEFDACBLKSIZE;
+    for (i = 0; i < x->x_noutsig; i++, fp += DEFDACBLKSIZE)
+    {
+        t_sample *sp = x->x_outsig[i];
+        for (j = 0; j < n; j++)
+            sp[j] = fp[j];
+    }
+    pd_tilde_shmreadmessages(x);
+    return (w+3);
+zeroit:
+    for (i = 0; i < x->x_noutsig; i++)
+        for (j = 0; j < n; j++)
+            x->x_outsig[i][j] = 0;
+    return (w+3);
+}
+#endif /* PD_TILDE_SHM */
+
 static t_int *pd_tilde_perform(t_int *w)
 {
     t_pd_tilde *x = (t_pd_tilde *)(w[1]);
     int n = (int)(w[2]), i, j, nsigs, numbuffill = 0, c;
     char numbuf[80];
     FILE *infd = x->x_infd;
+#ifdef PD_TILDE_SHM
+    if (x->x_shm)
+        return (pd_tilde_shmperform(w));
+#endif
     if (!infd)
         goto zeroit;
     if (x->x_binary)
@@ -681,6 +852,16 @@ static void pd_tilde_anything(t_pd_tilde *x, t_symbol *s,
     char msgbuf[MAXPDSTRING];
     if (!x->x_outfd)
         return;
+#ifdef PD_TILDE_SHM
+    if (x->x_shm)
+    {
+        if (!pdshm_putmessage(&x->x_shm->s_tochild, s, argc, argv))
+            pd_error(x, "pd~: message buffer full");
+            /* the child picks it up on its next block, or now if idle */
+        else pdshm_wake(&x->x_shm->s_sent, &x->x_shm->s_sentwait);
+        return;
+    }
+#endif
     if (x->x_binary)
     {
         pd_tilde_putsymbol(s, x->x_outfd);
@@ -709,7 +890,7 @@ extern char *class_gethelpdir(t_class *c);
 static void *pd_tilde_new(t_symbol *s, int argc, t_atom *argv)
 {
     t_pd_tilde *x = (t_pd_tilde *)pd_new(pd_tilde_class);
-    int ninsig = 2, noutsig = 2, j, fifo = 5, binary = 1;
+    int ninsig = 2, noutsig = 2, j, fifo = -1, binary = 1, useshm = 0;
     t_float sr = sys_getsr();
     t_sample **g;
     t_symbol *pddir = sys_libdir,
@@ -753,15 +934,27 @@ static void *pd_tilde_new(t_symbol *s, int argc, t_atom *argv)
             binary = 0;
             argc--; argv++;
         }
+        else if (!strcmp(firstarg->s_name, "-shm"))
+        {
+#ifdef PD_TILDE_SHM
+            useshm = 1;
+#else
+            pd_error(x, "pd~: -shm not supported on this platform");
+#endif
+            argc--; argv++;
+        }
         else break;
     }
+        /* shared memory needs no slack for scheduling; pipes do */
+    if (fifo < 0)
+        fifo = (useshm ? 1 : 5);
 
     if (argc)
     {
         pd_error(x,
 "usage: pd~ [-sr #] [-ninsig #] [-noutsig #] [-fifo #] [-pddir <>]");
         post(
-"... [-scheddir <>]");
+"... [-scheddir <>] [-ascii] [-shm]");
     }
 
     x->x_clock = clock_new(x, (t_method)pd_tilde_tick);
@@ -780,6 +973,10 @@ static void *pd_tilde_new(t_symbol *s, int argc, t_atom *argv)
     x->x_canvas = canvas_getcurrent();
     x->x_binbuf = binbuf_new();
     x->x_binary = binary;
+    x->x_useshm = useshm;
+#ifdef PD_TILDE_SHM
+    x->x_shm = 0;
+#endif
     for (j = 1, g = x->x_insig; j < ninsig; j++, g++)
         inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
     x->x_outlet1 = outlet_new(&x->x_obj, 0);
@@ -1307,10 +1307,10 @@ static void sigmund_list(t_sigmund *x, t_symbol *s, int argc, t_atom *argv)
     int onset = atom_getintarg(2, argc, argv);
     t_float srate = atom_getfloatarg(3, argc, argv);
     int loud = atom_getfloatarg(4, argc, argv);
-    int arraysize, totstorage, nfound, i;
+    int arraysize, arraystride, totstorage, nfound, i;
     t_garray *a;
     t_float *arraypoints, pit;
-    t_word *wordarray = 0;
+    t_float *floatarray = 0;
     if (argc < 5)
     {
         post(
@@ -1329,7 +1329,7 @@ static void sigmund_list(t_sigmund *x, t_symbol *s, int argc, t_atom *argv)
     }
     arraypoints = alloca(sizeof(t_float)*npts);
     if (!(a = (t_garray *)pd_findbyclass(syminput, garray_class)) ||
-        !garray_getfloatwords(a, &arraysize, &wordarray) ||
+        !garray_getfloatvec(a, &arraysize, &floatarray, &arraystride) ||
             arraysize < onset + npts)
     {
         error("%s: array missing or too small", syminput->s_name);
@@ -1341,7 +1341,7 @@ static void sigmund_list(t_sigmund *x, t_symbol *s, int argc, t_atom *argv)
         return;
     }
     for (i = 0; i < npts; i++)
-        arraypoints[i] = wordarray[i+onset].w_float;
+        arraypoints[i] = floatarray[(i+onset) * arraystride];
     sigmund_doit(x, npts, arraypoints, loud, srate);
 }
 
@@ -62,8 +62,9 @@ static void *stdout_new(t_symbol*s, int argc, t_atom*argv)
                 /* unknown mode; ignore it */
         }
     }
-    if (gensym("#pd_binary_stdio")->s_thing)
-        x->x_mode = MODE_PDTILDE;
+    if (gensym("#pd_binary_stdio")->s_thing ||
+        gensym("#pd_shm_stdio")->s_thing)
+            x->x_mode = MODE_PDTILDE;
     return (x);
 }
 
@@ -114,6 +115,13 @@ static void stdout_anything(t_stdout *x, t_symbol *s, int argc, t_atom *argv)
     }
     else if (x->x_mode == MODE_PDTILDE)
     {
+        t_pd *shm = gensym("#pd_shm_stdio")->s_thing;
+            /* pd~ -shm: the scheduler takes the message */
+        if (shm)
+        {
+            pd_typedmess(shm, s, argc, argv);
+            return;
+        }
         pd_tilde_putsymbol(s, stdout);
         for (; argc--; argv++)
         {
@@ -9,6 +9,7 @@
 #include "m_pd.h"
 
 #define GOODINT(i) (!(i & 0xC0000000)) // used for integer overflow protection
+#define TABREAD4_CHUNK 64   /* points interpolated at once by tabread4~ etc. */
 
 /* ------------------------- tabwrite~ -------------------------- */
 
@@ -19,7 +20,8 @@ typedef struct _tabwrite_tilde
     t_object x_obj;
     int x_phase;
     int x_nsampsintab;
-    t_word *x_vec;
+    t_float *x_vec;
+    int x_stride;
     t_symbol *x_arrayname;
     t_float x_f;
 } t_tabwrite_tilde;
@@ -50,8 +52,8 @@ static t_int *tabwrite_tilde_perform(t_int *w)
     
     if (endphase > phase)
     {
-        int nxfer = endphase - phase;
-        t_word *wp = x->x_vec + phase;
+        int nxfer = endphase - phase, stride = x->x_stride;
+        t_float *fp = x->x_vec + phase * stride;
         if (nxfer > n) nxfer = n;
         phase += nxfer;
         while (nxfer--)
@@ -59,7 +61,8 @@ static t_int *tabwrite_tilde_perform(t_int *w)
             t_sample f = *in++;
             if (PD_BIGORSMALL(f))
                 f = 0;
-            (wp++)->w_float = f;
+            *fp = f;
+            fp += stride;
         }
         if (phase >= endphase)
         {
@@ -84,7 +87,8 @@ void tabwrite_tilde_set(t_tabwrite_tilde *x, t_symbol *s)
             x->x_arrayname->s_name);
         x->x_vec = 0;
     }
-    else if (!garray_getfloatwords(a, &x->x_nsampsintab, &x->x_vec))
+    else if (!garray_getfloatvec(a, &x->x_nsampsintab, &x->x_vec,
+        &x->x_stride))
     {
         pd_error(x, "%s: bad template for tabwrite~", x->x_arrayname->s_name);
         x->x_vec = 0;
@@ -145,7 +149,8 @@ typedef struct _tabplay_tilde
     int x_phase;
     int x_nsampsintab;
     int x_limit;
-    t_word *x_vec;
+    t_float *x_vec;
+    int x_stride;
     t_symbol *x_arrayname;
     t_clock *x_clock;
 } t_tabplay_tilde;
@@ -168,21 +173,21 @@ static t_int *tabplay_tilde_perform(t_int *w)
 {
     t_tabplay_tilde *x = (t_tabplay_tilde *)(w[1]);
     t_sample *out = (t_sample *)(w[2]);
-    t_word *wp;
-    int n = (int)(w[3]), phase = x->x_phase,
+    t_float *fp;
+    int n = (int)(w[3]), phase = x->x_phase, stride = x->x_stride,
         endphase = (x->x_nsampsintab < x->x_limit ?
             x->x_nsampsintab : x->x_limit), nxfer, n3;
     if (!x->x_vec || phase >= endphase)
         goto zero;
     
     nxfer = endphase - phase;
-    wp = x->x_vec + phase;
+    fp = x->x_vec + phase * stride;
     if (nxfer > n)
         nxfer = n;
     n3 = n - nxfer;
     phase += nxfer;
     while (nxfer--)
-        *out++ = (wp++)->w_float;
+        *out++ = *fp, fp += stride;
     if (phase >= endphase)
     {
         clock_delay(x->x_clock, 0);
@@ -209,7 +214,8 @@ void tabplay_tilde_set(t_tabplay_tilde *x, t_symbol *s)
             x->x_arrayname->s_name);
         x->x_vec = 0;
     }
-    else if (!garray_getfloatwords(a, &x->x_nsampsintab, &x->x_vec))
+    else if (!garray_getfloatvec(a, &x->x_nsampsintab, &x->x_vec,
+        &x->x_stride))
     {
         pd_error(x, "%s: bad template for tabplay~", x->x_arrayname->s_name);
         x->x_vec = 0;
@@ -273,7 +279,8 @@ typedef struct _tabread_tilde
 {
     t_object x_obj;
     int x_npoints;
-    t_word *x_vec;
+    t_float *x_vec;
+    int x_stride;
     t_symbol *x_arrayname;
     t_float x_f;
 } t_tabread_tilde;
@@ -294,8 +301,8 @@ static t_int *tabread_tilde_perform(t_int *w)
     t_sample *in = (t_sample *)(w[2]);
     t_sample *out = (t_sample *)(w[3]);
     int n = (int)(w[4]);    
-    int maxindex;
-    t_word *buf = x->x_vec;
+    int maxindex, stride = x->x_stride;
+    t_float *buf = x->x_vec;
     int i;
     
     maxindex = x->x_npoints - 1;
@@ -309,7 +316,7 @@ static t_int *tabread_tilde_perform(t_int *w)
             index = 0;
         else if (index > maxindex)
             index = maxindex;
-        *out++ = buf[index].w_float;
+        *out++ = buf[index * stride];
     }
     return (w+5);
  zero:
@@ -329,7 +336,7 @@ void tabread_tilde_set(t_tabread_tilde *x, t_symbol *s)
             pd_error(x, "tabread~: %s: no such array", x->x_arrayname->s_name);
         x->x_vec = 0;
     }
-    else if (!garray_getfloatwords(a, &x->x_npoints, &x->x_vec))
+    else if (!garray_getfloatvec(a, &x->x_npoints, &x->x_vec, &x->x_stride))
     {
         pd_error(x, "%s: bad template for tabread~", x->x_arrayname->s_name);
         x->x_vec = 0;
@@ -370,7 +377,8 @@ typedef struct _tabread4_tilde
 {
     t_object x_obj;
     int x_npoints;
-    t_word *x_vec;
+    t_float *x_vec;
+    int x_stride;
     t_symbol *x_arrayname;
     t_float x_f;
     t_float x_onset;
@@ -394,8 +402,8 @@ static t_int *tabread4_tilde_perform(t_int *w)
     t_sample *in = (t_sample *)(w[2]);
     t_sample *out = (t_sample *)(w[3]);
     int n = (int)(w[4]);    
-    int maxindex;
-    t_word *buf = x->x_vec, *wp;
+    int maxindex, stride = x->x_stride;
+    t_float *buf = x->x_vec, *fp;
     double onset = x->x_onset;
     int i;
     
@@ -420,27 +428,41 @@ static t_int *tabread4_tilde_perform(t_int *w)
     }
 #endif
 
-    for (i = 0; i < n; i++)
+        /* look up the four neighbours of a chunk of points first, then
+        interpolate the whole chunk in a second loop that has no table
+        accesses or branches, so that the compiler can vectorize it. */
+    for (i = 0; i < n; i += TABREAD4_CHUNK)
     {
-        double findex = *in++ + onset;
-        int index = findex;
-        t_sample frac,  a,  b,  c,  d, cminusb;
-        if (index < 1)
-            index = 1, frac = 0;
-        else if (index > maxindex)
-            index = maxindex, frac = 1;
-        else frac = findex - index;
-        wp = buf + index;
-        a = wp[-1].w_float;
-        b = wp[0].w_float;
-        c = wp[1].w_float;
-        d = wp[2].w_float;
-        cminusb = c-b;
-        *out++ = b + frac * (
-            cminusb - 0.1666667f * (1.-frac) * (
-                (d - a - 3.0f * cminusb) * frac + (d + 2.0f*a - 3.0f*b)
-            )
-        );
+        t_sample fr[TABREAD4_CHUNK], a[TABREAD4_CHUNK], b[TABREAD4_CHUNK],
+            c[TABREAD4_CHUNK], d[TABREAD4_CHUNK];
+        int j, m = (n - i < TABREAD4_CHUNK ? n - i : TABREAD4_CHUNK);
+        for (j = 0; j < m; j++)
+        {
+            double findex = in[j] + onset;
+            int index = findex;
+            if (index < 1)
+                index = 1, fr[j] = 0;
+            else if (index > maxindex)
+                index = maxindex, fr[j] = 1;
+            else fr[j] = findex - index;
+            fp = buf + index * stride;
+            a[j] = fp[-stride];
+            b[j] = fp[0];
+            c[j] = fp[stride];
+            d[j] = fp[2*stride];
+        }
+        for (j = 0; j < m; j++)
+        {
+            t_sample frac = fr[j], cminusb = c[j]-b[j];
+            out[j] = b[j] + frac * (
+                cminusb - 0.1666667f * (1.-frac) * (
+                    (d[j] - a[j] - 3.0f * cminusb) * frac +
+                        (d[j] + 2.0f*a[j] - 3.0f*b[j])
+                )
+            );
+        }
+        in += m;
+        out += m;
     }
     return (w+5);
  zero:
@@ -460,7 +482,7 @@ void tabread4_tilde_set(t_tabread4_tilde *x, t_symbol *s)
             pd_error(x, "tabread4~: %s: no such array", x->x_arrayname->s_name);
         x->x_vec = 0;
     }
-    else if (!garray_getfloatwords(a, &x->x_npoints, &x->x_vec))
+    else if (!garray_getfloatvec(a, &x->x_npoints, &x->x_vec, &x->x_stride))
     {
         pd_error(x, "%s: bad template for tabread4~", x->x_arrayname->s_name);
         x->x_vec = 0;
@@ -503,7 +525,8 @@ typedef struct _tabosc4_tilde
     int looplength;
     t_float oneoversamplerate;
     double tabphase;
-    t_word *array;
+    t_float *array;
+    int stride;
     t_symbol *arrayname;
     t_float x_f;
 } t_tabosc4_tilde;
@@ -531,27 +554,42 @@ static t_int *tabosc4_tilde_perform(t_int *w)
     int index = 0;
     t_float baseincrement = x->oneoversamplerate * (t_float)x->looplength;
     double tabphase = x->tabphase;
-    t_word *ptab = x->array;
-    t_float frac = 0.,  a,  b,  c,  d, cminusb;
+    t_float *ptab = x->array, *fp;
+    int stride = x->stride;
+    t_float frac = 0.;
     t_float endfreq = freq[vecsize-1];
+    int i;
 
     if (!ptab) goto zero;
 
-    while (vecsize--)
+        /* as in tabread4~, gather first and interpolate afterward */
+    for (i = 0; i < vecsize; i += TABREAD4_CHUNK)
     {
-        index = (tabphase >= 0.? (int)tabphase : (int)tabphase - 1);
-        frac = (GOODINT(index)? tabphase - index : 0.);
-        index &= loopmask;
-        tabphase += *freq++ * baseincrement;
-
-        // interpolation
-        a = ptab[index].w_float;
-        b = ptab[index+1].w_float;
-        c = ptab[index+2].w_float;
-        d = ptab[index+3].w_float;
-        cminusb = c-b;
-        *out++ = b + frac * (cminusb - 0.166666666666667 *
-            (1.-frac) * ((d - a - 3.0 * cminusb) * frac + (d + 2.0*a - 3.0*b)));
+        t_float fr[TABREAD4_CHUNK], a[TABREAD4_CHUNK], b[TABREAD4_CHUNK],
+            c[TABREAD4_CHUNK], d[TABREAD4_CHUNK];
+        int j, m = (vecsize - i < TABREAD4_CHUNK ?
+            vecsize - i : TABREAD4_CHUNK);
+        for (j = 0; j < m; j++)
+        {
+            index = (tabphase >= 0.? (int)tabphase : (int)tabphase - 1);
+            fr[j] = frac = (GOODINT(index)? tabphase - index : 0.);
+            index &= loopmask;
+            tabphase += freq[j] * baseincrement;
+            fp = ptab + index * stride;
+            a[j] = fp[0];
+            b[j] = fp[stride];
+            c[j] = fp[2*stride];
+            d[j] = fp[3*stride];
+        }
+        for (j = 0; j < m; j++)
+        {
+            t_float cminusb = c[j]-b[j];
+            out[j] = b[j] + fr[j] * (cminusb - 0.166666666666667 *
+                (1.-fr[j]) * ((d[j] - a[j] - 3.0 * cminusb) * fr[j] +
+                    (d[j] + 2.0*a[j] - 3.0*b[j])));
+        }
+        freq += m;
+        out += m;
     }
 
     x->tabphase = frac + index + (endfreq * baseincrement);     // wrap phase state
@@ -574,7 +612,7 @@ void tabosc4_tilde_set(t_tabosc4_tilde *x, t_symbol *s)
             pd_error(x, "tabosc4~: %s: no such array", x->arrayname->s_name);
         x->array = 0;
     }
-    else if (!garray_getfloatwords(a, &pointsinarray, &x->array))
+    else if (!garray_getfloatvec(a, &pointsinarray, &x->array, &x->stride))
     {
         pd_error(x, "%s: bad template for tabosc4~", x->arrayname->s_name);
         x->array = 0;
@@ -628,7 +666,8 @@ static t_class *tabsend_class;
 typedef struct _tabsend
 {
     t_object x_obj;
-    t_word *x_vec;
+    t_float *x_vec;
+    int x_stride;
     int x_graphperiod;
     int x_graphcount;
     t_symbol *x_arrayname;
@@ -649,8 +688,8 @@ static t_int *tabsend_perform(t_int *w)
     t_tabsend *x = (t_tabsend *)(w[1]);
     t_sample *in = (t_sample *)(w[2]);
     int n = w[3];
-    t_word *dest = x->x_vec;
-    int i = x->x_graphcount;
+    t_float *dest = x->x_vec;
+    int i = x->x_graphcount, stride = x->x_stride;
     if (!x->x_vec) goto bad;
 
     while (n--)
@@ -658,7 +697,8 @@ static t_int *tabsend_perform(t_int *w)
         t_sample f = *in++;
         if (PD_BIGORSMALL(f))
             f = 0;
-         (dest++)->w_float = f;
+        *dest = f;
+        dest += stride;
     }
     if (!i--)
     {
@@ -683,7 +723,7 @@ static void tabsend_dsp(t_tabsend *x, t_signal **sp)
         if (*x->x_arrayname->s_name)
             pd_error(x, "tabsend~: %s: no such array", x->x_arrayname->s_name);
     }
-    else if (!garray_getfloatwords(a, &vecsize, &x->x_vec))
+    else if (!garray_getfloatvec(a, &vecsize, &x->x_vec, &x->x_stride))
         pd_error(x, "%s: bad template for tabsend~", x->x_arrayname->s_name);
     else
     {
@@ -714,7 +754,8 @@ static t_class *tabreceive_class;
 typedef struct _tabreceive
 {
     t_object x_obj;
-    t_word *x_vec;
+    t_float *x_vec;
+    int x_stride;
     int x_vecsize;
     t_symbol *x_arrayname;
 } t_tabreceive;
@@ -724,12 +765,12 @@ static t_int *tabreceive_perform(t_int *w)
     t_tabreceive *x = (t_tabreceive *)(w[1]);
     t_sample *out = (t_sample *)(w[2]);
     int n = w[3];
-    t_word *from = x->x_vec;
+    t_float *from = x->x_vec;
     if (from)
     {
-        int vecsize = x->x_vecsize;
+        int vecsize = x->x_vecsize, stride = x->x_stride;
         while (vecsize--)
-            *out++ = (from++)->w_float;
+            *out++ = *from, from += stride;
         vecsize = n - x->x_vecsize;
         while (vecsize--)
             *out++ = 0;
@@ -746,7 +787,7 @@ static void tabreceive_dsp(t_tabreceive *x, t_signal **sp)
         if (*x->x_arrayname->s_name)
             pd_error(x, "tabsend~: %s: no such array", x->x_arrayname->s_name);
     }
-    else if (!garray_getfloatwords(a, &x->x_vecsize, &x->x_vec))
+    else if (!garray_getfloatvec(a, &x->x_vecsize, &x->x_vec, &x->x_stride))
         pd_error(x, "%s: bad template for tabreceive~", x->x_arrayname->s_name);
     else 
     {
@@ -787,19 +828,19 @@ typedef struct _tabread
 static void tabread_float(t_tabread *x, t_float f)
 {
     t_garray *a;
-    int npoints;
-    t_word *vec;
+    int npoints, stride;
+    t_float *vec;
 
     if (!(a = (t_garray *)pd_findbyclass(x->x_arrayname, garray_class)))
         pd_error(x, "%s: no such array", x->x_arrayname->s_name);
-    else if (!garray_getfloatwords(a, &npoints, &vec))
+    else if (!garray_getfloatvec(a, &npoints, &vec, &stride))
         pd_error(x, "%s: bad template for tabread", x->x_arrayname->s_name);
     else
     {
         int n = f;
         if (n < 0) n = 0;
         else if (n >= npoints) n = npoints - 1;
-        outlet_float(x->x_obj.ob_outlet, (npoints ? vec[n].w_float : 0));
+        outlet_float(x->x_obj.ob_outlet, (npoints ? vec[n * stride] : 0));
     }
 }
 
@@ -838,32 +879,32 @@ typedef struct _tabread4
 static void tabread4_float(t_tabread4 *x, t_float f)
 {
     t_garray *a;
-    int npoints;
-    t_word *vec;
+    int npoints, stride;
+    t_float *vec;
 
     if (!(a = (t_garray *)pd_findbyclass(x->x_arrayname, garray_class)))
         pd_error(x, "%s: no such array", x->x_arrayname->s_name);
-    else if (!garray_getfloatwords(a, &npoints, &vec))
+    else if (!garray_getfloatvec(a, &npoints, &vec, &stride))
         pd_error(x, "%s: bad template for tabread4", x->x_arrayname->s_name);
     else if (npoints < 4)
         outlet_float(x->x_obj.ob_outlet, 0);
     else if (f <= 1)
-        outlet_float(x->x_obj.ob_outlet, vec[1].w_float);
+        outlet_float(x->x_obj.ob_outlet, vec[stride]);
     else if (f >= npoints - 2)
-        outlet_float(x->x_obj.ob_outlet, vec[npoints - 2].w_float);
+        outlet_float(x->x_obj.ob_outlet, vec[(npoints - 2) * stride]);
     else
     {
         int n = f;
         float a, b, c, d, cminusb, frac;
-        t_word *wp;
+        t_float *fp;
         if (n >= npoints - 2)
             n = npoints - 3;
-        wp = vec + n;
+        fp = vec + n * stride;
         frac = f - n;
-        a = wp[-1].w_float;
-        b = wp[0].w_float;
-        c = wp[1].w_float;
-        d = wp[2].w_float;
+        a = fp[-stride];
+        b = fp[0];
+        c = fp[stride];
+        d = fp[2*stride];
         cminusb = c-b;
         outlet_float(x->x_obj.ob_outlet, b + frac * (
             cminusb - 0.1666667f * (1.-frac) * (
@@ -906,13 +947,13 @@ typedef struct _tabwrite
 
 static void tabwrite_float(t_tabwrite *x, t_float f)
 {
-    int vecsize;
+    int vecsize, stride;
     t_garray *a;
-    t_word *vec;
+    t_float *vec;
 
     if (!(a = (t_garray *)pd_findbyclass(x->x_arrayname, garray_class)))
         pd_error(x, "%s: no such array", x->x_arrayname->s_name);
-    else if (!garray_getfloatwords(a, &vecsize, &vec))
+    else if (!garray_getfloatvec(a, &vecsize, &vec, &stride))
         pd_error(x, "%s: bad template for tabwrite", x->x_arrayname->s_name);
     else
     {
@@ -921,7 +962,7 @@ static void tabwrite_float(t_tabwrite *x, t_float f)
             n = 0;
         else if (n >= vecsize)
             n = vecsize-1;
-        vec[n].w_float = f;
+        vec[n * stride] = f;
         garray_redraw(a);
     }
 }
@@ -7,6 +7,7 @@
 */
 
 #include "m_pd.h"
+#include "m_imp.h"
 #include "math.h"
 
 /* -------------------------- sig~ ------------------------------ */
@@ -290,7 +291,7 @@ static t_int *vline_tilde_perform(t_int *w)
                 x->x_target = s->s_target;
                 x->x_targettime = s->s_targettime;
                 x->x_list = s->s_next;
-                t_freebytes(s, sizeof(*s));
+                pool_freebytes(s, sizeof(*s));
                 s = x->x_list;
                 goto checknext;
             }
@@ -309,7 +310,7 @@ static void vline_tilde_stop(t_vline *x)
 {
     t_vseg *s1, *s2;
     for (s1 = x->x_list; s1; s1 = s2)
-        s2 = s1->s_next, t_freebytes(s1, sizeof(*s1));
+        s2 = s1->s_next, pool_freebytes(s1, sizeof(*s1));
     x->x_list = 0;
     x->x_inc = 0;
     x->x_inlet1 = x->x_inlet2 = 0;
@@ -334,7 +335,7 @@ static void vline_tilde_float(t_vline *x, t_float f)
         vline_tilde_stop(x);
         return;
     }
-    snew = (t_vseg *)t_getbytes(sizeof(*snew));
+    snew = (t_vseg *)pool_getbytes(sizeof(*snew));
         /* check if we supplant the first item in the list.  We supplant
         an item by having an earlier starttime, or an equal starttime unless
         the equal one was instantaneous and the new one isn't (in which case
@@ -366,7 +367,7 @@ static void vline_tilde_float(t_vline *x, t_float f)
     while (deletefrom)
     {
         s1 = deletefrom->s_next;
-        t_freebytes(deletefrom, sizeof(*deletefrom));
+        pool_freebytes(deletefrom, sizeof(*deletefrom));
         deletefrom = s1;
     }
     snew->s_next = 0;
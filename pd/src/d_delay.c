@@ -9,6 +9,7 @@
 extern int ugen_getsortno(void);
 
 #define DEFDELVS 64             /* LATER get this from canvas at DSP time */
+#define VD_CHUNK 64             /* points interpolated at once by vd~ */
 
 /* ----------------------------- delwrite~ ----------------------------- */
 static t_class *sigdelwrite_class;
@@ -269,29 +270,45 @@ static t_int *sigvd_perform(t_int *w)
     t_sample fn = n-1;
     t_sample *vp = ctl->c_vec, *bp, *wp = vp + ctl->c_phase;
     t_sample zerodel = x->x_zerodel;
-    while (n--)
+    t_float sr = x->x_sr;
+    int i;
+
+        /* find the four neighbours of a chunk of points, then interpolate
+        them in a separate loop that the compiler can vectorize. */
+    for (i = 0; i < n; i += VD_CHUNK)
     {
-        t_sample delsamps = x->x_sr * *in++ - zerodel, frac;
-        int idelsamps;
-        t_sample a, b, c, d, cminusb;
-        if (delsamps < 1.00001f) delsamps = 1.00001f;
-        if (delsamps > limit) delsamps = limit;
-        delsamps += fn;
-        fn = fn - 1.0f;
-        idelsamps = delsamps;
-        frac = delsamps - (t_sample)idelsamps;
-        bp = wp - idelsamps;
-        if (bp < vp + 4) bp += nsamps;
-        d = bp[-3];
-        c = bp[-2];
-        b = bp[-1];
-        a = bp[0];
-        cminusb = c-b;
-        *out++ = b + frac * (
-            cminusb - 0.1666667f * (1.-frac) * (
-                (d - a - 3.0f * cminusb) * frac + (d + 2.0f*a - 3.0f*b)
-            )
-        );
+        t_sample fr[VD_CHUNK], a[VD_CHUNK], b[VD_CHUNK], c[VD_CHUNK],
+            d[VD_CHUNK];
+        int j, m = (n - i < VD_CHUNK ? n - i : VD_CHUNK);
+        for (j = 0; j < m; j++)
+        {
+            t_sample delsamps = sr * in[j] - zerodel;
+            int idelsamps;
+            if (delsamps < 1.00001f) delsamps = 1.00001f;
+            if (delsamps > limit) delsamps = limit;
+            delsamps += fn;
+            fn = fn - 1.0f;
+            idelsamps = delsamps;
+            fr[j] = delsamps - (t_sample)idelsamps;
+            bp = wp - idelsamps;
+            if (bp < vp + 4) bp += nsamps;
+            d[j] = bp[-3];
+            c[j] = bp[-2];
+            b[j] = bp[-1];
+            a[j] = bp[0];
+        }
+        for (j = 0; j < m; j++)
+        {
+            t_sample frac = fr[j], cminusb = c[j]-b[j];
+            out[j] = b[j] + frac * (
+                cminusb - 0.1666667f * (1.-frac) * (
+                    (d[j] - a[j] - 3.0f * cminusb) * frac +
+                        (d[j] + 2.0f*a[j] - 3.0f*b[j])
+                )
+            );
+        }
+        in += m;
+        out += m;
     }
     return (w+6);
 }
@@ -28,6 +28,36 @@ static t_int *sigfft_swap(t_int *w)
     return (w+4);    
 }
 
+static t_int *sigfft_swap8(t_int *w)
+{
+    t_sample *in1 = (t_sample *)(w[1]);
+    t_sample *in2 = (t_sample *)(w[2]);
+    int n = w[3];
+    for (; n; n -= 8, in1 += 8, in2 += 8)
+    {
+        t_sample f0 = in1[0], f1 = in1[1], f2 = in1[2], f3 = in1[3];
+        t_sample f4 = in1[4], f5 = in1[5], f6 = in1[6], f7 = in1[7];
+
+        t_sample g0 = in2[0], g1 = in2[1], g2 = in2[2], g3 = in2[3];
+        t_sample g4 = in2[4], g5 = in2[5], g6 = in2[6], g7 = in2[7];
+
+        in1[0] = g0; in1[1] = g1; in1[2] = g2; in1[3] = g3;
+        in1[4] = g4; in1[5] = g5; in1[6] = g6; in1[7] = g7;
+
+        in2[0] = f0; in2[1] = f1; in2[2] = f2; in2[3] = f3;
+        in2[4] = f4; in2[5] = f5; in2[6] = f6; in2[7] = f7;
+    }
+    return (w+4);
+}
+
+static void dsp_add_fftswap(t_sample *in1, t_sample *in2, int n)
+{
+    if (n&7)
+        dsp_add(sigfft_swap, 3, in1, in2, (t_int)n);
+    else
+        dsp_add(sigfft_swap8, 3, in1, in2, (t_int)n);
+}
+
     /* take array1 (supply a pointer to beginning) and copy it,
     into decreasing addresses, into array 2 (supply a pointer one past the
     end), and negate the sign. */
@@ -37,6 +67,16 @@ static t_int *sigrfft_flip(t_int *w)
     t_sample *in = (t_sample *)(w[1]);
     t_sample *out = (t_sample *)(w[2]);
     int n = w[3];
+        /* n is one less than half the block size, so it's never a multiple
+        of 8; do the bulk eight at a time and then the odd ones. */
+    for (; n >= 8; n -= 8, in += 8, out -= 8)
+    {
+        t_sample f0 = in[0], f1 = in[1], f2 = in[2], f3 = in[3];
+        t_sample f4 = in[4], f5 = in[5], f6 = in[6], f7 = in[7];
+
+        out[-1] = -f0; out[-2] = -f1; out[-3] = -f2; out[-4] = -f3;
+        out[-5] = -f4; out[-6] = -f5; out[-7] = -f6; out[-8] = -f7;
+    }
     while (n--)
         *(--out) = - *in++;
     return (w+4);
@@ -96,17 +136,18 @@ static void sigfft_dspx(t_sigfft *x, t_signal **sp, t_int *(*f)(t_int *w))
     t_sample *in2 = sp[1]->s_vec;
     t_sample *out1 = sp[2]->s_vec;
     t_sample *out2 = sp[3]->s_vec;
+    mayer_prepare(n);
     if (out1 == in2 && out2 == in1)
-        dsp_add(sigfft_swap, 3, out1, out2, (t_int)n);
+        dsp_add_fftswap(out1, out2, n);
     else if (out1 == in2)
     {
-        dsp_add(copy_perform, 3, in2, out2, (t_int)n);
-        dsp_add(copy_perform, 3, in1, out1, (t_int)n);
+        dsp_add_copy(in2, out2, n);
+        dsp_add_copy(in1, out1, n);
     }
     else
     {
-        if (out1 != in1) dsp_add(copy_perform, 3, in1, out1, (t_int)n);
-        if (out2 != in2) dsp_add(copy_perform, 3, in2, out2, (t_int)n);
+        if (out1 != in1) dsp_add_copy(in1, out1, n);
+        if (out2 != in2) dsp_add_copy(in2, out2, n);
     }
     dsp_add(f, 3, sp[2]->s_vec, sp[3]->s_vec, (t_int)n);
 }
@@ -175,8 +216,9 @@ static void sigrfft_dsp(t_sigrfft *x, t_signal **sp)
         error("fft: minimum 4 points");
         return;
     }
+    mayer_prepare(n);
     if (in1 != out1)
-        dsp_add(copy_perform, 3, in1, out1, (t_int)n);
+        dsp_add_copy(in1, out1, n);
     dsp_add(sigrfft_perform, 2, out1, (t_int)n);
     dsp_add(sigrfft_flip, 3, out1 + (n2+1), out2 + n2, (t_int)(n2-1));
     dsp_add_zero(out1 + (n2+1), ((n2-1)&(~7)));
@@ -233,6 +275,7 @@ static void sigrifft_dsp(t_sigrifft *x, t_signal **sp)
         error("fft: minimum 4 points");
         return;
     }
+    mayer_prepare(n);
     if (in2 == out1)
     {
         dsp_add(sigrfft_flip, 3, out1+1, out1 + n, (t_int)(n2-1));
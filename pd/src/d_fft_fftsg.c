@@ -27,48 +27,70 @@ for another, more permissive-sounding copyright notice.  -MSP
 #define FFTFLT double
 void cdft(int, int, double *, int *, double *);
 void rdft(int, int, double *, int *, double *);
+void makewt(int nw, int *ip, double *w);
+void makect(int nc, int *ip, double *c);
 
 int ilog2(int n);
 
-static int ooura_maxn;
-static int *ooura_bitrev;
-static int ooura_bitrevsize;
-static FFTFLT *ooura_costab;
+#define MINFFT 2
+#define MAXFFT 30
 
-static int ooura_init( int n)
+    /* Ooura's routines take a bit-reversal work area and a cos/sin table
+    that must be computed for the largest size in use; we keep one set per
+    (power-of-two) transform length instead, so that instances using
+    different sizes don't make each other recompute them. Complex transforms
+    of n points use the plan for length 2n; real ones that for length n.
+    The tables are only read once made, so instances and threads can share
+    them; the buffer to convert to and from double precision is on the
+    caller's stack. */
+
+typedef struct _ooura_plan
 {
-    n = (1 << ilog2(n));
-    if (n < 64)
+    int *p_bitrev;
+    int p_bitrevsize;
+    FFTFLT *p_costab;
+} t_ooura_plan;
+
+static t_ooura_plan ooura_plans[MAXFFT+1];
+
+static t_ooura_plan *ooura_getplan(int n)
+{
+    t_ooura_plan *p;
+    int logn = ilog2(n);
+    if (logn < MINFFT || logn > MAXFFT)
         return (0);
-    if (n > ooura_maxn)
+    p = &ooura_plans[logn];
+    if (!p->p_costab)
     {
-        post("init");
-        if (ooura_maxn)
-        {
-            t_freebytes(ooura_bitrev, ooura_bitrevsize);
-            t_freebytes(ooura_costab, ooura_maxn * sizeof(FFTFLT) / 2);
-        }
-        ooura_bitrevsize = sizeof(int *) * (2 + (1 << (ilog2(n)/2)));
-        ooura_bitrev = (int *)t_getbytes(ooura_bitrevsize);
-        ooura_bitrev[0] = 0;
-        if (!ooura_bitrev)
-        {
-            error("out of memory allocating FFT buffer");
-            ooura_maxn = 0;
-            return (0);
-        }
-        ooura_costab = (FFTFLT *)t_getbytes(n * sizeof(FFTFLT)/2);
-        if (!ooura_costab)
+        int bitrevsize = sizeof(int) * (2 + (1 << ((logn + 1)/2)));
+        int *bitrev = (int *)t_getbytes(bitrevsize);
+        FFTFLT *costab;
+        n = (1 << logn);
+        costab = (FFTFLT *)t_getbytes(n * sizeof(FFTFLT)/2);
+        if (!bitrev || !costab)
         {
             error("out of memory allocating FFT buffer");
-            t_freebytes(ooura_bitrev, ooura_bitrevsize);
-            ooura_maxn = 0;
+            if (bitrev)
+                t_freebytes(bitrev, bitrevsize);
+            if (costab)
+                t_freebytes(costab, n * sizeof(FFTFLT)/2);
             return (0);
         }
-        ooura_maxn = n;
-        ooura_bitrev[0] = 0;
+            /* fill in the tables now, rather than on first use, and only
+            then make the plan visible */
+        makewt(n >> 2, bitrev, costab);
+        makect(n >> 2, bitrev, costab + (n >> 2));
+        p->p_bitrev = bitrev;
+        p->p_bitrevsize = bitrevsize;
+        p->p_costab = costab;
     }
-    return (1);
+    return (p);
+}
+
+EXTERN void mayer_prepare(int n)
+{
+    ooura_getplan(n);
+    ooura_getplan(2*n);
 }
 
 EXTERN void mayer_fht(t_sample *fz, int n)
@@ -81,16 +103,17 @@ EXTERN void mayer_dofft(t_sample *fz1, t_sample *fz2, int n, int sgn)
     FFTFLT *buf, *fp3;
     int i;
     t_sample *fp1, *fp2;
-    buf = alloca(n * (2 * sizeof(FFTFLT)));
-    if (!ooura_init(n))
+    t_ooura_plan *p = ooura_getplan(2*n);
+    if (!p)
         return;
+    buf = alloca(n * (2 * sizeof(FFTFLT)));
     for (i = 0, fp1 = fz1, fp2 = fz2, fp3 = buf; i < n; i++)
     {
         fp3[0] = *fp1++;
         fp3[1] = *fp2++;
         fp3 += 2;
     }
-    cdft(2*n, sgn, buf, ooura_bitrev, ooura_costab);
+    cdft(2*n, sgn, buf, p->p_bitrev, p->p_costab);
     for (i = 0, fp1 = fz1, fp2 = fz2, fp3 = buf; i < n; i++)
     {
         *fp1++ = fp3[0];
@@ -114,12 +137,13 @@ EXTERN void mayer_realfft(int n, t_sample *fz)
     FFTFLT *buf, *fp3;
     int i, nover2 = n/2;
     t_sample *fp1, *fp2;
-    buf = alloca(n * sizeof(FFTFLT));
-    if (!ooura_init(n))
+    t_ooura_plan *p = ooura_getplan(n);
+    if (!p)
         return;
+    buf = alloca(n * sizeof(FFTFLT));
     for (i = 0, fp1 = fz, fp3 = buf; i < n; i++, fp1++, fp3++)
         buf[i] = fz[i];
-    rdft(n, 1, buf, ooura_bitrev, ooura_costab);
+    rdft(n, 1, buf, p->p_bitrev, p->p_costab);
     fz[0] = buf[0];
     fz[nover2] = buf[1];
     for (i = 1, fp1 = fz+1, fp2 = fz+(n-1), fp3 = buf+2; i < nover2;
@@ -132,15 +156,16 @@ EXTERN void mayer_realifft(int n, t_sample *fz)
     FFTFLT *buf, *fp3;
     int i, nover2 = n/2;
     t_sample *fp1, *fp2;
-    buf = alloca(n * sizeof(FFTFLT));
-    if (!ooura_init(n))
+    t_ooura_plan *p = ooura_getplan(n);
+    if (!p)
         return;
+    buf = alloca(n * sizeof(FFTFLT));
     buf[0] = fz[0];
     buf[1] = fz[nover2];
     for (i = 1, fp1 = fz+1, fp2 = fz+(n-1), fp3 = buf+2; i < nover2;
         i++, fp1++, fp2--, fp3 += 2)
             fp3[0] = *fp1, fp3[1] = *fp2;
-    rdft(n, -1, buf, ooura_bitrev, ooura_costab);
+    rdft(n, -1, buf, p->p_bitrev, p->p_costab);
     for (i = 0, fp1 = fz, fp3 = buf; i < n; i++, fp1++, fp3++)
         fz[i] = 2*buf[i];
 }
@@ -161,3 +161,13 @@ EXTERN void mayer_realifft(int n, t_float *fz)
         fz[i] = p->out[i];
 }
 
+
+    /* make the plans for size "n" ahead of time, from the DSP sort routine,
+    so that FFTW_MEASURE doesn't run inside the DSP tick */
+EXTERN void mayer_prepare(int n)
+{
+    cfftw_getplan(n, 1);
+    cfftw_getplan(n, 0);
+    rfftw_getplan(n, 1);
+    rfftw_getplan(n, 0);
+}
@@ -420,4 +420,10 @@ void mayer_realifft(int n, REAL *real)
   real[i] = (a+b);
  }
  mayer_fht(real,n);
+}
+
+    /* the trig tables above are static and good for any size, so there's
+    nothing to set up ahead of time */
+void mayer_prepare(int n)
+{
 }
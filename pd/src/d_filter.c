@@ -431,20 +431,18 @@ static t_int *sigbiquad_perform(t_int *w)
     return (w+5);
 }
 
-static void sigbiquad_list(t_sigbiquad *x, t_symbol *s, int argc, t_atom *argv)
+    /* check that the poles given by coefs[0] and coefs[1] (fb1, fb2) are
+    inside the unit circle; if not, zero all five coefficients */
+static void sigbiquad_check(t_float *coefs)
 {
-    t_float fb1 = atom_getfloatarg(0, argc, argv);
-    t_float fb2 = atom_getfloatarg(1, argc, argv);
-    t_float ff1 = atom_getfloatarg(2, argc, argv);
-    t_float ff2 = atom_getfloatarg(3, argc, argv);
-    t_float ff3 = atom_getfloatarg(4, argc, argv);
+    t_float fb1 = coefs[0];
+    t_float fb2 = coefs[1];
     t_float discriminant = fb1 * fb1 + 4 * fb2;
-    t_biquadctl *c = x->x_ctl;
     if (discriminant < 0) /* imaginary roots -- resonant filter */
     {
             /* they're conjugates so we just check that the product
             is less than one */
-        if (fb2 >= -1.0f) goto stable;
+        if (fb2 >= -1.0f) return;
     }
     else    /* real roots */
     {
@@ -453,16 +451,25 @@ static void sigbiquad_list(t_sigbiquad *x, t_symbol *s, int argc, t_atom *argv)
                 at both ends, which implies both roots are in [1-,1]. */
         if (fb1 <= 2.0f && fb1 >= -2.0f &&
             1.0f - fb1 -fb2 >= 0 && 1.0f + fb1 - fb2 >= 0)
-                goto stable;
+                return;
     }
         /* if unstable, just bash to zero */
-    fb1 = fb2 = ff1 = ff2 = ff3 = 0;
-stable:
-    c->c_fb1 = fb1;
-    c->c_fb2 = fb2;
-    c->c_ff1 = ff1;
-    c->c_ff2 = ff2;
-    c->c_ff3 = ff3;
+    coefs[0] = coefs[1] = coefs[2] = coefs[3] = coefs[4] = 0;
+}
+
+static void sigbiquad_list(t_sigbiquad *x, t_symbol *s, int argc, t_atom *argv)
+{
+    t_float coefs[5];
+    t_biquadctl *c = x->x_ctl;
+    int i;
+    for (i = 0; i < 5; i++)
+        coefs[i] = atom_getfloatarg(i, argc, argv);
+    sigbiquad_check(coefs);
+    c->c_fb1 = coefs[0];
+    c->c_fb2 = coefs[1];
+    c->c_ff1 = coefs[2];
+    c->c_ff2 = coefs[3];
+    c->c_ff3 = coefs[4];
 }
 
 static void sigbiquad_set(t_sigbiquad *x, t_symbol *s, int argc, t_atom *argv)
@@ -494,6 +501,195 @@ void sigbiquad_setup(void)
         A_GIMME, 0);
 }
 
+/* -------- biquads~ - a bank of raw biquad filters, one per channel ------- */
+
+/* The channels are processed in groups of BIQUADS_LANES, each group keeping
+its state and coefficients as one small array per quantity, so that the
+compiler can run a whole group's recursion in vector registers.  To make
+that possible the input is interleaved into a scratch buffer first and
+deinterleaved into the outlets afterward.  Unused lanes of the last group
+have zero coefficients. */
+
+#define BIQUADS_LANES 4
+
+typedef struct biquadlanes
+{
+    t_sample l_x1[BIQUADS_LANES];
+    t_sample l_x2[BIQUADS_LANES];
+    t_sample l_fb1[BIQUADS_LANES];
+    t_sample l_fb2[BIQUADS_LANES];
+    t_sample l_ff1[BIQUADS_LANES];
+    t_sample l_ff2[BIQUADS_LANES];
+    t_sample l_ff3[BIQUADS_LANES];
+} t_biquadlanes;
+
+typedef struct sigbiquads
+{
+    t_object x_obj;
+    t_float x_f;
+    int x_nchans;
+    int x_ngroups;          /* nchans / BIQUADS_LANES, rounded up */
+    t_biquadlanes *x_lanes;
+    t_sample **x_ins;       /* signal vectors, set in the dsp method */
+    t_sample **x_outs;
+    t_sample *x_buf;        /* interleaved scratch buffer */
+    int x_bufsize;
+} t_sigbiquads;
+
+t_class *sigbiquads_class;
+
+static void sigbiquads_setchan(t_sigbiquads *x, int ch,
+    int argc, t_atom *argv)
+{
+    t_biquadlanes *q = x->x_lanes + ch / BIQUADS_LANES;
+    int l = ch % BIQUADS_LANES, i;
+    t_float coefs[5];
+    for (i = 0; i < 5; i++)
+        coefs[i] = atom_getfloatarg(i, argc, argv);
+    sigbiquad_check(coefs);
+    q->l_fb1[l] = coefs[0];
+    q->l_fb2[l] = coefs[1];
+    q->l_ff1[l] = coefs[2];
+    q->l_ff2[l] = coefs[3];
+    q->l_ff3[l] = coefs[4];
+}
+
+    /* a plain list sets the coefficients of all channels */
+static void sigbiquads_list(t_sigbiquads *x, t_symbol *s, int argc,
+    t_atom *argv)
+{
+    int ch;
+    for (ch = 0; ch < x->x_nchans; ch++)
+        sigbiquads_setchan(x, ch, argc, argv);
+}
+
+    /* "coef <channel> fb1 fb2 ff1 ff2 ff3" sets a single channel */
+static void sigbiquads_coef(t_sigbiquads *x, t_symbol *s, int argc,
+    t_atom *argv)
+{
+    int ch = atom_getintarg(0, argc, argv);
+    if (ch < 0 || ch >= x->x_nchans)
+    {
+        pd_error(x, "biquads~: channel %d out of range", ch);
+        return;
+    }
+    sigbiquads_setchan(x, ch, (argc > 0 ? argc - 1 : 0), argv + 1);
+}
+
+static void sigbiquads_clear(t_sigbiquads *x)
+{
+    int g, l;
+    for (g = 0; g < x->x_ngroups; g++)
+        for (l = 0; l < BIQUADS_LANES; l++)
+            x->x_lanes[g].l_x1[l] = x->x_lanes[g].l_x2[l] = 0;
+}
+
+static void *sigbiquads_new(t_symbol *s, int argc, t_atom *argv)
+{
+    t_sigbiquads *x = (t_sigbiquads *)pd_new(sigbiquads_class);
+    int nchans = atom_getintarg(0, argc, argv), i;
+    if (nchans < 1)
+        nchans = 1;
+    x->x_nchans = nchans;
+    x->x_ngroups = (nchans + BIQUADS_LANES - 1) / BIQUADS_LANES;
+    x->x_lanes = (t_biquadlanes *)getbytes(x->x_ngroups *
+        sizeof(t_biquadlanes));
+    x->x_ins = (t_sample **)getbytes(2 * nchans * sizeof(t_sample *));
+    x->x_outs = x->x_ins + nchans;
+    x->x_buf = (t_sample *)getbytes(0);
+    x->x_bufsize = 0;
+    for (i = 1; i < nchans; i++)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    for (i = 0; i < nchans; i++)
+        outlet_new(&x->x_obj, &s_signal);
+    sigbiquads_list(x, s, (argc > 0 ? argc - 1 : 0), argv + 1);
+    x->x_f = 0;
+    return (x);
+}
+
+static void sigbiquads_free(t_sigbiquads *x)
+{
+    freebytes(x->x_lanes, x->x_ngroups * sizeof(t_biquadlanes));
+    freebytes(x->x_ins, 2 * x->x_nchans * sizeof(t_sample *));
+    freebytes(x->x_buf, x->x_bufsize * sizeof(t_sample));
+}
+
+static t_int *sigbiquads_perform(t_int *w)
+{
+    t_sigbiquads *x = (t_sigbiquads *)(w[1]);
+    int n = (int)(w[2]);
+    int nchans = x->x_nchans, ngroups = x->x_ngroups,
+        width = ngroups * BIQUADS_LANES, i, ch, g, l;
+    t_sample *buf = x->x_buf, *bp;
+
+    for (ch = 0; ch < nchans; ch++)
+    {
+        t_sample *in = x->x_ins[ch];
+        for (i = 0, bp = buf + ch; i < n; i++, bp += width)
+            *bp = in[i];
+    }
+    for (i = 0, bp = buf; i < n; i++)
+    {
+        t_biquadlanes *q = x->x_lanes;
+        for (g = 0; g < ngroups; g++, q++, bp += BIQUADS_LANES)
+        {
+            for (l = 0; l < BIQUADS_LANES; l++)
+            {
+                t_sample last = q->l_x1[l], prev = q->l_x2[l];
+                t_sample output = bp[l] + q->l_fb1[l] * last +
+                    q->l_fb2[l] * prev;
+                if (PD_BIGORSMALL(output))
+                    output = 0;
+                bp[l] = q->l_ff1[l] * output + q->l_ff2[l] * last +
+                    q->l_ff3[l] * prev;
+                q->l_x2[l] = last;
+                q->l_x1[l] = output;
+            }
+        }
+    }
+    for (ch = 0; ch < nchans; ch++)
+    {
+        t_sample *out = x->x_outs[ch];
+        for (i = 0, bp = buf + ch; i < n; i++, bp += width)
+            out[i] = *bp;
+    }
+    return (w+3);
+}
+
+static void sigbiquads_dsp(t_sigbiquads *x, t_signal **sp)
+{
+    int nchans = x->x_nchans, n = sp[0]->s_n, ch,
+        bufsize = n * x->x_ngroups * BIQUADS_LANES;
+    if (x->x_bufsize != bufsize)
+    {
+            /* the padding lanes must start out zero; they stay that way */
+        freebytes(x->x_buf, x->x_bufsize * sizeof(t_sample));
+        x->x_buf = (t_sample *)getbytes(bufsize * sizeof(t_sample));
+        x->x_bufsize = bufsize;
+    }
+    for (ch = 0; ch < nchans; ch++)
+    {
+        x->x_ins[ch] = sp[ch]->s_vec;
+        x->x_outs[ch] = sp[nchans + ch]->s_vec;
+    }
+    dsp_add(sigbiquads_perform, 2, x, (t_int)n);
+}
+
+void sigbiquads_setup(void)
+{
+    sigbiquads_class = class_new(gensym("biquads~"),
+        (t_newmethod)sigbiquads_new, (t_method)sigbiquads_free,
+        sizeof(t_sigbiquads), 0, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(sigbiquads_class, t_sigbiquads, x_f);
+    class_addmethod(sigbiquads_class, (t_method)sigbiquads_dsp,
+        gensym("dsp"), A_CANT, 0);
+    class_addlist(sigbiquads_class, sigbiquads_list);
+    class_addmethod(sigbiquads_class, (t_method)sigbiquads_coef,
+        gensym("coef"), A_GIMME, 0);
+    class_addmethod(sigbiquads_class, (t_method)sigbiquads_clear,
+        gensym("clear"), 0);
+}
+
 /* ---------------- samphold~ - sample and hold  ----------------- */
 
 typedef struct sigsamphold
@@ -1072,6 +1268,7 @@ void d_filter_setup(void)
     siglop_setup();
     sigbp_setup();
     sigbiquad_setup();
+    sigbiquads_setup();
     sigsamphold_setup();
     sigrpole_setup();
     sigrzero_setup();
@@ -4,6 +4,8 @@
 
 
 #include "m_pd.h"
+#include <math.h>
+#include <string.h>
 
 /* --------------------- up/down-sampling --------------------- */
 t_int *downsampling_perform_0(t_int *w)
@@ -97,6 +99,114 @@ t_int *upsampling_perform_linear(t_int *w)
   return (w+6);
 }
 
+
+/* band-limited up/downsampling: a Blackman-windowed sinc lowpass at the
+   lower of the two Nyquist frequencies, applied in polyphase form so that
+   we never multiply the zeros of the stuffed signal (up) or compute the
+   samples we are going to drop (down).  A method ID of RESAMPLE_FIRMIN or
+   more gives the filter length in taps per low-rate sample; it is rounded
+   up to a multiple of 8 so that the inner product can be unrolled. */
+
+#define FIR_PI 3.14159265358979323846
+
+static t_sample resample_dot(t_sample *c, t_sample *x, int n)
+{
+    t_sample a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    for (; n; n -= 8, c += 8, x += 8)
+    {
+        a0 += c[0] * x[0] + c[4] * x[4];
+        a1 += c[1] * x[1] + c[5] * x[5];
+        a2 += c[2] * x[2] + c[6] * x[6];
+        a3 += c[3] * x[3] + c[7] * x[7];
+    }
+    return ((a0 + a1) + (a2 + a3));
+}
+
+t_int *upsampling_perform_fir(t_int *w)
+{
+  t_resample *x= (t_resample *)(w[1]);
+  t_sample *in  = (t_sample *)(w[2]); /* original signal     */
+  t_sample *out = (t_sample *)(w[3]); /* upsampled signal    */
+  int up       = (int)(w[4]);       /* upsampling factor   */
+  int parent   = (int)(w[5]);       /* original vectorsize */
+  int taps     = (int)(w[6]);       /* taps per phase      */
+  t_sample *hist = x->buffer;      /* taps-1 old samples, then the new ones */
+  int k, p;
+
+  memcpy(hist + taps - 1, in, parent * sizeof(t_sample));
+  for (k = 0; k < parent; k++, hist++)
+    for (p = 0; p < up; p++)
+      *out++ = resample_dot(x->coeffs + p * taps, hist, taps);
+  memmove(x->buffer, x->buffer + parent, (taps - 1) * sizeof(t_sample));
+
+  return (w+7);
+}
+
+t_int *downsampling_perform_fir(t_int *w)
+{
+  t_resample *x= (t_resample *)(w[1]);
+  t_sample *in  = (t_sample *)(w[2]); /* original signal     */
+  t_sample *out = (t_sample *)(w[3]); /* downsampled signal  */
+  int down     = (int)(w[4]);       /* downsampling factor */
+  int parent   = (int)(w[5]);       /* original vectorsize */
+  int taps     = (int)(w[6]);       /* filter length       */
+  t_sample *hist = x->buffer;      /* taps-1 old samples, then the new ones */
+  int n = parent/down;
+
+  memcpy(hist + taps - 1, in, parent * sizeof(t_sample));
+  for (; n--; hist += down)
+    *out++ = resample_dot(x->coeffs, hist, taps);
+  memmove(x->buffer, x->buffer + parent, (taps - 1) * sizeof(t_sample));
+
+  return (w+7);
+}
+
+    /* design the filter for a resampling factor and set up the history
+    buffer; "taps" is per low-rate sample.  For upsampling the coefficients
+    are stored one phase after the other, each phase normalized to unity
+    gain at DC so that the output doesn't ripple. */
+static void resample_fir_dsp(t_resample *x, int factor, int taps,
+    int insize, int up)
+{
+    int ncoef = factor * taps, histsize = (up ? taps : ncoef) - 1 + insize;
+    int i, p;
+    double center = 0.5 * (ncoef - 1);
+
+    if (x->coefsize != ncoef)
+    {
+        t_freebytes(x->coeffs, x->coefsize*sizeof(*x->coeffs));
+        x->coefsize = ncoef;
+        x->coeffs = t_getbytes(x->coefsize*sizeof(*x->coeffs));
+    }
+    if (x->bufsize != histsize)
+    {
+        t_freebytes(x->buffer, x->bufsize*sizeof(*x->buffer));
+        x->bufsize = histsize;
+        x->buffer = t_getbytes(x->bufsize*sizeof(*x->buffer));
+    }
+    memset(x->buffer, 0, x->bufsize*sizeof(*x->buffer));
+
+        /* the prototype is symmetric, so we needn't reverse it to turn
+        the convolution into a forward inner product. */
+    for (i = 0; i < ncoef; i++)
+    {
+        double t = (i - center) / factor, ph = 2 * FIR_PI * (i + 0.5) / ncoef;
+        double win = 0.42 - 0.5 * cos(ph) + 0.08 * cos(2 * ph);
+        double sinc = (t == 0 ? 1 : sin(FIR_PI * t) / (FIR_PI * t));
+        int where = (up ? (factor - 1 - i % factor) * taps + i / factor : i);
+        x->coeffs[where] = win * sinc;
+    }
+    for (p = 0; p < (up ? factor : 1); p++)
+    {
+        t_sample *c = x->coeffs + p * taps, sum = 0;
+        int n = (up ? taps : ncoef);
+        for (i = 0; i < n; i++)
+            sum += c[i];
+        for (i = 0; i < n; i++)
+            c[i] /= sum;
+    }
+}
+
 /* ----------------------- public -------------------------------- */
 
 /* utils */
@@ -139,6 +249,13 @@ void resample_dsp(t_resample *x,
       error("bad downsampling factor");
       return;
     }
+    if (method >= RESAMPLE_FIRMIN) {
+      int taps = (method + 7) & ~7;
+      resample_fir_dsp(x, insize/outsize, taps, insize, 0);
+      dsp_add(downsampling_perform_fir, 6, x, in, out,
+        (t_int)(insize/outsize), (t_int)insize, (t_int)x->coefsize);
+      return;
+    }
     switch (method) {
     default:
       dsp_add(downsampling_perform_0, 4, in, out, (t_int)(insize/outsize),
@@ -151,6 +268,13 @@ void resample_dsp(t_resample *x,
       error("bad upsampling factor");
       return;
     }
+    if (method >= RESAMPLE_FIRMIN) {
+      int taps = (method + 7) & ~7;
+      resample_fir_dsp(x, outsize/insize, taps, insize, 1);
+      dsp_add(upsampling_perform_fir, 6, x, in, out, (t_int)(outsize/insize),
+        (t_int)insize, (t_int)taps);
+      return;
+    }
     switch (method) {
     case 1:
       dsp_add(upsampling_perform_hold, 4, in, out, (t_int)(outsize/insize),
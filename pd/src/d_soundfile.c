@@ -33,6 +33,7 @@ objects use Posix-like threads. */
 #include <limits.h>
 
 #include "m_pd.h"
+#include "s_stuff.h"
 
 #define MAXSFCHANS 64
 
@@ -1093,7 +1094,9 @@ static int create_soundfile(t_canvas *canvas, const char *filename,
         wavehdr->w_datachunksize = swap4((uint32_t)datasize, swap);
         headersize = sizeof(t_wave);
     }
-    canvas_makefilename(canvas, filenamebuf, buf2, FILENAME_MAX);
+    if (canvas)
+        canvas_makefilename(canvas, filenamebuf, buf2, FILENAME_MAX);
+    else strcpy(buf2, filenamebuf);
     sys_bashfilename(buf2, buf2);
     if ((fd = sys_open(buf2, BINCREATE, 0666)) < 0)
         return (-1);
@@ -1397,6 +1400,309 @@ static void soundfile_xferout_float(int nchannels, t_float **vecs,
     }
 }
 
+/* ------------- offline rendering ("pd -batch -render") ------------------ */
+
+    /* m_batchrender() streams one input file into adc~ and writes dac~ to
+    one output file, a block at a time.  The input is opened while the
+    command line is digested so that its sample rate and channel count are
+    in force before any patch is loaded.  Output is 32-bit float unless the
+    file name asks for AIFF, which we write as 24 bits. */
+
+static int render_infd = -1;
+static t_soundfile_info render_ininfo;
+static int render_outfd = -1;
+static int render_outtype, render_outbytes, render_outbigendian;
+static int render_outswap, render_outchannels;
+static long render_outframes, render_outwritten;
+static char render_outname[FILENAME_MAX];
+static unsigned char render_buf[MAXSFCHANS * 4 * DEFDACBLKSIZE];
+
+int soundfile_renderopenin(const char *filename, int *p_nchannels,
+    int *p_samplerate, long *p_nframes)
+{
+    int fd;
+    if ((fd = sys_open(filename, O_RDONLY)) < 0)
+        return (-1);
+    render_ininfo.headersize = -1;
+    if ((render_infd = open_soundfile_via_fd(fd, &render_ininfo, 0)) < 0)
+    {
+        sys_close(fd);
+        return (-1);
+    }
+    if (render_ininfo.channels > MAXSFCHANS)
+        render_ininfo.channels = MAXSFCHANS;
+    *p_nchannels = render_ininfo.channels;
+    *p_samplerate = render_ininfo.samplerate;
+    *p_nframes = render_ininfo.bytelimit /
+        (render_ininfo.channels * render_ininfo.bytespersample);
+    return (0);
+}
+
+int soundfile_renderopenout(const char *filename, int nchannels,
+    t_float samplerate, long nframes)
+{
+    int len = strlen(filename);
+    if (nchannels > MAXSFCHANS)
+        nchannels = MAXSFCHANS;
+    if (len > 4 && !strcmp(filename + len - 4, ".snd"))
+        render_outtype = FORMAT_NEXT, render_outbytes = 4,
+            render_outbigendian = 1;
+    else if ((len > 4 && !strcmp(filename + len - 4, ".aif")) ||
+        (len > 5 && !strcmp(filename + len - 5, ".aiff")))
+            render_outtype = FORMAT_AIFF, render_outbytes = 3,
+                render_outbigendian = 1;
+    else render_outtype = FORMAT_WAVE, render_outbytes = 4,
+        render_outbigendian = 0;
+    render_outswap = (render_outbigendian != garray_ambigendian());
+    render_outchannels = nchannels;
+    render_outframes = nframes;
+    render_outwritten = 0;
+    strncpy(render_outname, filename, FILENAME_MAX-1);
+    render_outname[FILENAME_MAX-1] = 0;
+    render_outfd = create_soundfile(0, filename, render_outtype, nframes,
+        render_outbytes, render_outbigendian, nchannels, render_outswap,
+            samplerate, 0);
+    return (render_outfd < 0 ? -1 : 0);
+}
+
+    /* read the next "n" frames into "nchannels" vectors of "n" samples
+    each, laid out one after the other as in sys_soundin.  Frames past the
+    end of the file read as zero.  Returns the number of frames read. */
+int soundfile_renderread(t_sample *vec, int nchannels, int n)
+{
+    t_sample *vecs[MAXSFCHANS];
+    int i, j, nread = 0;
+    if (nchannels > MAXSFCHANS)
+        nchannels = MAXSFCHANS;
+    for (i = 0; i < nchannels; i++)
+        vecs[i] = vec + i * n;
+    if (render_infd >= 0 && n <= DEFDACBLKSIZE)
+    {
+        int bytesperframe =
+            render_ininfo.channels * render_ininfo.bytespersample;
+        long want = n * bytesperframe;
+        if (want > render_ininfo.bytelimit)
+            want = render_ininfo.bytelimit;
+        if (want > 0 && (want = read(render_infd, render_buf, want)) > 0)
+        {
+            nread = want / bytesperframe;
+            render_ininfo.bytelimit -= want;
+            soundfile_xferin_sample(render_ininfo.channels, nchannels, vecs,
+                0, render_buf, nread, render_ininfo.bytespersample,
+                    render_ininfo.bigendian);
+        }
+    }
+    for (i = 0; i < nchannels; i++)
+        for (j = nread; j < n; j++)
+            vecs[i][j] = 0;
+    return (nread);
+}
+
+    /* write the first "nframes" of "n" frames laid out as in sys_soundout */
+int soundfile_renderwrite(t_sample *vec, int n, int nframes)
+{
+    t_sample *vecs[MAXSFCHANS];
+    int i, nbytes = nframes * render_outchannels * render_outbytes;
+    if (render_outfd < 0 || n > DEFDACBLKSIZE)
+        return (-1);
+    for (i = 0; i < render_outchannels; i++)
+        vecs[i] = vec + i * n;
+    soundfile_xferout_sample(render_outchannels, vecs, render_buf, nframes,
+        0, render_outbytes, render_outbigendian, 1, 1);
+    if (write(render_outfd, render_buf, nbytes) < nbytes)
+        return (-1);
+    render_outwritten += nframes;
+    return (0);
+}
+
+void soundfile_renderclose(void)
+{
+    if (render_infd >= 0)
+        sys_close(render_infd);
+    render_infd = -1;
+    if (render_outfd >= 0)
+    {
+        soundfile_finishwrite(0, render_outname, render_outfd,
+            render_outtype, render_outframes, render_outwritten,
+                render_outchannels * render_outbytes, render_outswap);
+        sys_close(render_outfd);
+    }
+    render_outfd = -1;
+}
+
+/* ------- sample rate conversion for the "-resample" read flag ---------- */
+
+    /* Soundfiles recorded at a sample rate other than Pd's can be converted
+    as they are read, so that patches don't have to interpolate at run time.
+    We use a Blackman-windowed sinc filter with RESAMPLE_ZEROS zero crossings
+    on either side, widened when downsampling so that the cutoff follows the
+    lower of the two Nyquist frequencies.  The rate ratio is reduced to a
+    fraction "inc/nphases" so that the filter can be computed once as a bank
+    of polyphase kernels; each output sample is then a straight dot product
+    over consecutive input samples. */
+
+#define RESAMPLE_ZEROS 16
+#define RESAMPLE_MAXPHASES 8192
+#define RESAMPLE_MAXTAPS 1024
+#define RESAMPLE_PI 3.14159265358979
+
+typedef struct _sfresample
+{
+    int r_nchannels;
+    int r_ntaps;            /* kernel length (even) */
+    int r_nphases;          /* number of kernels in the bank */
+    int r_inc;              /* input advance per output sample, in phases */
+    int r_phase;            /* phase of the next output sample */
+    t_sample *r_bank;       /* r_nphases kernels of r_ntaps coefficients */
+    int r_bufsize;          /* input frames each channel can hold */
+    int r_head;             /* first input frame for the next output */
+    int r_fill;             /* number of input frames held */
+    int r_eof;              /* true once input is exhausted */
+    t_sample *(r_vec[MAXSFCHANS]);  /* input history, one per channel */
+} t_sfresample;
+
+static long sfresample_gcd(long a, long b)
+{
+    while (b)
+    {
+        long c = a % b;
+        a = b;
+        b = c;
+    }
+    return (a);
+}
+
+    /* make a converter from "insr" to "outsr".  The caller feeds it at
+    most "maxinput" frames at a time. */
+static t_sfresample *sfresample_new(int nchannels, t_float insr,
+    t_float outsr, int maxinput)
+{
+    t_sfresample *r = (t_sfresample *)getbytes(sizeof(*r));
+    long in = insr, out = outsr, g;
+    double cutoff = (outsr < insr ? outsr / insr : 1), halfwidth;
+    int i, j, nbank;
+    if (in == insr && out == outsr && in > 0 && out > 0 &&
+        out / (g = sfresample_gcd(in, out)) <= RESAMPLE_MAXPHASES)
+    {
+        r->r_inc = in / g;
+        r->r_nphases = out / g;
+    }
+    else
+    {
+            /* non-integer rates or an awkward ratio: approximate it; the
+            resulting pitch error is a fraction of a cent. */
+        r->r_nphases = RESAMPLE_MAXPHASES;
+        r->r_inc = insr * RESAMPLE_MAXPHASES / outsr + 0.5;
+        if (r->r_inc < 1)
+            r->r_inc = 1;
+    }
+    halfwidth = ceil(RESAMPLE_ZEROS / cutoff);
+    if (halfwidth > RESAMPLE_MAXTAPS/2)
+        halfwidth = RESAMPLE_MAXTAPS/2;
+    r->r_ntaps = 2 * halfwidth;
+    nbank = r->r_nphases * r->r_ntaps;
+    r->r_bank = (t_sample *)getbytes(nbank * sizeof(t_sample));
+    for (i = 0; i < r->r_nphases; i++)
+    {
+        t_sample *coef = r->r_bank + i * r->r_ntaps;
+        double frac = (double)i / r->r_nphases, sum = 0;
+        for (j = 0; j < r->r_ntaps; j++)
+        {
+                /* distance from the output point to this tap's input */
+            double d = frac + halfwidth - 1 - j, x = RESAMPLE_PI * d * cutoff,
+                w = RESAMPLE_PI * d / halfwidth, c;
+            if (d <= -halfwidth || d >= halfwidth)
+                c = 0;
+            else c = (x == 0 ? 1 : sin(x) / x) *
+                (0.42 + 0.5 * cos(w) + 0.08 * cos(2 * w));
+            coef[j] = c;
+            sum += c;
+        }
+            /* normalize each kernel to unity gain at DC */
+        if (sum != 0)
+            for (j = 0; j < r->r_ntaps; j++)
+                coef[j] /= sum;
+    }
+    r->r_nchannels = nchannels;
+    r->r_bufsize = maxinput + 2 * r->r_ntaps;
+    for (i = 0; i < nchannels; i++)
+        r->r_vec[i] = (t_sample *)getbytes(r->r_bufsize * sizeof(t_sample));
+        /* prime with zeros so the first output is centered on frame 0 */
+    r->r_fill = halfwidth - 1;
+    r->r_head = r->r_phase = r->r_eof = 0;
+    return (r);
+}
+
+static void sfresample_free(t_sfresample *r)
+{
+    int i;
+    for (i = 0; i < r->r_nchannels; i++)
+        freebytes(r->r_vec[i], r->r_bufsize * sizeof(t_sample));
+    freebytes(r->r_bank, r->r_nphases * r->r_ntaps * sizeof(t_sample));
+    freebytes(r, sizeof(*r));
+}
+
+    /* discard input we're done with and return how many frames may be
+    written, starting at r_vec[channel] + r_fill, before sfresample_advance */
+static int sfresample_room(t_sfresample *r)
+{
+    int i, drop = (r->r_head < r->r_fill ? r->r_head : r->r_fill);
+    if (drop)
+    {
+        for (i = 0; i < r->r_nchannels; i++)
+            memmove(r->r_vec[i], r->r_vec[i] + drop,
+                (r->r_fill - drop) * sizeof(t_sample));
+        r->r_fill -= drop;
+        r->r_head -= drop;
+    }
+    return (r->r_bufsize - r->r_fill);
+}
+
+static void sfresample_advance(t_sfresample *r, int nframes)
+{
+    r->r_fill += nframes;
+}
+
+    /* no more input: append zeros to flush out the filter's tail */
+static void sfresample_finish(t_sfresample *r)
+{
+    int i, nzeros = r->r_ntaps/2;
+    if (r->r_eof)
+        return;
+    if (sfresample_room(r) < nzeros)
+        bug("sfresample_finish");
+    else
+    {
+        for (i = 0; i < r->r_nchannels; i++)
+            memset(r->r_vec[i] + r->r_fill, 0, nzeros * sizeof(t_sample));
+        r->r_fill += nzeros;
+    }
+    r->r_eof = 1;
+}
+
+    /* compute up to "maxframes" output frames from the buffered input into
+    vecs[channel][spread * (onset + n)]; return the number computed. */
+static int sfresample_run(t_sfresample *r, t_sample **vecs, long onset,
+    int spread, int maxframes)
+{
+    int n, i, j, ntaps = r->r_ntaps;
+    for (n = 0; n < maxframes && r->r_head + ntaps <= r->r_fill; n++)
+    {
+        t_sample *coef = r->r_bank + r->r_phase * ntaps;
+        for (i = 0; i < r->r_nchannels; i++)
+        {
+            t_sample *in = r->r_vec[i] + r->r_head, acc = 0;
+            for (j = 0; j < ntaps; j++)
+                acc += in[j] * coef[j];
+            vecs[i][spread * (onset + n)] = acc;
+        }
+        r->r_phase += r->r_inc;
+        r->r_head += r->r_phase / r->r_nphases;
+        r->r_phase %= r->r_nphases;
+    }
+    return (n);
+}
+
 /* ------- soundfiler - reads and writes soundfiles to/from "garrays" ---- */
 #define DEFMAXSIZE 0x7fffffff /* default maximum 16 MB per channel */
 #define SAMPBUFSIZE 1024
@@ -1420,11 +1726,44 @@ static t_soundfiler *soundfiler_new(void)
     return (x);
 }
 
+    /* get the points of the arrays into vecs[] and return how many floats
+    apart they are (see garray_getfloatvec()), or 0 if an array isn't one of
+    floats.  Arrays that disagree about it are all widened to t_words. */
+static int soundfiler_getvecs(int narray, t_garray **garrays, t_float **vecs)
+{
+    int i, vecsize, spread, firstspread = 0;
+    for (i = 0; i < narray; i++)
+    {
+        if (!garray_getfloatvec(garrays[i], &vecsize, &vecs[i], &spread))
+            return (0);
+        if (!i)
+            firstspread = spread;
+        else if (spread != firstspread)
+        {
+            for (i = 0; i < narray; i++)
+                garray_getfloatwords(garrays[i], &vecsize, (t_word **)&vecs[i]);
+            return (sizeof(t_word)/sizeof(t_float));
+        }
+    }
+    return (firstspread);
+}
+
+    /* zero the points of an array from "onset" on */
+static void soundfiler_zero(t_garray *a, long onset)
+{
+    int vecsize, spread;
+    t_float *vec;
+    long j;
+    if (garray_getfloatvec(a, &vecsize, &vec, &spread))
+        for (j = onset; j < vecsize; j++)
+            vec[j * spread] = 0;
+}
+
 static void soundfiler_readascii(t_soundfiler *x, char *filename,
-    int narray, t_garray **garrays, t_word **vecs, int resize, int finalsize)
+    int narray, t_garray **garrays, t_float **vecs, int resize, int finalsize)
 {
     t_binbuf *b = binbuf_new();
-    int n, i, j, nframes, vecsize;
+    int n, i, j, nframes, spread;
     t_atom *atoms, *ap;
     if (binbuf_read_via_canvas(b, filename, x->x_canvas, 0))
         return;
@@ -1441,25 +1780,22 @@ static void soundfiler_readascii(t_soundfiler *x, char *filename,
     if (resize)
     {
         for (i = 0; i < narray; i++)
-        {
             garray_resize_long(garrays[i], nframes);
-            if (!garray_getfloatwords(garrays[i], &vecsize, &vecs[i]))
-                bug("garray_getfloatwords[%d]", i);
-        }
     }
     else if (finalsize < nframes)
         nframes = finalsize;
+    if (!(spread = soundfiler_getvecs(narray, garrays, vecs)))
+    {
+        bug("soundfiler_getvecs");
+        binbuf_free(b);
+        return;
+    }
     for (j = 0, ap = atoms; j < nframes; j++)
         for (i = 0; i < narray; i++)
-            vecs[i][j].w_float = atom_getfloat(ap++);
+            vecs[i][j * spread] = atom_getfloat(ap++);
         /* zero out remaining elements of vectors */
     for (i = 0; i < narray; i++)
-    {
-        int vecsize;
-        if (garray_getfloatwords(garrays[i], &vecsize, &vecs[i]))
-        for (j = nframes; j < vecsize; j++)
-            vecs[i][j].w_float = 0;
-    }
+        soundfiler_zero(garrays[i], nframes);
     for (i = 0; i < narray; i++)
         garray_redraw(garrays[i]);
 }
@@ -1473,6 +1809,7 @@ static void soundfiler_readascii(t_soundfiler *x, char *filename,
         -raw <headersize channels bytes endian>
         -resize
         -maxsize <max-size>
+        -resample ... convert to Pd's sample rate
     */
 
 #define RAWSYNTAX "'-raw' flag syntax: " \
@@ -1487,15 +1824,16 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
     int ac = argc;
     t_atom *av = argv;
     t_soundfile_info info;
-    int resize = 0, i, j;
-    long skipframes = 0, finalsize = 0,
+    int resize = 0, resample = 0, i;
+    long skipframes = 0, finalsize = 0, framelimit,
         maxsize = DEFMAXSIZE, itemsread = 0;
+    t_sfresample *resampler = 0;
     int fd = -1;
     char endianness, *filename;
     t_garray *garrays[MAXSFCHANS];
-    t_word *vecs[MAXSFCHANS];
+    t_float *vecs[MAXSFCHANS];
     char sampbuf[SAMPBUFSIZE];
-    int bufframes, nitems;
+    int bufframes, nitems, spread;
     FILE *fp;
     int ascii = 0;
     info.samplerate = 0;
@@ -1643,6 +1981,16 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
             resize = 1;     /* maxsize implies resize. */
             ac -= 2; av += 2;
         }
+        else if (!strcmp(flag, "-resample"))
+        {
+            if (flag_has_unexpected_floatarg(x, s, argc, argv,
+                flag, ac, av))
+            {
+                goto done;
+            }
+            resample = 1;
+            ac -= 1; av += 1;
+        }
         else
         {
             argerror(x, s, argc, argv, "unknown flag '%s'", flag);
@@ -1680,8 +2028,8 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
                 av[i].a_w.w_symbol->s_name);
             goto done;
         }
-        else if (!garray_getfloatwords(garrays[i], &vecsize, 
-                &vecs[i]))
+        else if (!garray_getfloatvec(garrays[i], &vecsize,
+                &vecs[i], &spread))
             error("%s: bad template for tabwrite",
                 av[i].a_w.w_symbol->s_name);
         if (finalsize && finalsize != vecsize && !resize)
@@ -1718,6 +2066,13 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
     if (fd < 0)
         goto done;
 
+    if (resample && info.samplerate > 0 && info.samplerate != sys_getsr())
+    {
+        bufframes = SAMPBUFSIZE / (info.channels * info.bytespersample);
+        resampler = sfresample_new((info.channels < ac ? info.channels : ac),
+            info.samplerate, sys_getsr(), bufframes);
+    }
+
     if (resize)
     {
             /* figure out what to resize to */
@@ -1733,11 +2088,6 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
         }
         lseek(fd, poswas, SEEK_SET);
         framesinfile = (eofis - poswas) / (info.channels * info.bytespersample);
-        if (framesinfile > maxsize)
-        {
-            argerror(x, s, argc, argv, "truncated to %ld elements", maxsize);
-            framesinfile = maxsize;
-        }
         if (framesinfile > info.bytelimit /
             (info.channels * info.bytespersample))
         {
@@ -1745,6 +2095,14 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
                 (info.channels * info.bytespersample);
         }
         finalsize = framesinfile;
+        if (resampler)
+            finalsize = framesinfile * (double)sys_getsr() / info.samplerate;
+            /* the limit is on the array, so it applies after resampling */
+        if (finalsize > maxsize)
+        {
+            argerror(x, s, argc, argv, "truncated to %ld elements", maxsize);
+            finalsize = maxsize;
+        }
         for (i = 0; i < ac; i++)
         {
             int vecsize;
@@ -1753,8 +2111,8 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
 
             /* for sanity's sake let's clear the save-in-patch flag here */
             garray_setsaveit(garrays[i], 0);
-            if (!garray_getfloatwords(garrays[i], &vecsize, &vecs[i])
-                || (vecsize != framesinfile))
+            if (!garray_getfloatvec(garrays[i], &vecsize, &vecs[i], &spread)
+                || (vecsize != finalsize))
             {
                 /* if the resize failed, garray_resize reported the error */
                 argerror(x, s, argc, argv, "resize failed");
@@ -1763,41 +2121,60 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
         }
     }
     if (!finalsize) finalsize = 0x7fffffff;
-    if (finalsize > info.bytelimit / (info.channels * info.bytespersample))
-        finalsize = info.bytelimit / (info.channels * info.bytespersample);
+    framelimit = info.bytelimit / (info.channels * info.bytespersample);
+    if (finalsize > framelimit && !resampler)
+        finalsize = framelimit;
+    if (!(spread = soundfiler_getvecs(ac, garrays, vecs)))
+    {
+        argerror(x, s, argc, argv, "bad template");
+        goto done;
+    }
     fp = fdopen(fd, "rb");
     bufframes = SAMPBUFSIZE / (info.channels * info.bytespersample);
 
-    for (itemsread = 0; itemsread < finalsize; )
+        /* when resampling, alternately drain the converter into the arrays
+        and refill it from the file, until the arrays are full or the input
+        (followed by the filter's tail) is used up. */
+    if (resampler) for (itemsread = 0; itemsread < finalsize; )
+    {
+        itemsread += sfresample_run(resampler, (t_sample **)vecs, itemsread,
+            spread, finalsize - itemsread);
+        if (itemsread >= finalsize || resampler->r_eof)
+            break;
+        sfresample_room(resampler);
+        nitems = (framelimit > 0 ? fread(sampbuf,
+            info.channels * info.bytespersample,
+            (framelimit > bufframes ? bufframes : framelimit), fp) : 0);
+        if (nitems <= 0)
+            sfresample_finish(resampler);
+        else
+        {
+            soundfile_xferin_float(info.channels, resampler->r_nchannels,
+                resampler->r_vec, resampler->r_fill, (unsigned char *)sampbuf,
+                nitems, info.bytespersample, info.bigendian, 1);
+            sfresample_advance(resampler, nitems);
+            framelimit -= nitems;
+        }
+    }
+    else for (itemsread = 0; itemsread < finalsize; )
     {
         long thisread = finalsize - itemsread;
         thisread = (thisread > bufframes ? bufframes : thisread);
         nitems = fread(sampbuf, info.channels * info.bytespersample, thisread,
             fp);
         if (nitems <= 0) break;
-        soundfile_xferin_float(info.channels, ac, (t_float **)vecs, itemsread,
+        soundfile_xferin_float(info.channels, ac, vecs, itemsread,
             (unsigned char *)sampbuf, nitems, info.bytespersample,
-            info.bigendian, sizeof(t_word)/sizeof(t_sample));
+            info.bigendian, spread);
         itemsread += nitems;
     }
         /* zero out remaining elements of vectors */
         
     for (i = 0; i < ac; i++)
-    {
-        int vecsize;
-        if (garray_getfloatwords(garrays[i], &vecsize, &vecs[i]))
-            for (j = itemsread; j < vecsize; j++)
-                vecs[i][j].w_float = 0;
-    }
+        soundfiler_zero(garrays[i], itemsread);
         /* zero out vectors in excess of number of channels */
     for (i = info.channels; i < ac; i++)
-    {
-        int vecsize;
-        t_word *foo;
-        if (garray_getfloatwords(garrays[i], &vecsize, &foo))
-            for (j = 0; j < vecsize; j++)
-                foo[j].w_float = 0;
-    }
+        soundfiler_zero(garrays[i], 0);
         /* do all graphics updates */
     for (i = 0; i < ac; i++)
         garray_redraw(garrays[i]);
@@ -1806,6 +2183,8 @@ static void soundfiler_read(t_soundfiler *x, t_symbol *s,
 done:
     if (fd >= 0)
         sys_close(fd);
+    if (resampler)
+        sfresample_free(resampler);
     outlet_soundfile_info(x->x_out2, &info);
     outlet_float(x->x_obj.ob_outlet, (t_float)itemsread); 
 }
@@ -1822,9 +2201,9 @@ long soundfiler_dowrite(void *obj, t_canvas *canvas,
     int swap, filetype, normalize, i;
     long onset, nframes, itemswritten = 0, j;
     t_garray *garrays[MAXSFCHANS];
-    t_word *vecs[MAXSFCHANS];
+    t_float *vecs[MAXSFCHANS];
     char sampbuf[SAMPBUFSIZE];
-    int bufframes;
+    int bufframes, spread;
     int fd = -1;
     t_sample normfactor, biggest = 0;
     t_float samplerate;
@@ -1871,7 +2250,7 @@ long soundfiler_dowrite(void *obj, t_canvas *canvas,
             goto fail;
         }
             /* need to check this one-- */
-        else if (!garray_getfloatwords(garrays[i], &vecsize, &vecs[i]))
+        else if (!garray_getfloatvec(garrays[i], &vecsize, &vecs[i], &spread))
             error("%s: bad template for tabwrite",
                 argv[i].a_w.w_symbol->s_name);
         if (nframes > vecsize - onset)
@@ -1882,16 +2261,22 @@ long soundfiler_dowrite(void *obj, t_canvas *canvas,
         argerror(obj, gensym("write"), original_argc, original_argv,
             "no samples at onset %ld", onset);
         goto fail;
+    }
+    if (!(spread = soundfiler_getvecs(info->channels, garrays, vecs)))
+    {
+        argerror(obj, gensym("write"), original_argc, original_argv,
+            "bad template");
+        goto fail;
     }
         /* find biggest sample for normalizing */
     for (i = 0; i < info->channels; i++)
     {
         for (j = onset; j < nframes + onset; j++)
         {
-            if (vecs[i][j].w_float > biggest)
-                biggest = vecs[i][j].w_float;
-            else if (-vecs[i][j].w_float > biggest)
-                biggest = -vecs[i][j].w_float;
+            if (vecs[i][j * spread] > biggest)
+                biggest = vecs[i][j * spread];
+            else if (-vecs[i][j * spread] > biggest)
+                biggest = -vecs[i][j * spread];
         }
     }
     if ((fd = create_soundfile(canvas, filesym->s_name, filetype,
@@ -1921,9 +2306,9 @@ long soundfiler_dowrite(void *obj, t_canvas *canvas,
     {
         int thiswrite = nframes - itemswritten, nbytes;
         thiswrite = (thiswrite > bufframes ? bufframes : thiswrite);
-        soundfile_xferout_float(argc, (t_float **)vecs, (unsigned char *)sampbuf,
-            thiswrite, onset, info->bytespersample, info->bigendian, normfactor,
-                 sizeof(t_word)/sizeof(t_sample));
+        soundfile_xferout_float(argc, vecs, (unsigned char *)sampbuf,
+            thiswrite, onset * spread, info->bytespersample, info->bigendian,
+                normfactor, spread);
         nbytes = write(fd, sampbuf, info->channels * info->bytespersample *
             thiswrite);
         if (nbytes < info->channels * info->bytespersample * thiswrite)
@@ -1934,7 +2319,7 @@ long soundfiler_dowrite(void *obj, t_canvas *canvas,
             break;
         }
         itemswritten += thiswrite;
-        onset += thiswrite * (sizeof(t_word)/sizeof(float));
+        onset += thiswrite;
     }
     if (fd >= 0)
     {
@@ -2046,6 +2431,8 @@ typedef struct _readsf
     int x_eof;              /* true if fifohead has stopped changing */
     int x_sigcountdown;     /* counter for signalling child for more data */
     int x_sigperiod;        /* number of ticks per signal */
+    int x_resample;         /* readsf~ only; convert to Pd's sample rate */
+    t_sfresample *x_resampler;  /* readsf~ only; converter if needed */
     int x_filetype;         /* writesf~ only; type of file to create */
     int x_itemswritten;     /* writesf~ only; items writen */
     int x_swap;             /* writesf~ only; true if byte swapping */
@@ -2146,6 +2533,17 @@ static void *readsf_child_main(void *zz)
                 x->x_fd = -1;
                 if (x->x_requestcode != REQUEST_BUSY)
                     goto lost;
+            }
+                /* likewise drop the previous file's rate converter */
+            if (x->x_resampler)
+            {
+                t_sfresample *r = x->x_resampler;
+                x->x_resampler = 0;
+                pthread_mutex_unlock(&x->x_mutex);
+                sfresample_free(r);
+                pthread_mutex_lock(&x->x_mutex);
+                if (x->x_requestcode != REQUEST_BUSY)
+                    goto lost;
             }
                 /* open the soundfile with the mutex unlocked */
             pthread_mutex_unlock(&x->x_mutex);
@@ -2159,8 +2557,26 @@ static void *readsf_child_main(void *zz)
             x->x_bytespersample = info.bytespersample;
             x->x_sfchannels = info.channels;
             x->x_bigendian = info.bigendian;
+            x->x_samplerate = info.samplerate;
             x->x_fd = fd;
             x->x_bytelimit = info.bytelimit;
+            if (fd >= 0 && x->x_resample && info.samplerate > 0 &&
+                info.samplerate != sys_getsr())
+            {
+                    /* build the sample rate converter here in the child
+                    thread since computing the filter bank takes a while.
+                    Its input buffer must hold a few DSP vectors. */
+                int nchannels = (info.channels < x->x_noutlets ?
+                    info.channels : x->x_noutlets);
+                int maxinput = 2 * (x->x_vecsize > MAXVECSIZE ?
+                    x->x_vecsize : MAXVECSIZE);
+                t_sfresample *r;
+                pthread_mutex_unlock(&x->x_mutex);
+                r = sfresample_new(nchannels, info.samplerate, sys_getsr(),
+                    maxinput);
+                pthread_mutex_lock(&x->x_mutex);
+                x->x_resampler = r;
+            }
             if (fd < 0)
             {
                 x->x_fileerror = errno;
@@ -2422,41 +2838,105 @@ static void readsf_tick(t_readsf *x)
     outlet_bang(x->x_bangout);
 }
 
+    /* wait until the FIFO holds a DSP vector's worth of sound or the child
+    thread hits the end of the file.  Called with the mutex locked. */
+static void readsf_wait(t_readsf *x)
+{
+    while (!x->x_eof && x->x_fifohead >= x->x_fifotail &&
+        x->x_fifohead < x->x_fifotail + x->x_sfchannels * x->x_vecsize *
+            x->x_bytespersample - 1)
+    {
+#ifdef DEBUG_SOUNDFILE
+        pute("wait...\n");
+#endif
+        sfread_cond_signal(&x->x_requestcondition);
+        sfread_cond_wait(&x->x_answercondition, &x->x_mutex);
+#ifdef DEBUG_SOUNDFILE
+        pute("done\n");
+#endif
+    }
+}
+
+    /* copy one DSP vector's worth of sample frames from the FIFO into
+    "vecs" starting at "onset".  Returns the number of frames transferred;
+    a short count means we've reached the end of the file.  Called with the
+    mutex locked. */
+static int readsf_xferin(t_readsf *x, int nvecs, t_sample **vecs, long onset)
+{
+    int vecsize, bytespersample, sfchannels, wantbytes, xfersize;
+    readsf_wait(x);
+        /* resync local variables -- bug fix thanks to Shahrokh */
+    vecsize = x->x_vecsize;
+    bytespersample = x->x_bytespersample;
+    sfchannels = x->x_sfchannels;
+    wantbytes = sfchannels * vecsize * bytespersample;
+    if (x->x_eof && x->x_fifohead >= x->x_fifotail &&
+        x->x_fifohead < x->x_fifotail + wantbytes-1)
+    {
+            /* if there's a partial buffer left, copy it out. */
+        xfersize = (x->x_fifohead - x->x_fifotail + 1) /
+            (sfchannels * bytespersample);
+        if (xfersize)
+            soundfile_xferin_sample(sfchannels, nvecs, vecs, onset,
+                (unsigned char *)(x->x_buf + x->x_fifotail), xfersize,
+                    bytespersample, x->x_bigendian);
+        x->x_fifotail = x->x_fifohead;
+        return (xfersize);
+    }
+    soundfile_xferin_sample(sfchannels, nvecs, vecs, onset,
+        (unsigned char *)(x->x_buf + x->x_fifotail), vecsize,
+            bytespersample, x->x_bigendian);
+    x->x_fifotail += wantbytes;
+    if (x->x_fifotail >= x->x_fifosize)
+        x->x_fifotail = 0;
+    if ((--x->x_sigcountdown) <= 0)
+    {
+        sfread_cond_signal(&x->x_requestcondition);
+        x->x_sigcountdown = x->x_sigperiod;
+    }
+    return (vecsize);
+}
+
+    /* fill the outputs through the sample rate converter, pulling vectors
+    from the FIFO as it runs dry.  Returns the number of frames output. */
+static int readsf_xferin_resampled(t_readsf *x, t_sfresample *r)
+{
+    int vecsize = x->x_vecsize, nout = 0, nin, i, j;
+    while (1)
+    {
+        nout += sfresample_run(r, x->x_outvec, nout, 1, vecsize - nout);
+        if (nout >= vecsize || r->r_eof)
+            break;
+            /* the buffer was sized for the vector size when the file was
+            opened; if that has grown since, give up on the file. */
+        nin = (sfresample_room(r) < vecsize ? 0 :
+            readsf_xferin(x, r->r_nchannels, r->r_vec, r->r_fill));
+        sfresample_advance(r, nin);
+        if (nin < vecsize)
+            sfresample_finish(r);
+    }
+        /* zero outputs the soundfile has no channels for */
+    for (i = r->r_nchannels; i < x->x_noutlets; i++)
+        for (j = 0; j < nout; j++)
+            x->x_outvec[i][j] = 0;
+    return (nout);
+}
+
 static t_int *readsf_perform(t_int *w)
 {
     t_readsf *x = (t_readsf *)(w[1]);
-    int vecsize = x->x_vecsize, noutlets = x->x_noutlets, i, j,
-        bytespersample = x->x_bytespersample,
-        bigendian = x->x_bigendian;
+    int vecsize = x->x_vecsize, noutlets = x->x_noutlets, i, j, xfersize;
     t_sample *fp;
     if (x->x_state == STATE_STREAM)
     {
-        int wantbytes, sfchannels = x->x_sfchannels;
         pthread_mutex_lock(&x->x_mutex);
-        wantbytes = sfchannels * vecsize * bytespersample;
-        while (
-            !x->x_eof && x->x_fifohead >= x->x_fifotail &&
-                x->x_fifohead < x->x_fifotail + wantbytes-1)
-        {
-#ifdef DEBUG_SOUNDFILE
-            pute("wait...\n");
-#endif
-            sfread_cond_signal(&x->x_requestcondition);
-            sfread_cond_wait(&x->x_answercondition, &x->x_mutex);
-                /* resync local cariables -- bug fix thanks to Shahrokh */
-            vecsize = x->x_vecsize;
-            bytespersample = x->x_bytespersample;
-            sfchannels = x->x_sfchannels;
-            wantbytes = sfchannels * vecsize * bytespersample;
-            bigendian = x->x_bigendian;
-#ifdef DEBUG_SOUNDFILE
-            pute("done\n");
-#endif
-        }
-        if (x->x_eof && x->x_fifohead >= x->x_fifotail &&
-            x->x_fifohead < x->x_fifotail + wantbytes-1)
+        readsf_wait(x);
+        vecsize = x->x_vecsize;
+        if (x->x_resampler)
+            xfersize = readsf_xferin_resampled(x, x->x_resampler);
+        else xfersize = readsf_xferin(x, noutlets, x->x_outvec, 0);
+        if (xfersize < vecsize)
         {
-            int xfersize;
             if (x->x_fileerror)
             {
                 pd_error(x, "dsp: %s: %s", x->x_filename,
@@ -2467,37 +2947,13 @@ static t_int *readsf_perform(t_int *w)
             clock_delay(x->x_clock, 0);
             x->x_state = STATE_IDLE;
 
-                /* if there's a partial buffer left, copy it out. */
-            xfersize = (x->x_fifohead - x->x_fifotail + 1) /
-                (sfchannels * bytespersample);
-            if (xfersize)
-            {
-                soundfile_xferin_sample(sfchannels, noutlets, x->x_outvec, 0,
-                    (unsigned char *)(x->x_buf + x->x_fifotail), xfersize,
-                        bytespersample, bigendian);
-                vecsize -= xfersize;
-            }
-                /* then zero out the (rest of the) output */
+                /* zero out the rest of the output */
             for (i = 0; i < noutlets; i++)
-                for (j = vecsize, fp = x->x_outvec[i] + xfersize; j--; )
-                    *fp++ = 0;
+                for (j = vecsize - xfersize, fp = x->x_outvec[i] + xfersize;
+                    j--; )
+                        *fp++ = 0;
 
             sfread_cond_signal(&x->x_requestcondition);
-            pthread_mutex_unlock(&x->x_mutex);
-            return (w+2); 
-        }
-
-        soundfile_xferin_sample(sfchannels, noutlets, x->x_outvec, 0,
-            (unsigned char *)(x->x_buf + x->x_fifotail), vecsize,
-                bytespersample, bigendian);
-        
-        x->x_fifotail += wantbytes;
-        if (x->x_fifotail >= x->x_fifosize)
-            x->x_fifotail = 0;
-        if ((--x->x_sigcountdown) <= 0)
-        {
-            sfread_cond_signal(&x->x_requestcondition);
-            x->x_sigcountdown = x->x_sigperiod;
         }
         pthread_mutex_unlock(&x->x_mutex);
     }
@@ -2537,14 +2993,24 @@ static void readsf_float(t_readsf *x, t_floatarg f)
 }
 
     /* open method.  Called as:
-    open filename [skipframes headersize channels bytespersamp endianness]
+    open [-resample] filename [skipframes headersize channels bytespersamp
+        endianness]
         (if headersize is zero, header is taken to be automatically
-        detected; thus, use the special "-1" to mean a truly headerless file.)
+        detected; thus, use the special "-1" to mean a truly headerless file.
+        The "-resample" flag converts the file to Pd's sample rate.)
     */
 
 static void readsf_open(t_readsf *x, t_symbol *s, int argc, t_atom *argv)
 {
-    t_symbol *filesym = atom_getsymbolarg(0, argc, argv);
+    int resample = 0;
+    t_symbol *filesym;
+    if (argc && argv->a_type == A_SYMBOL &&
+        !strcmp(argv->a_w.w_symbol->s_name, "-resample"))
+    {
+        resample = 1;
+        argc--; argv++;
+    }
+    filesym = atom_getsymbolarg(0, argc, argv);
     t_float onsetframes = atom_getfloatarg(1, argc, argv);
     t_float headerbytes = atom_getfloatarg(2, argc, argv);
     t_float channels = atom_getfloatarg(3, argc, argv);
@@ -2555,6 +3021,7 @@ static void readsf_open(t_readsf *x, t_symbol *s, int argc, t_atom *argv)
     pthread_mutex_lock(&x->x_mutex);
     x->x_requestcode = REQUEST_OPEN;
     x->x_filename = filesym->s_name;
+    x->x_resample = resample;
     x->x_fifotail = 0;
     x->x_fifohead = 0;
     if (*endian->s_name == 'b')
@@ -2620,6 +3087,8 @@ static void readsf_free(t_readsf *x)
     pthread_cond_destroy(&x->x_answercondition);
     pthread_mutex_destroy(&x->x_mutex);
     freebytes(x->x_buf, x->x_bufsize);
+    if (x->x_resampler)
+        sfresample_free(x->x_resampler);
     clock_free(x->x_clock);
 }
 
@@ -15,11 +15,41 @@
 #include "m_imp.h"
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define HAVE_BACKTRACE
+#include <execinfo.h>
+#endif
 
 extern t_class *vinlet_class, *voutlet_class, *canvas_class, *text_class;
 t_float *obj_findsignalscalar(t_object *x, int m);
 static int ugen_loud;
 
+    /* per-instance state of the DSP graph and call list */
+struct _instanceugen
+{
+    int u_phase;                        /* DSP tick count */
+    int u_sortno;                       /* incremented each time DSP starts */
+    struct _dspcontext *u_context;      /* context being built */
+    t_signal *u_freelist[MAXLOGSIG+1];  /* reusable signals by size */
+    t_signal *u_freeborrowed;           /* reusable "borrowed" signals */
+    t_object **u_chainowner;            /* owner of each DSP chain entry */
+    int u_chainownersize;
+    t_object *u_currentowner;           /* object whose dsp method runs */
+};
+
+#define THIS (pd_this->pd_ugen)
+
+struct _instanceugen *ugen_newpdinstance(void)
+{
+    return ((struct _instanceugen *)getbytes(sizeof(struct _instanceugen)));
+}
+
+void ugen_freepdinstance(struct _instanceugen *x)
+{
+    freebytes(x, sizeof(*x));
+}
+
 EXTERN_STRUCT _vinlet;
 EXTERN_STRUCT _voutlet;
 
@@ -98,7 +128,6 @@ ONLY run when the block is switched off; in this case the epilog code simply
 copies zeros to all signal outlets.
 */
 
-static int dsp_phase;
 static t_class *block_class;
 
 typedef struct _block
@@ -295,6 +324,14 @@ static t_int dsp_done(t_int *w)
     return (0);
 }
 
+static void dsp_setowner(int onset, int newsize)
+{
+    THIS->u_chainowner = (t_object **)resizebytes(THIS->u_chainowner,
+        THIS->u_chainownersize * sizeof(t_object *), newsize * sizeof(t_object *));
+    THIS->u_chainownersize = newsize;
+    THIS->u_chainowner[onset] = THIS->u_currentowner;
+}
+
 void dsp_add(t_perfroutine f, int n, ...)
 {
     int newsize = pd_this->pd_dspchainsize + n+1, i;
@@ -316,6 +353,7 @@ void dsp_add(t_perfroutine f, int n, ...)
     }
     va_end(ap);
     pd_this->pd_dspchain[newsize-1] = (t_int)dsp_done;
+    dsp_setowner(pd_this->pd_dspchainsize-1, newsize);
     pd_this->pd_dspchainsize = newsize;
 }
 
@@ -330,16 +368,139 @@ void dsp_addv(t_perfroutine f, int n, t_int *vec)
     for (i = 0; i < n; i++)
         pd_this->pd_dspchain[pd_this->pd_dspchainsize + i] = vec[i];
     pd_this->pd_dspchain[newsize-1] = (t_int)dsp_done;
+    dsp_setowner(pd_this->pd_dspchainsize-1, newsize);
     pd_this->pd_dspchainsize = newsize;
 }
 
+/* -------------------- real-time checking ------------------ */
+
+/* "pd rtcheck 1" (or the -rtcheck flag) runs the DSP chain with sys_inaudio
+set, so that getbytes(), sys_lock(), post() and sys_open() and friends can
+complain when a perform routine calls them.  Each distinct offender (the
+object, the call, and the call stack) is only reported once. */
+
+#define RTCHECK_NSEEN 1024
+#define RTCHECK_NFRAMES 16
+
+int sys_rtcheck;
+PERTHREAD int sys_inaudio;
+static PERTHREAD t_int *rtcheck_ip;     /* perform routine that's running */
+static PERTHREAD int rtcheck_reporting;
+static unsigned long rtcheck_seen[RTCHECK_NSEEN];
+static int rtcheck_nseen;
+
+static void dsp_tick_checked(void)
+{
+    t_int *ip;
+    sys_inaudio = 1;
+    for (ip = pd_this->pd_dspchain; ip; )
+    {
+        rtcheck_ip = ip;
+        ip = (*(t_perfroutine)(*ip))(ip);
+    }
+    rtcheck_ip = 0;
+    sys_inaudio = 0;
+}
+
+    /* add a key to the set of reported violations; return 0 if it was
+    already there (or the set is full) */
+static int rtcheck_addseen(unsigned long key)
+{
+    int i, n;
+    if (!key)
+        key = 1;
+    for (i = key % RTCHECK_NSEEN, n = 0; n < RTCHECK_NSEEN;
+        i = (i + 1) % RTCHECK_NSEEN, n++)
+    {
+        if (rtcheck_seen[i] == key)
+            return (0);
+        if (!rtcheck_seen[i])
+        {
+            if (++rtcheck_nseen == RTCHECK_NSEEN)
+            {
+                post("rtcheck: too many violations; not reporting any more");
+                return (0);
+            }
+            rtcheck_seen[i] = key;
+            return (1);
+        }
+    }
+    return (0);
+}
+
+static unsigned long rtcheck_hash(unsigned long h, const void *p)
+{
+    return ((h ^ (unsigned long)p) * 16777619UL);
+}
+
+void sys_rtviolation(const char *what)
+{
+    t_object *owner = 0;
+    t_int perf = 0;
+    unsigned long key;
+#ifdef HAVE_BACKTRACE
+    void *frames[RTCHECK_NFRAMES];
+    int nframes, i;
+#endif
+    if (!sys_inaudio || rtcheck_reporting)
+        return;
+        /* the report itself posts and allocates */
+    rtcheck_reporting = 1;
+    if (rtcheck_ip)
+    {
+        int onset = (int)(rtcheck_ip - pd_this->pd_dspchain);
+        perf = *rtcheck_ip;
+        if (onset >= 0 && onset < THIS->u_chainownersize)
+            owner = THIS->u_chainowner[onset];
+    }
+    key = rtcheck_hash(rtcheck_hash(2166136261UL, what),
+        (void *)perf);
+#ifdef HAVE_BACKTRACE
+    nframes = backtrace(frames, RTCHECK_NFRAMES);
+    for (i = 0; i < nframes; i++)
+        key = rtcheck_hash(key, frames[i]);
+#endif
+    if (rtcheck_addseen(key))
+    {
+        if (owner)
+            pd_error(owner, "rtcheck: %s called from the DSP chain by %s",
+                what, class_getname(pd_class(&owner->ob_pd)));
+        else error("rtcheck: %s called from the DSP chain (routine %lx)",
+            what, (unsigned long)perf);
+#ifdef HAVE_BACKTRACE
+        {
+            char **names = backtrace_symbols(frames, nframes);
+                /* skip sys_rtviolation() itself */
+            for (i = 1; names && i < nframes; i++)
+                post("    %s", names[i]);
+            free(names);
+        }
+#endif
+    }
+    rtcheck_reporting = 0;
+}
+
+void glob_rtcheck(void *dummy, t_floatarg f)
+{
+    sys_rtcheck = (f != 0);
+    if (sys_rtcheck)
+    {
+        memset(rtcheck_seen, 0, sizeof(rtcheck_seen));
+        rtcheck_nseen = 0;
+    }
+    post("real-time checking %s", (sys_rtcheck ? "on" : "off"));
+}
+
 void dsp_tick(void)
 {
     if (pd_this->pd_dspchain)
     {
         t_int *ip;
-        for (ip = pd_this->pd_dspchain; ip; ) ip = (*(t_perfroutine)(*ip))(ip);
-        dsp_phase++;
+        if (sys_rtcheck)
+            dsp_tick_checked();
+        else for (ip = pd_this->pd_dspchain; ip; )
+            ip = (*(t_perfroutine)(*ip))(ip);
+        THIS->u_phase++;
     }
 }
 
@@ -357,11 +518,6 @@ int ilog2(int n)
     return (r);
 }
 
-    /* list of signals which can be reused, sorted by buffer size */
-static t_signal *signal_freelist[MAXLOGSIG+1];
-    /* list of reusable "borrowed" signals (which don't own sample buffers) */
-static t_signal *signal_freeborrowed;
-
     /* call this when DSP is stopped to free all the signals */
 void signal_cleanup(void)
 {
@@ -375,8 +531,8 @@ void signal_cleanup(void)
         t_freebytes(sig, sizeof *sig);
     }
     for (i = 0; i <= MAXLOGSIG; i++)
-        signal_freelist[i] = 0;
-    signal_freeborrowed = 0;
+        THIS->u_freelist[i] = 0;
+    THIS->u_freeborrowed = 0;
 }
 
     /* mark the signal "reusable." */
@@ -385,7 +541,7 @@ void signal_makereusable(t_signal *sig)
     int logn = ilog2(sig->s_vecsize);
 #if 1
     t_signal *s5;
-    for (s5 = signal_freeborrowed; s5; s5 = s5->s_nextfree)
+    for (s5 = THIS->u_freeborrowed; s5; s5 = s5->s_nextfree)
     {
         if (s5 == sig)
         {
@@ -393,7 +549,7 @@ void signal_makereusable(t_signal *sig)
             return;
         }
     }
-    for (s5 = signal_freelist[logn]; s5; s5 = s5->s_nextfree)
+    for (s5 = THIS->u_freelist[logn]; s5; s5 = s5->s_nextfree)
     {
         if (s5 == sig)
         {
@@ -413,16 +569,16 @@ void signal_makereusable(t_signal *sig)
         s2->s_refcount--;
         if (!s2->s_refcount)
             signal_makereusable(s2);
-        sig->s_nextfree = signal_freeborrowed;
-        signal_freeborrowed = sig;
+        sig->s_nextfree = THIS->u_freeborrowed;
+        THIS->u_freeborrowed = sig;
     }
     else
     {
             /* if it's a real signal (not borrowed), put it on the free list
                 so we can reuse it. */
-        if (signal_freelist[logn] == sig) bug("signal_free 2");
-        sig->s_nextfree = signal_freelist[logn];
-        signal_freelist[logn] = sig;
+        if (THIS->u_freelist[logn] == sig) bug("signal_free 2");
+        sig->s_nextfree = THIS->u_freelist[logn];
+        THIS->u_freelist[logn] = sig;
     }
 }
 
@@ -441,10 +597,10 @@ t_signal *signal_new(int n, t_float sr)
             vecsize *= 2;
         if (logn > MAXLOGSIG)
             bug("signal buffer too large");
-        whichlist = signal_freelist + logn;
+        whichlist = THIS->u_freelist + logn;
     }
     else
-        whichlist = &signal_freeborrowed;
+        whichlist = &THIS->u_freeborrowed;
 
         /* first try to reclaim one from the free list */
     if ((ret = *whichlist))
@@ -553,14 +709,11 @@ struct _dspcontext
 
 #define t_dspcontext struct _dspcontext
 
-static int ugen_sortno = 0;
-static t_dspcontext *ugen_currentcontext;
-
     /* get a new signal for the current context - used by clone~ object */
 t_signal *signal_newfromcontext(int borrowed)
 {
-    return (signal_new((borrowed? 0 : ugen_currentcontext->dc_calcsize),
-        ugen_currentcontext->dc_srate));
+    return (signal_new((borrowed? 0 : THIS->u_context->dc_calcsize),
+        THIS->u_context->dc_srate));
 }
 
 void ugen_stop(void)
@@ -571,6 +724,13 @@ void ugen_stop(void)
             pd_this->pd_dspchainsize * sizeof (t_int));
         pd_this->pd_dspchain = 0;
     }
+    if (THIS->u_chainowner)
+    {
+        freebytes(THIS->u_chainowner,
+            THIS->u_chainownersize * sizeof(t_object *));
+        THIS->u_chainowner = 0;
+        THIS->u_chainownersize = 0;
+    }
     signal_cleanup();
 
 }
@@ -578,16 +738,16 @@ void ugen_stop(void)
 void ugen_start(void)
 {
     ugen_stop();
-    ugen_sortno++;
+    THIS->u_sortno++;
     pd_this->pd_dspchain = (t_int *)getbytes(sizeof(*pd_this->pd_dspchain));
     pd_this->pd_dspchain[0] = (t_int)dsp_done;
     pd_this->pd_dspchainsize = 1;
-    if (ugen_currentcontext) bug("ugen_start");
+    if (THIS->u_context) bug("ugen_start");
 }
 
 int ugen_getsortno(void)
 {
-    return (ugen_sortno);
+    return (THIS->u_sortno);
 }
 
 #if 1
@@ -601,13 +761,13 @@ void glob_foo(void *dummy, t_symbol *s, int argc, t_atom *argv)
     post("used signals %d", count);
     for (i = 0; i < MAXLOGSIG; i++)
     {
-        for (count = 0, sig = signal_freelist[i]; sig;
+        for (count = 0, sig = THIS->u_freelist[i]; sig;
             count++, sig = sig->s_nextfree)
                 ;
         if (count)
             post("size %d: free %d", (1 << i), count);
     }
-    for (count = 0, sig = signal_freeborrowed; sig;
+    for (count = 0, sig = THIS->u_freeborrowed; sig;
         count++, sig = sig->s_nextfree)
             ;
     post("free borrowed %d", count);
@@ -634,8 +794,8 @@ t_dspcontext *ugen_start_graph(int toplevel, t_signal **sp,
     dc->dc_iosigs = sp;
     dc->dc_ninlets = ninlets;
     dc->dc_noutlets = noutlets;
-    dc->dc_parentcontext = ugen_currentcontext;
-    ugen_currentcontext = dc;
+    dc->dc_parentcontext = THIS->u_context;
+    THIS->u_context = dc;
     return (dc);
 }
 
@@ -746,6 +906,7 @@ static void ugen_doit(t_dspcontext *dc, t_ugenbox *u)
 
     if (ugen_loud) post("doit %s %d %d", class_getname(class), nofreesigs,
         nonewsigs);
+    THIS->u_currentowner = u->u_obj;
     for (i = 0, uin = u->u_in; i < u->u_nin; i++, uin++)
     {
         if (!uin->i_nconnect)
@@ -801,6 +962,7 @@ static void ugen_doit(t_dspcontext *dc, t_ugenbox *u)
         routine must fill in "borrowed" signal outputs in case it's either
         a subcanvas or a signal inlet. */
     mess1(&u->u_obj->ob_pd, gensym("dsp"), insig);
+    THIS->u_currentowner = 0;
 
         /* if any output signals aren't connected to anyone, free them
         now; otherwise they'll either get freed when the reference count
@@ -959,7 +1121,7 @@ void ugen_done_graph(t_dspcontext *dc)
         if (frequency < 1) frequency = 1;
         blk->x_frequency = frequency;
         blk->x_period = period;
-        blk->x_phase = dsp_phase & (period - 1);
+        blk->x_phase = THIS->u_phase & (period - 1);
         if (! parent_context || (realoverlap != 1) ||
             (vecsize != parent_vecsize) ||
                 (downsample != 1) || (upsample != 1))
@@ -1025,11 +1187,11 @@ void ugen_done_graph(t_dspcontext *dc)
 
         if (pd_class(zz) == vinlet_class)
             vinlet_dspprolog((struct _vinlet *)zz,
-                insigs, vecsize, calcsize, dsp_phase, period, frequency,
+                insigs, vecsize, calcsize, THIS->u_phase, period, frequency,
                     downsample, upsample, reblock, switched);
         else if (pd_class(zz) == voutlet_class)
             voutlet_dspprolog((struct _voutlet *)zz,
-                outsigs, vecsize, calcsize, dsp_phase, period, frequency,
+                outsigs, vecsize, calcsize, THIS->u_phase, period, frequency,
                     downsample, upsample, reblock, switched);
     }
     chainblockbegin = pd_this->pd_dspchainsize;
@@ -1104,7 +1266,7 @@ void ugen_done_graph(t_dspcontext *dc)
             t_signal **iosigs = dc->dc_iosigs;
             if (iosigs) iosigs += dc->dc_ninlets;
             voutlet_dspepilog((struct _voutlet *)zz,
-                iosigs, vecsize, calcsize, dsp_phase, period, frequency,
+                iosigs, vecsize, calcsize, THIS->u_phase, period, frequency,
                     downsample, upsample, reblock, switched);
         }
     }
@@ -1148,19 +1310,19 @@ void ugen_done_graph(t_dspcontext *dc)
         dc->dc_ugenlist = u->u_next;
         freebytes(u, sizeof *u);
     }
-    if (ugen_currentcontext == dc)
-        ugen_currentcontext = dc->dc_parentcontext;
-    else bug("ugen_currentcontext");
+    if (THIS->u_context == dc)
+        THIS->u_context = dc->dc_parentcontext;
+    else bug("THIS->u_context");
     freebytes(dc, sizeof(*dc));
 
 }
 
 t_signal *ugen_getiosig(int index, int inout)
 {
-    if (!ugen_currentcontext) bug("ugen_getiosig");
-    if (ugen_currentcontext->dc_toplevel) return (0);
-    if (inout) index += ugen_currentcontext->dc_ninlets;
-    return (ugen_currentcontext->dc_iosigs[index]);
+    if (!THIS->u_context) bug("ugen_getiosig");
+    if (THIS->u_context->dc_toplevel) return (0);
+    if (inout) index += THIS->u_context->dc_ninlets;
+    return (THIS->u_context->dc_iosigs[index]);
 }
 
 /* ------------------------ samplerate~~ -------------------------- */
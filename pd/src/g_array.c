@@ -51,7 +51,7 @@ t_array *array_new(t_symbol *templatesym, t_gpointer *parent)
     template = template_findbyname(templatesym);
     x->a_templatesym = templatesym;
     x->a_n = 1;
-    x->a_elemsize = sizeof(t_word) * template->t_n;
+    x->a_elemsize = template_elemsize(template);
     x->a_vec = (char *)getbytes(x->a_elemsize);
         /* note here we blithely copy a gpointer instead of "setting" a
         new one; this gpointer isn't accounted for and needn't be since
@@ -71,7 +71,7 @@ void array_resize(t_array *x, int n)
     if (n < 1)
         n = 1;
     oldn = x->a_n;
-    elemsize = sizeof(t_word) * template->t_n;
+    elemsize = x->a_elemsize;
 
     x->a_vec = (char *)resizebytes(x->a_vec, oldn * elemsize, n * elemsize);
     x->a_n = n;
@@ -1041,6 +1041,7 @@ static int array_doclick_element(t_array *array, t_glist *glist,
         &elemtemplate, &elemsize, xfield, yfield, wfield,
             &xonset, &yonset, &wonset))
                 return (0);
+    elemsize = array->a_elemsize;
         /* if it has more than 2000 points, just check 300 of them. */
     if (array->a_n < 2000)
         incr = 1;
@@ -1087,6 +1088,7 @@ int array_doclick(t_array *array, t_glist *glist, t_scalar *sc, t_array *ap,
         int incr = (array->a_n <= 2000 ? 1 : array->a_n / 1000);
         t_float pxpix1 = 0.0, pxpix2 = 0.0, pypix = 0.0, pwpix = 0.0,
           dy, dy2, dy3;
+        elemsize = array->a_elemsize;
         for (i = 0; i < array->a_n; i += incr)
         {
             array_getcoordinate(glist, (char *)(array->a_vec) + i * elemsize,
@@ -1295,6 +1297,7 @@ static void array_getrect(t_array *array, t_glist *glist,
         &elemtemplate, &elemsize, 0, 0, 0, &xonset, &yonset, &wonset))
     {
         int incr;
+        elemsize = array->a_elemsize;
             /* if it has more than 2000 points, just check 300 of them. */
         if (array->a_n < 2000)
             incr = 1;
@@ -1414,7 +1417,8 @@ void garray_savecontentsto(t_garray *x, t_binbuf *b)
                 chunk = ARRAYWRITECHUNKSIZE;
             binbuf_addv(b, "si", gensym("#A"), n2);
             for (i = 0; i < chunk; i++)
-                binbuf_addv(b, "f", ((t_word *)(array->a_vec))[n2+i].w_float);
+                binbuf_addv(b, "f", *(t_float *)(array->a_vec +
+                    array->a_elemsize * (n2+i)));
             binbuf_addv(b, ";");
             n2 += chunk;
         }
@@ -1461,7 +1465,8 @@ void garray_save(t_gobj *z, t_binbuf *b)
                 chunk = ARRAYWRITECHUNKSIZE;
             binbuf_addv(b, "si", gensym("#A"), n2);
             for (i = 0; i < chunk; i++)
-                binbuf_addv(b, "f", ((t_word *)(array->a_vec))[n2+i].w_float);
+                binbuf_addv(b, "f", *(t_float *)(array->a_vec +
+                    array->a_elemsize * (n2+i)));
             binbuf_addv(b, ";");
             n2 += chunk;
         }
@@ -1585,10 +1590,12 @@ char *garray_vec(t_garray *x) /* get the contents */
     return ((char *)(array->a_vec));
 }
 
-    /* routine that checks if we're just an array of floats and if
-    so returns the goods */
+    /* routine that checks if we're just an array of floats and if so
+    returns the goods.  Arrays of the plain float template keep their points
+    as bare t_floats, so the points are *stride floats apart: 1 for those
+    and sizeof(t_word)/sizeof(t_float) for arrays widened to t_words. */
 
-int garray_getfloatwords(t_garray *x, int *size, t_word **vec)
+int garray_getfloatvec(t_garray *x, int *size, t_float **vec, int *stride)
 {
     int yonset, elemsize;
     t_array *a = garray_getarray_floatonly(x, &yonset, &elemsize);
@@ -1597,20 +1604,96 @@ int garray_getfloatwords(t_garray *x, int *size, t_word **vec)
         error("%s: needs floating-point 'y' field", x->x_realname->s_name);
         return (0);
     }
-    else if (elemsize != sizeof(t_word))
+    else if (elemsize != sizeof(t_word) && elemsize != sizeof(t_float))
     {
         error("%s: has more than one field", x->x_realname->s_name);
         return (0);
     }
-    *size = garray_npoints(x);
-    *vec =  (t_word *)garray_vec(x);
+    *size = a->a_n;
+    *vec = (t_float *)a->a_vec;
+    *stride = elemsize / sizeof(t_float);
     return (1);
 }
-    /* older, non-64-bit safe version, supplied for older externs */
+
+    /* points given up by arrays widened to t_words.  DSP routines may still
+    be reading them, so they're kept until the DSP chain has been rebuilt. */
+typedef struct _garrayleftover
+{
+    struct _garrayleftover *l_next;
+    char *l_vec;
+    int l_size;
+} t_garrayleftover;
+
+static t_garrayleftover *garray_leftovers;
+static t_clock *garray_leftoverclock;
+static int garray_leftoverdsp;
+
+static void garray_freeleftovers(void *dummy)
+{
+    if (garray_leftoverdsp)
+    {
+        garray_leftoverdsp = 0;
+        canvas_update_dsp();
+    }
+    while (garray_leftovers)
+    {
+        t_garrayleftover *l = garray_leftovers;
+        garray_leftovers = l->l_next;
+        freebytes(l->l_vec, l->l_size);
+        freebytes(l, sizeof(*l));
+    }
+}
+
+    /* give a bare-float array t_words to live in.  This can happen inside a
+    "dsp" method, so the DSP update is left for the clock to do. */
+static void garray_widen(t_garray *x, t_array *a)
+{
+    t_word *wp = (t_word *)getbytes(a->a_n * sizeof(t_word));
+    t_garrayleftover *l = (t_garrayleftover *)getbytes(sizeof(*l));
+    int i;
+    for (i = 0; i < a->a_n; i++)
+        wp[i].w_float = ((t_float *)a->a_vec)[i];
+    l->l_vec = a->a_vec;
+    l->l_size = a->a_n * a->a_elemsize;
+    l->l_next = garray_leftovers;
+    garray_leftovers = l;
+    a->a_vec = (char *)wp;
+    a->a_elemsize = sizeof(t_word);
+    a->a_valid = ++glist_valid;
+    if (x->x_usedindsp)
+        garray_leftoverdsp = 1;
+    if (!garray_leftoverclock)
+        garray_leftoverclock = clock_new(0, (t_method)garray_freeleftovers);
+    clock_delay(garray_leftoverclock, 0);
+}
+
+    /* t_word version for code that predates bare-float storage; an array
+    stored as bare floats is widened to t_words for good the first time. */
+int garray_getfloatwords(t_garray *x, int *size, t_word **vec)
+{
+    int stride;
+    t_float *fp;
+    if (!garray_getfloatvec(x, size, &fp, &stride))
+        return (0);
+    if (stride * sizeof(t_float) != sizeof(t_word))
+    {
+        t_array *a = garray_getarray(x);
+        garray_widen(x, a);
+        fp = (t_float *)a->a_vec;
+    }
+    *vec = (t_word *)fp;
+    return (1);
+}
+
+    /* older version, supplied for older externs; only safe in the 64-bit
+    version for arrays that haven't been widened to t_words. */
 
 int garray_getfloatarray(t_garray *x, int *size, t_float **vec)
 {
-    if (sizeof(t_word) != sizeof(t_float))
+    int stride;
+    if (!garray_getfloatvec(x, size, vec, &stride))
+        return (0);
+    if (stride != 1)
     {
         static int warned;
         if (!warned)
@@ -1618,7 +1701,7 @@ int garray_getfloatarray(t_garray *x, int *size, t_float **vec)
  "warning: extern using garray_getfloatarray() won't work in 64-bit version");
         warned = 1;
     }
-    return (garray_getfloatwords(x, size, (t_word **)vec));
+    return (1);
 }
 
     /* set the "saveit" flag */
@@ -1904,7 +1987,7 @@ static void garray_write(t_garray *x, t_symbol *filename)
     for (i = 0; i < array->a_n; i++)
     {
         if (fprintf(fd, "%g\n",
-            *(t_float *)(((array->a_vec + sizeof(t_word) * i)) + yonset)) < 1)
+            *(t_float *)(((array->a_vec + elemsize * i)) + yonset)) < 1)
         {
             post("%s: write error", filename->s_name);
             break;
@@ -319,7 +319,7 @@ typedef struct _template
 struct _array
 {
     int a_n;            /* number of elements */
-    int a_elemsize;     /* size in bytes; LATER get this from template */
+    int a_elemsize;     /* size in bytes; see template_elemsize() */
     char *a_vec;        /* array of elements */
     t_symbol *a_templatesym;    /* template for elements */
     int a_valid;        /* protection against stale pointers into array */
@@ -733,6 +733,7 @@ EXTERN int array_getfields(t_symbol *elemtemplatesym,
 EXTERN t_template *template_new(t_symbol *sym, int argc, t_atom *argv);
 EXTERN void template_free(t_template *x);
 EXTERN int template_match(t_template *x1, t_template *x2);
+EXTERN int template_elemsize(t_template *x);
 EXTERN int template_find_field(t_template *x, t_symbol *name, int *p_onset,
     int *p_type, t_symbol **p_arraytype);
 EXTERN t_float template_getfloat(t_template *x, t_symbol *fieldname, t_word *wp,
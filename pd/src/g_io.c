@@ -16,9 +16,27 @@ life elsewhere. */
 #include "m_pd.h"
 #include "g_canvas.h"
 #include <string.h>
+#include <stdlib.h>
 void signal_setborrowed(t_signal *sig, t_signal *sig2);
 void signal_makereusable(t_signal *sig);
 
+    /* "fir" or "fir<n>" selects band-limited resampling with n taps per
+    sample (see d_resample.c); anything else gives the default method 0. */
+static int updown_firmethod(t_symbol *s)
+{
+    int taps;
+    if (strncmp(s->s_name, "fir", 3))
+        return (0);
+    if (!s->s_name[3])
+        return (RESAMPLE_FIRDEFAULT);
+    taps = atoi(s->s_name + 3);
+    if (taps < RESAMPLE_FIRMIN)
+        taps = RESAMPLE_FIRMIN;
+    else if (taps > 1024)
+        taps = 1024;
+    return (taps);
+}
+
 /* ------------------------- vinlet -------------------------- */
 t_class *vinlet_class;
 
@@ -29,10 +47,8 @@ typedef struct _vinlet
     t_inlet *x_inlet;
     int x_bufsize;
     t_float *x_buf;         /* signal buffer; zero if not a signal */
-    t_float *x_endbuf;
-    t_float *x_fill;
-    t_float *x_read;
-    int x_hop;
+    int x_fill;             /* next to write into buffer in prolog code */
+    int x_read;             /* offset from x_fill of next to read out */
   /* if not reblocking, the next slot communicates the parent's inlet
      signal from the prolog to the DSP routine: */
     t_signal *x_directsignal;
@@ -84,6 +100,8 @@ static void vinlet_anything(t_vinlet *x, t_symbol *s, int argc, t_atom *argv)
 static void vinlet_free(t_vinlet *x)
 {
     canvas_rminlet(x->x_canvas, x->x_inlet);
+    if (x->x_buf)
+        t_freebytes(x->x_buf, 2 * x->x_bufsize * sizeof(*x->x_buf));
     resample_free(&x->x_updown);
 }
 
@@ -99,20 +117,24 @@ int vinlet_issignal(t_vinlet *x)
     return (x->x_buf != 0);
 }
 
+    /* The reblocking buffer is a ring of x_bufsize samples which the
+    prolog code writes twice, once into each half of an array of twice that
+    size.  The last x_bufsize samples written are then always contiguous,
+    starting at the write position, so the prolog never has to shift the
+    buffer down by a hop; with heavy overlap that shift was most of the
+    cost of reblocking. */
 t_int *vinlet_perform(t_int *w)
 {
     t_vinlet *x = (t_vinlet *)(w[1]);
     t_float *out = (t_float *)(w[2]);
-    int n = (int)(w[3]);
-    t_float *in = x->x_read;
-#if 0
-    if (tot < 5) post("-in %zx out %zx n %d", in, out, n);
-    if (tot < 5) post("-buf %zx endbuf %zx", x->x_buf, x->x_endbuf);
-    if (tot < 5) post("in[0] %f in[1] %f in[2] %f", in[0], in[1], in[2]);
-#endif
-    while (n--) *out++ = *in++;
-    if (in == x->x_endbuf) in = x->x_buf;
-    x->x_read = in;
+    int n = (int)(w[3]), read = x->x_fill + x->x_read;
+    t_float *in;
+    if (read >= x->x_bufsize)
+        read -= x->x_bufsize;
+    in = x->x_buf + read;
+    memcpy(out, in, n * sizeof(*out));
+    if ((x->x_read += n) >= x->x_bufsize)
+        x->x_read = 0;
     return (w+4);
 }
 
@@ -143,31 +165,22 @@ static void vinlet_dsp(t_vinlet *x, t_signal **sp)
     else
     {
         dsp_add(vinlet_perform, 3, x, outsig->s_vec, outsig->s_vecsize);
-        x->x_read = x->x_buf;
+        x->x_read = 0;
     }
 }
 
-    /* prolog code: loads buffer from parent patch */
+    /* prolog code: loads buffer from parent patch.  The buffer size is a
+    multiple of n so a write never straddles the end of the ring. */
 t_int *vinlet_doprolog(t_int *w)
 {
     t_vinlet *x = (t_vinlet *)(w[1]);
     t_float *in = (t_float *)(w[2]);
-    int n = (int)(w[3]);
-    t_float *out = x->x_fill;
-    if (out == x->x_endbuf)
-    {
-      t_float *f1 = x->x_buf, *f2 = x->x_buf + x->x_hop;
-        int nshift = x->x_bufsize - x->x_hop;
-        out -= x->x_hop;
-        while (nshift--) *f1++ = *f2++;
-    }
-#if 0
-    if (tot < 5) post("in %zx out %zx n %zx", in, out, n), tot++;
-    if (tot < 5) post("in[0] %f in[1] %f in[2] %f", in[0], in[1], in[2]);
-#endif
-
-    while (n--) *out++ = *in++;
-    x->x_fill = out;
+    int n = (int)(w[3]), fill = x->x_fill;
+    memcpy(x->x_buf + fill, in, n * sizeof(*in));
+    memcpy(x->x_buf + x->x_bufsize + fill, in, n * sizeof(*in));
+    if ((fill += n) >= x->x_bufsize)
+        fill = 0;
+    x->x_fill = fill;
     return (w+4);
 }
 
@@ -189,15 +202,11 @@ void vinlet_dspprolog(struct _vinlet *x, t_signal **parentsigs,
         parent. */
     if (reblock)
     {
-        int parentvecsize, bufsize, oldbufsize, prologphase;
+        int parentvecsize, bufsize, oldbufsize;
         int re_parentvecsize; /* resampled parentvectorsize */
             /* this should never happen: */
         if (!x->x_buf) return;
 
-            /* the prolog code counts from 0 to period-1; the
-            phase is backed up by one so that AFTER the prolog code
-            runs, the "x_fill" phase is in sync with the "x_read" phase. */
-        prologphase = (phase - 1) & (period - 1);
         if (parentsigs)
         {
             insig = parentsigs[inlet_getsignalindex(x->x_inlet)];
@@ -216,20 +225,18 @@ void vinlet_dspprolog(struct _vinlet *x, t_signal **parentsigs,
         if (bufsize != (oldbufsize = x->x_bufsize))
         {
             t_float *buf = x->x_buf;
-            t_freebytes(buf, oldbufsize * sizeof(*buf));
-            buf = (t_float *)t_getbytes(bufsize * sizeof(*buf));
-            memset((char *)buf, 0, bufsize * sizeof(*buf));
+            t_freebytes(buf, 2 * oldbufsize * sizeof(*buf));
+            buf = (t_float *)t_getbytes(2 * bufsize * sizeof(*buf));
+            memset((char *)buf, 0, 2 * bufsize * sizeof(*buf));
             x->x_bufsize = bufsize;
-            x->x_endbuf = buf + bufsize;
             x->x_buf = buf;
         }
+            /* the window read by the subpatch always ends at the last
+            sample written, so unlike the outlet there's no phase to set up
+            here; just start writing at the top of the ring. */
+        x->x_fill = 0;
         if (parentsigs)
         {
-            x->x_hop = period * re_parentvecsize;
-
-            x->x_fill = x->x_endbuf -
-              (x->x_hop - prologphase * re_parentvecsize);
-
             if (upsample * downsample == 1)
                     dsp_add(vinlet_doprolog, 3, x, insig->s_vec,
                         re_parentvecsize);
@@ -245,7 +252,7 @@ void vinlet_dspprolog(struct _vinlet *x, t_signal **parentsigs,
             if (!insig->s_refcount)
                 signal_makereusable(insig);
         }
-        else memset((char *)(x->x_buf), 0, bufsize * sizeof(*x->x_buf));
+        else memset((char *)(x->x_buf), 0, 2 * bufsize * sizeof(*x->x_buf));
         x->x_directsignal = 0;
     }
     else
@@ -261,7 +268,7 @@ static void *vinlet_newsig(t_symbol *s)
     t_vinlet *x = (t_vinlet *)pd_new(vinlet_class);
     x->x_canvas = canvas_getcurrent();
     x->x_inlet = canvas_addinlet(x->x_canvas, &x->x_obj.ob_pd, &s_signal);
-    x->x_endbuf = x->x_buf = (t_float *)getbytes(0);
+    x->x_buf = (t_float *)getbytes(0);
     x->x_bufsize = 0;
     x->x_directsignal = 0;
     x->x_fwdout = 0;
@@ -275,10 +282,11 @@ static void *vinlet_newsig(t_symbol *s)
      * maybe indeces would be better...
      *
      * up till now we provide several upsampling methods and 1 single downsampling method (no filtering !)
+     * besides "fir", which low-pass filters in both directions
      */
     if (s == gensym("hold"))x->x_updown.method=1;     /* up: sample and hold */
     else if (s == gensym("lin"))x->x_updown.method=2; /* up: linear interpolation */
-    else x->x_updown.method=0;                        /* up: zero-padding */
+    else x->x_updown.method=updown_firmethod(s);      /* up: zero-padding */
 
     if (s == gensym("fwd"))         /* turn on forwarding */
         x->x_fwdout = outlet_new(&x->x_obj, 0);
@@ -388,21 +396,28 @@ int voutlet_issignal(t_voutlet *x)
     return (x->x_buf != 0);
 }
 
-    /* LATER optimize for non-overlapped case where the "+=" isn't needed */
+    /* overlap-add into the ring buffer, in at most two pieces since the
+    block may wrap around its end.  If blocks don't overlap, the epilog code
+    has already zeroed the region we're about to write so we can just copy. */
 t_int *voutlet_perform(t_int *w)
 {
     t_voutlet *x = (t_voutlet *)(w[1]);
     t_float *in = (t_float *)(w[2]);
-    int n = (int)(w[3]);
+    int n = (int)(w[3]), overlapped = (x->x_hop < n);
     t_sample *out = x->x_write, *outwas = out;
-#if 0
-    if (tot < 5) post("-in %zx out %zx n %d", in, out, n);
-    if (tot < 5) post("-buf %zx endbuf %zx", x->x_buf, x->x_endbuf);
-#endif
-    while (n--)
+    while (n)
     {
-        *out++ += *in++;
-        if (out == x->x_endbuf) out = x->x_buf;
+        int i, chunk = x->x_endbuf - out;
+        if (chunk > n)
+            chunk = n;
+        if (overlapped)
+            for (i = 0; i < chunk; i++)
+                out[i] += in[i];
+        else memcpy(out, in, chunk * sizeof(*out));
+        in += chunk;
+        n -= chunk;
+        if ((out += chunk) == x->x_endbuf)
+            out = x->x_buf;
     }
     outwas += x->x_hop;
     if (outwas >= x->x_endbuf) outwas = x->x_buf;
@@ -590,11 +605,12 @@ static void *voutlet_newsig(t_symbol *s)
      * maybe indeces would be better...
      *
      * up till now we provide several upsampling methods and 1 single downsampling method (no filtering !)
+     * besides "fir", which low-pass filters in both directions
      */
     if (s == gensym("hold"))x->x_updown.method=1;        /* up: sample and hold */
     else if (s == gensym("lin"))x->x_updown.method=2;    /* up: linear interpolation */
     else if (s == gensym("linear"))x->x_updown.method=2; /* up: linear interpolation */
-    else x->x_updown.method=0;                           /* up: zero-padding; down: ignore samples inbetween */
+    else x->x_updown.method=updown_firmethod(s);         /* up: zero-padding; down: ignore samples inbetween */
 
     return (x);
 }
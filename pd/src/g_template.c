@@ -154,6 +154,19 @@ int template_size(t_template *x)
     return (x->t_n * sizeof(t_word));
 }
 
+    /* size of an element of an array of this template.  Elements with
+    nothing but a float (as in garrays) are stored as bare floats to
+    save memory; otherwise each field takes a t_word.  An array can
+    still have t_word elements for such a template if something asked
+    for them (see garray_getfloatwords()), so code that has the array
+    should use its a_elemsize instead. */
+int template_elemsize(t_template *x)
+{
+    if (x->t_n == 1 && x->t_vec[0].ds_type == DT_FLOAT)
+        return (sizeof(t_float));
+    return (x->t_n * sizeof(t_word));
+}
+
 int template_find_field(t_template *x, t_symbol *name, int *p_onset,
     int *p_type, t_symbol **p_arraytype)
 {
@@ -379,29 +392,35 @@ static void template_conformarray(t_template *tfrom, t_template *tto,
     if (a->a_templatesym == tfrom->t_sym)
     {
         /* the array elements must all be conformed */
-        int oldelemsize = sizeof(t_word) * tfrom->t_n,
-            newelemsize = sizeof(t_word) * tto->t_n;
+        int oldelemsize = a->a_elemsize,
+            newelemsize = template_elemsize(tto);
         char *newarray = getbytes(newelemsize * a->a_n);
         char *oldarray = a->a_vec;
-        if (a->a_elemsize != oldelemsize)
-            bug("template_conformarray");
         for (i = 0; i < a->a_n; i++)
         {
-            t_word *wp = (t_word *)(newarray + newelemsize * i);
-            word_init(wp, tto, &a->a_gp);
-            template_conformwords(tfrom, tto, conformaction,
-                (t_word *)(oldarray + oldelemsize * i), wp);
-            word_free((t_word *)(oldarray + oldelemsize * i), tfrom);
+            t_word *wfrom = (t_word *)(oldarray + oldelemsize * i),
+                *wto = (t_word *)(newarray + newelemsize * i), bare[2];
+                /* elements stored as bare floats go through a t_word */
+            if (oldelemsize < (int)sizeof(t_word))
+                bare[0].w_float = *(t_float *)wfrom, wfrom = &bare[0];
+            if (newelemsize < (int)sizeof(t_word))
+                wto = &bare[1];
+            word_init(wto, tto, &a->a_gp);
+            template_conformwords(tfrom, tto, conformaction, wfrom, wto);
+            word_free(wfrom, tfrom);
+            if (newelemsize < (int)sizeof(t_word))
+                *(t_float *)(newarray + newelemsize * i) = bare[1].w_float;
         }
         scalartemplate = tto;
         a->a_vec = newarray;
+        a->a_elemsize = newelemsize;
         freebytes(oldarray, oldelemsize * a->a_n);
     }
     else scalartemplate = template_findbyname(a->a_templatesym);
         /* convert all arrays and sublist fields in each element of the array */
     for (i = 0; i < a->a_n; i++)
     {
-        t_word *wp = (t_word *)(a->a_vec + sizeof(t_word) * a->a_n * i);
+        t_word *wp = (t_word *)(a->a_vec + a->a_elemsize * i);
         for (j = 0; j < scalartemplate->t_n; j++)
         {
             t_dataslot *ds = scalartemplate->t_vec + j;
@@ -5731,7 +5750,7 @@ int array_getfields(t_symbol *elemtemplatesym,
         error("plot: %s: no canvas for this template", elemtemplatesym->s_name);
         return (-1);
     }
-    elemsize = elemtemplate->t_n * sizeof(t_word);
+    elemsize = template_elemsize(elemtemplate);
     if (yfielddesc && yfielddesc->fd_var)
         varname = yfielddesc->fd_un.fd_varsym;
     else varname = gensym("y");
@@ -5853,6 +5872,7 @@ static void plot_getrect(t_gobj *z, t_glist *glist,
     {
             /* if it has more than 2000 points, just check 1000 of them. */
         int incr = (array->a_n <= 2000 ? 1 : array->a_n / 1000);
+        elemsize = array->a_elemsize;
         for (i = 0, xsum = 0; i < array->a_n; i += incr)
         {
             t_float usexloc, useyloc;
@@ -6065,6 +6085,7 @@ static void plot_vis(t_gobj *z, t_glist *glist, t_glist *parentglist,
                     return;
     nelem = array->a_n;
     elem = (char *)array->a_vec;
+    elemsize = array->a_elemsize;
 
     if (tovis)
     {
@@ -6809,6 +6830,7 @@ static void drawarray_vis(t_gobj *z, t_glist *glist, t_glist *parentglist,
                     return;
     nelem = array->a_n;
     elem = (char *)array->a_vec;
+    elemsize = array->a_elemsize;
 
     /* id for the the viewport-- we prefix it with "draw" to be
        compatible with the other svg-based drawcommands */
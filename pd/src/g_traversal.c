@@ -840,9 +840,8 @@ static void elem_float(t_elem *x, t_float f)
         return;
     }
 
-    elemsize = elemtemplate->t_n * sizeof(t_word);
-
     array = *(t_array **)(((char *)w) + onset);
+    elemsize = array->a_elemsize;
 
     nitems = array->a_n;
     if (indx < 0) indx = 0;
@@ -1034,11 +1033,8 @@ static void setsize_float(t_setsize *x, t_float f)
         return;
     }
 
-    elemsize = elemtemplate->t_n * sizeof(t_word);
-
     array = *(t_array **)(((char *)w) + onset);
-
-    if (elemsize != array->a_elemsize) bug("setsize_gpointer");
+    elemsize = array->a_elemsize;
 
     nitems = array->a_n;
     if (newsize < 1) newsize = 1;
@@ -52,19 +52,38 @@ struct _binbuf
 {
     int b_n;
     t_atom *b_vec;
+    int *b_delim;       /* line index: where the semis and commas are */
+    int b_ndelim;
+    int b_delimsize;    /* allocated size of b_delim */
+    int b_indexed;      /* whether b_delim is up to date */
+    int b_serial;       /* changed on any change except appending */
 };
 
+static int binbuf_nextserial;
+
+    /* a number that's different for every binbuf and every state of its
+    contents, except that it stays the same when atoms are appended, so that
+    an index of the contents can be kept up to date by looking at the
+    atoms past those already indexed. */
+int binbuf_getserial(t_binbuf *x)
+{
+    return (x->b_serial);
+}
+
 t_binbuf *binbuf_new(void)
 {
     t_binbuf *x = (t_binbuf *)t_getbytes(sizeof(*x));
     x->b_n = 0;
     x->b_vec = t_getbytes(0);
+    x->b_serial = ++binbuf_nextserial;
     return (x);
 }
 
 void binbuf_free(t_binbuf *x)
 {
     t_freebytes(x->b_vec, x->b_n * sizeof(*x->b_vec));
+    if (x->b_delim)
+        t_freebytes(x->b_delim, x->b_delimsize * sizeof(*x->b_delim));
     t_freebytes(x,  sizeof(*x));
 }
 
@@ -74,6 +93,7 @@ t_binbuf *binbuf_duplicate(t_binbuf *y)
     x->b_n = y->b_n;
     x->b_vec = t_getbytes(x->b_n * sizeof(*x->b_vec));
     memcpy(x->b_vec, y->b_vec, x->b_n * sizeof(*x->b_vec));
+    x->b_serial = ++binbuf_nextserial;
     return (x);
 }
 
@@ -81,6 +101,60 @@ void binbuf_clear(t_binbuf *x)
 {
     x->b_vec = t_resizebytes(x->b_vec, x->b_n * sizeof(*x->b_vec), 0);
     x->b_n = 0;
+    binbuf_changed(x, 1);
+}
+
+    /* the line index, used by binbuf_getline() to find the nth line (as
+    separated by semicolons or commas) without counting them up each time.
+    It's built when first needed and thrown away when the contents change,
+    except that atoms added at the end are indexed as they come. */
+static void binbuf_indexfrom(t_binbuf *x, int onset)
+{
+    int i;
+    for (i = onset; i < x->b_n; i++)
+        if (x->b_vec[i].a_type == A_SEMI || x->b_vec[i].a_type == A_COMMA)
+    {
+        if (x->b_ndelim == x->b_delimsize)
+        {
+            int newsize = (x->b_delimsize ? 2 * x->b_delimsize : 16);
+            x->b_delim = (int *)t_resizebytes(x->b_delim,
+                x->b_delimsize * sizeof(*x->b_delim),
+                    newsize * sizeof(*x->b_delim));
+            x->b_delimsize = newsize;
+        }
+        x->b_delim[x->b_ndelim++] = i;
+    }
+}
+
+    /* call this after changing atoms in binbuf_getvec() in place, with
+    "delimiters" set if any semicolons or commas came or went */
+void binbuf_changed(t_binbuf *x, int delimiters)
+{
+    x->b_serial = ++binbuf_nextserial;
+    if (delimiters)
+        x->b_indexed = 0;
+}
+
+    /* find line number "line", returning 0 if there's none; otherwise the
+    line is the atoms from *startp up to (not including) *endp, which is
+    the semicolon or comma ending it, or the end of the binbuf. */
+int binbuf_getline(t_binbuf *x, int line, int *startp, int *endp)
+{
+    int start;
+    if (!x->b_indexed)
+    {
+        x->b_ndelim = 0;
+        binbuf_indexfrom(x, 0);
+        x->b_indexed = 1;
+    }
+    if (line < 0 || line > x->b_ndelim)
+        return (0);
+    start = (line ? x->b_delim[line-1] + 1 : 0);
+    if (start >= x->b_n)
+        return (0);
+    *startp = start;
+    *endp = (line < x->b_ndelim ? x->b_delim[line] : x->b_n);
+    return (1);
 }
 
     /* convert text to a binbuf */
@@ -95,6 +169,7 @@ void binbuf_text(t_binbuf *x, char *text, size_t size)
     x->b_vec = t_getbytes(nalloc * sizeof(*x->b_vec));
     ap = x->b_vec;
     x->b_n = 0;
+    binbuf_changed(x, 1);
     while (1)
     {
         //int type;
@@ -321,7 +396,10 @@ void binbuf_add(t_binbuf *x, int argc, t_atom *argv)
 #endif
     for (ap = x->b_vec + x->b_n, i = argc; i--; ap++)
         *ap = *(argv++);
+    i = x->b_n;
     x->b_n = newsize;
+    if (x->b_indexed)
+        binbuf_indexfrom(x, i);
     //fprintf(stderr,"done binbuf_add\n");
 }
 
@@ -504,7 +582,10 @@ void binbuf_restore(t_binbuf *x, int argc, t_atom *argv)
         }
         else *ap = *(argv++);
     }
+    i = x->b_n;
     x->b_n = newsize;
+    if (x->b_indexed)
+        binbuf_indexfrom(x, i);
 }
 
 #define ISSYMBOL(a, b) ((a)->a_type == A_SYMBOL && \
@@ -547,6 +628,7 @@ int binbuf_resize(t_binbuf *x, int newsize)
         x->b_n * sizeof(*x->b_vec), newsize * sizeof(*x->b_vec));
     if (new)
         x->b_vec = new, x->b_n = newsize;
+    binbuf_changed(x, 1);
     return (new != 0);
 }
 
@@ -21,6 +21,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #ifdef _MSC_VER  /* This is only for Microsoft's compiler, not cygwin, e.g. */
 #define snprintf sprintf_s
@@ -303,15 +304,21 @@ static void pd_defaultlist(t_pd *x, t_symbol *s, int argc, t_atom *argv)
 
 extern void text_save(t_gobj *z, t_binbuf *b);
 
+    /* classes are shared by all Pd instances, which may be loading
+    patches (and so creating classes) from different threads */
+static pthread_mutex_t classtable_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 void classtable_register(t_class *c)
 {
     t_classtable *t;
+    pthread_mutex_lock(&classtable_mutex);
     for(t = ct; t; t = t->ct_next)
         if (t->ct_class == c) post("already registered %s", c->c_name->s_name);
     t = (t_classtable *)t_getbytes(sizeof(*t));
     t->ct_class = c;
     t->ct_next = ct;
     ct = t;
+    pthread_mutex_unlock(&classtable_mutex);
 }
 
 int classtable_size(void) {
@@ -799,6 +806,13 @@ t_propertiesfn class_getpropertiesfn(t_class *c)
 
 static t_symbol *symhash[HASHSIZE];
 
+    /* The symbol table is shared by all Pd instances.  Looking a symbol up
+    takes no lock, since symbols are only ever appended to the end of a
+    hash chain, and only once they're completely filled in; adding one is
+    done under symhash_mutex, after searching the rest of the chain again
+    in case another thread got there first. */
+static pthread_mutex_t symhash_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 t_symbol *dogensym(const char *s, t_symbol *oldsym)
 {
     t_symbol **sym1, *sym2;
@@ -818,6 +832,16 @@ t_symbol *dogensym(const char *s, t_symbol *oldsym)
         if (!strcmp(sym2->s_name, s)) return(sym2);
         sym1 = &sym2->s_next;
     }
+    pthread_mutex_lock(&symhash_mutex);
+    while (sym2 = *sym1)
+    {
+        if (!strcmp(sym2->s_name, s))
+        {
+            pthread_mutex_unlock(&symhash_mutex);
+            return(sym2);
+        }
+        sym1 = &sym2->s_next;
+    }
     if (oldsym) sym2 = oldsym;
     else
     {
@@ -827,7 +851,11 @@ t_symbol *dogensym(const char *s, t_symbol *oldsym)
         sym2->s_thing = 0;
         strcpy(sym2->s_name, s);
     }
+#ifdef __GNUC__
+    __sync_synchronize();   /* publish the symbol only once it's complete */
+#endif
     *sym1 = sym2;
+    pthread_mutex_unlock(&symhash_mutex);
     return (sym2);
 }
 
@@ -961,9 +989,17 @@ void pd_typedmess(t_pd *x, t_symbol *s, int argc, t_atom *argv)
     t_floatarg ad[MAXPDARG+1], *dp = ad;
     int narg = 0;
     t_pd *bonzo;
+    t_class *wascurrent = 0;
+    int charged = pd_memsampling;
     
     //fprintf(stderr,"pd_typedmess: %s %d\n", s->s_name, c->c_nmethod);
 
+    if (charged)    /* memory accounting, see m_memory.c */
+    {
+        wascurrent = pd_currentclass;
+        pd_currentclass = c;
+    }
+
         /* check for messages that are handled by fixed slots in the class
         structure.  We don't catch "pointer" though so that sending "pointer"
         to pd_objectmaker doesn't require that we supply a pointer value. */
@@ -1127,6 +1163,8 @@ badarg:
         c->c_name->s_name,
         type_hint(s, argc, argv, 1));
 lastmess:
+    if (charged)
+        pd_currentclass = wascurrent;
     last_typedmess = s;    
     last_typedmess_pd = x;
     return;
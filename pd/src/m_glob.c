@@ -45,6 +45,9 @@ void glob_forward_files_from_secondary_instance(void);
 void glob_recent_files(t_pd *dummy);
 void glob_add_recent_file(t_pd *dummy, t_symbol *s);
 void glob_clear_recent_files(t_pd *dummy);
+void glob_poolstat(void *dummy);
+void glob_memstat(void *dummy, t_symbol *s, int argc, t_atom *argv);
+void glob_rtcheck(void *dummy, t_floatarg f);
 
 void alsa_resync( void);
 
@@ -158,6 +161,12 @@ void glob_init(void)
     class_addmethod(glob_pdobject, (t_method)glob_verifyquit,
         gensym("verifyquit"), A_DEFFLOAT, 0);
     class_addmethod(glob_pdobject, (t_method)glob_foo, gensym("foo"), A_GIMME, 0);
+    class_addmethod(glob_pdobject, (t_method)glob_poolstat, gensym("poolstat"),
+        0);
+    class_addmethod(glob_pdobject, (t_method)glob_memstat, gensym("memstat"),
+        A_GIMME, 0);
+    class_addmethod(glob_pdobject, (t_method)glob_rtcheck, gensym("rtcheck"),
+        A_DEFFLOAT, 0);
     class_addmethod(glob_pdobject, (t_method)glob_dsp, gensym("dsp"), A_GIMME, 0);
     class_addmethod(glob_pdobject, (t_method)glob_meters, gensym("meters"),
         A_FLOAT, 0);
@@ -56,6 +56,15 @@ struct _class
     char c_drawcommand;             /* a drawing command for a template */
 };
 
+/* thread-local storage, where the compiler offers it */
+#if defined(__GNUC__)
+#define PERTHREAD __thread
+#elif defined(_MSC_VER)
+#define PERTHREAD __declspec(thread)
+#else
+#define PERTHREAD
+#endif
+
 struct _pdinstance
 {
     double pd_systime;          /* global time in Pd ticks */
@@ -75,9 +84,24 @@ struct _pdinstance
     t_symbol *pd_touchin_sym;
     t_symbol *pd_polytouchin_sym;
     t_symbol *pd_midirealtimein_sym;
+    struct _instanceugen *pd_ugen;  /* DSP graph state, see d_ugen.c */
 };
 
+    /* The current instance.  Compiled with PDTHREADS it is per thread: a
+    thread calls pd_setinstance() before it touches Pd, and the instance
+    made by pd_init() belongs to the main thread and is adopted by the audio
+    callback thread.  Otherwise it is one variable that all threads share.
+    This only keeps each instance's clocks and DSP graph apart; the symbol
+    table and what's bound to it, the class list, and the scheduler and
+    s_inter.c state are still shared and unguarded, so two instances can't
+    yet tick at the same time -- a thread has to hold sys_lock() while it
+    runs one. */
+#ifdef PDTHREADS
+extern PERTHREAD t_pdinstance *pd_this;
+#else
 extern t_pdinstance *pd_this;
+#endif
+extern t_pdinstance *pd_maininstance;
 
 /* m_class.c */
 EXTERN void pd_emptylist(t_pd *x);
@@ -101,6 +125,22 @@ EXTERN int obj_nsigoutlets(t_object *x);
 EXTERN int obj_siginletindex(t_object *x, int m);
 EXTERN int obj_sigoutletindex(t_object *x, int m);
 
+/* m_memory.c */
+EXTERN void *pool_getbytes(size_t nbytes);
+EXTERN void pool_freebytes(void *x, size_t nbytes);
+    /* memory accounting: sampling interval (zero when off) and the class
+    whose method is running */
+extern int pd_memsampling;
+extern PERTHREAD t_class *pd_currentclass;
+
+/* d_ugen.c: real-time safety checking.  While "pd rtcheck 1" (or -rtcheck)
+is on, sys_inaudio is set as long as the DSP chain runs, and calls that
+may block or allocate report themselves through sys_rtviolation(). */
+extern int sys_rtcheck;
+extern PERTHREAD int sys_inaudio;
+EXTERN void sys_rtviolation(const char *what);
+#define RTCHECK(what) do { if (sys_inaudio) sys_rtviolation(what); } while (0)
+
 /* misc */
 EXTERN void glob_evalfile(t_pd *ignore, t_symbol *name, t_symbol *dir);
 EXTERN void glob_initfromgui(void *dummy, t_symbol *s, int argc, t_atom *argv);
@@ -6,6 +6,7 @@
 #include <string.h>
 #include "m_pd.h"
 #include "m_imp.h"
+#include <pthread.h>
 
 /* #define LOUD */
 #ifdef LOUD
@@ -17,10 +18,243 @@
 static int totalmem = 0;
 #endif
 
+/* Optional per-class memory accounting.  While it is on, every block that
+getbytes() and friends hand out is entered in a hash table together with
+its size and the class whose method (or constructor) was running at the
+time; freeing the block charges it back to the same class.  "pd memstat 1"
+turns it on, "pd memstat <n>" records only every n-th allocation (and
+scales the statistics accordingly) to keep the overhead down, "pd memstat
+0" turns it off again, and "pd memstat" prints what is currently live per
+class.  Only blocks allocated (or resized) while accounting is on are
+counted, and blocks that go back to the pools below stay charged to the
+class that first allocated them. */
+
+PERTHREAD t_class *pd_currentclass;
+
+#define MEM_NBLOCKHASH 65536
+#define MEM_NCLASSHASH 1024
+
+typedef struct _memclass
+{
+    t_class *m_class;
+    double m_bytes;             /* live bytes (estimated when sampling) */
+    double m_nlive;             /* live blocks */
+    double m_nallocs;           /* allocations since accounting began */
+    struct _memclass *m_next;
+} t_memclass;
+
+typedef struct _memblock
+{
+    void *b_ptr;
+    size_t b_size;
+    int b_weight;               /* sampling interval when it was recorded */
+    t_memclass *b_owner;
+    struct _memblock *b_next;
+} t_memblock;
+
+int pd_memsampling;             /* 0 if off, otherwise the interval */
+static int mem_countdown;
+static t_memblock *mem_blockhash[MEM_NBLOCKHASH];
+static t_memblock *mem_freeblocks;
+static t_memclass *mem_classhash[MEM_NCLASSHASH];
+static pthread_mutex_t mem_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define MEM_HASH(p, n) ((((size_t)(p)) >> 4) % (n))
+
+static t_memclass *mem_findclass(t_class *c)
+{
+    t_memclass **mp = &mem_classhash[MEM_HASH(c, MEM_NCLASSHASH)], *m;
+    for (m = *mp; m; m = m->m_next)
+        if (m->m_class == c)
+            return (m);
+    if (!(m = (t_memclass *)calloc(1, sizeof(*m))))
+        return (0);
+    m->m_class = c;
+    m->m_next = *mp;
+    *mp = m;
+    return (m);
+}
+
+    /* enter a new block, charging it to "owner" or, if that's zero, to the
+    current class */
+static void mem_record(void *ptr, size_t nbytes, t_memclass *owner,
+    int weight)
+{
+    t_memblock *b, **bp;
+    if (!owner && !(owner = mem_findclass(pd_currentclass)))
+        return;
+    if ((b = mem_freeblocks))
+        mem_freeblocks = b->b_next;
+    else if (!(b = (t_memblock *)malloc(sizeof(*b))))
+        return;
+    b->b_ptr = ptr;
+    b->b_size = nbytes;
+    b->b_weight = weight;
+    b->b_owner = owner;
+    bp = &mem_blockhash[MEM_HASH(ptr, MEM_NBLOCKHASH)];
+    b->b_next = *bp;
+    *bp = b;
+    owner->m_bytes += (double)nbytes * weight;
+    owner->m_nlive += weight;
+    owner->m_nallocs += weight;
+}
+
+    /* remove a block if it was recorded, returning its entry (which stays
+    valid until the next mem_record) or zero */
+static t_memblock *mem_forget(void *ptr)
+{
+    t_memblock **bp = &mem_blockhash[MEM_HASH(ptr, MEM_NBLOCKHASH)], *b;
+    for (; (b = *bp); bp = &b->b_next)
+        if (b->b_ptr == ptr)
+    {
+        *bp = b->b_next;
+        b->b_owner->m_bytes -= (double)b->b_size * b->b_weight;
+        b->b_owner->m_nlive -= b->b_weight;
+        b->b_next = mem_freeblocks;
+        mem_freeblocks = b;
+        return (b);
+    }
+    return (0);
+}
+
+static void mem_trackalloc(void *ptr, size_t nbytes)
+{
+    pthread_mutex_lock(&mem_mutex);
+    if (pd_memsampling && --mem_countdown <= 0)
+    {
+        mem_countdown = pd_memsampling;
+        mem_record(ptr, nbytes, 0, pd_memsampling);
+    }
+    pthread_mutex_unlock(&mem_mutex);
+}
+
+    /* take a block's record out before it is realloc()ed, passing back
+    its owner and weight (or leaving them alone if it wasn't recorded) so
+    that mem_trackresize() can enter it again at its new address */
+static void mem_untrack(void *ptr, t_memclass **owner, int *weight)
+{
+    t_memblock *b;
+    pthread_mutex_lock(&mem_mutex);
+    if ((b = mem_forget(ptr)))
+        *owner = b->b_owner, *weight = b->b_weight;
+    pthread_mutex_unlock(&mem_mutex);
+}
+
+static void mem_trackresize(void *ptr, size_t nbytes, t_memclass *owner,
+    int weight)
+{
+    pthread_mutex_lock(&mem_mutex);
+        /* a block that was recorded stays with its class; one that
+        wasn't is treated like a new allocation, so that the growth of
+        things allocated before accounting began shows up too. */
+    if (pd_memsampling)
+    {
+        if (owner)
+            mem_record(ptr, nbytes, owner, weight);
+        else if (--mem_countdown <= 0)
+        {
+            mem_countdown = pd_memsampling;
+            mem_record(ptr, nbytes, 0, pd_memsampling);
+        }
+    }
+    pthread_mutex_unlock(&mem_mutex);
+}
+
+static void mem_trackfree(void *ptr)
+{
+    pthread_mutex_lock(&mem_mutex);
+    if (pd_memsampling)
+        mem_forget(ptr);
+    pthread_mutex_unlock(&mem_mutex);
+}
+
+static void mem_clear(void)
+{
+    int i;
+    for (i = 0; i < MEM_NBLOCKHASH; i++)
+    {
+        t_memblock *b, *b2;
+        for (b = mem_blockhash[i]; b; b = b2)
+            b2 = b->b_next, free(b);
+        mem_blockhash[i] = 0;
+    }
+    while (mem_freeblocks)
+    {
+        t_memblock *b = mem_freeblocks->b_next;
+        free(mem_freeblocks);
+        mem_freeblocks = b;
+    }
+    for (i = 0; i < MEM_NCLASSHASH; i++)
+    {
+        t_memclass *m, *m2;
+        for (m = mem_classhash[i]; m; m = m2)
+            m2 = m->m_next, free(m);
+        mem_classhash[i] = 0;
+    }
+}
+
+static int mem_compare(const void *a, const void *b)
+{
+    double x = (*(t_memclass **)a)->m_bytes, y = (*(t_memclass **)b)->m_bytes;
+    return (x < y ? 1 : (x > y ? -1 : 0));
+}
+
+static void mem_print(void)
+{
+    t_memclass **vec, *m;
+    int i, n = 0;
+    double total = 0;
+    for (i = 0; i < MEM_NCLASSHASH; i++)
+        for (m = mem_classhash[i]; m; m = m->m_next)
+            n++;
+    if (!(vec = (t_memclass **)malloc((n ? n : 1) * sizeof(*vec))))
+        return;
+    for (i = n = 0; i < MEM_NCLASSHASH; i++)
+        for (m = mem_classhash[i]; m; m = m->m_next)
+            vec[n++] = m, total += m->m_bytes;
+    qsort(vec, n, sizeof(*vec), mem_compare);
+    post("memstat: class, live bytes, live blocks, allocations%s",
+        (pd_memsampling > 1 ? " (estimated from samples)" : ""));
+    for (i = 0; i < n; i++)
+        post("memstat: %s %.0f %.0f %.0f",
+            (vec[i]->m_class ? vec[i]->m_class->c_name->s_name : "(none)"),
+            vec[i]->m_bytes, vec[i]->m_nlive, vec[i]->m_nallocs);
+    post("memstat: total %.0f bytes", total);
+    free(vec);
+}
+
+void glob_memstat(void *dummy, t_symbol *s, int argc, t_atom *argv)
+{
+    int interval;
+    if (!argc)
+    {
+        if (pd_memsampling)
+            mem_print();
+        else post("memstat: accounting is off; \"pd memstat 1\" turns it on");
+        return;
+    }
+    interval = atom_getintarg(0, argc, argv);
+    pthread_mutex_lock(&mem_mutex);
+    if (interval <= 0)
+    {
+        pd_memsampling = 0;
+        mem_clear();
+    }
+    else
+    {
+        if (!pd_memsampling)
+            mem_clear();
+            /* changing the interval leaves recorded blocks' weights alone */
+        pd_memsampling = mem_countdown = interval;
+    }
+    pthread_mutex_unlock(&mem_mutex);
+}
+
 void *getbytes(size_t nbytes)
 {
     void *ret;
 
+    RTCHECK("getbytes()");
     if (nbytes < 1) nbytes = 1;
     ret = (void *)calloc(nbytes, 1);
 
@@ -33,6 +267,8 @@ void *getbytes(size_t nbytes)
 #endif
     if (!ret)
         post("pd: getbytes() failed -- out of memory");
+    else if (pd_memsampling)
+        mem_trackalloc(ret, nbytes);
     return (ret);
 }
 
@@ -53,8 +289,13 @@ void *copybytes(void *src, size_t nbytes)
 void *resizebytes(void *old, size_t oldsize, size_t newsize)
 {
     void *ret;
+    t_memclass *owner = 0;
+    int weight = 0;
+    RTCHECK("resizebytes()");
     if (newsize < 1) newsize = 1;
     if (oldsize < 1) oldsize = 1;
+    if (pd_memsampling)
+        mem_untrack(old, &owner, &weight);
     ret = (void *)realloc((char *)old, newsize);
     if (newsize > oldsize && ret)
         memset(((char *)ret) + oldsize, 0, newsize - oldsize);
@@ -65,12 +306,19 @@ void *resizebytes(void *old, size_t oldsize, size_t newsize)
     totalmem += (newsize - oldsize);
 #endif
     if (!ret)
+    {
         post("pd: resizebytes() failed -- out of memory");
+        if (owner)
+            mem_trackresize(old, oldsize, owner, weight);
+    }
+    else if (pd_memsampling)
+        mem_trackresize(ret, newsize, owner, weight);
     return (ret);
 }
 
 void freebytes(void *fatso, size_t nbytes)
 {
+    RTCHECK("freebytes()");
     if (nbytes == 0)
         nbytes = 1;
 #ifdef LOUD
@@ -79,10 +327,99 @@ void freebytes(void *fatso, size_t nbytes)
 #ifdef DEBUGMEM
     totalmem -= nbytes;
 #endif
+    if (pd_memsampling)
+        mem_trackfree(fatso);
     free(fatso);
     fatso = NULL;
 }
 
+/* Size-class pools for small blocks that are allocated and freed at a high
+rate while Pd runs, such as clocks, [pipe]'s pending messages and
+[vline~]'s segments.  Freed blocks are kept on one list per power-of-two
+size class and handed out again, so that a patch in a steady state doesn't
+go to the heap at all.  Blocks bigger than the largest class go straight to
+getbytes().  Like getbytes(), pool_getbytes() returns zeroed memory.  The
+pools are per thread, so that Pd instances running on different threads
+don't need to lock them; a block may be freed on a different thread than
+the one that allocated it, it then simply moves to that thread's pool. */
+
+#define POOL_MINSHIFT 4                 /* smallest class: 16 bytes */
+#define POOL_NCLASSES 6                 /* largest class: 512 bytes */
+
+typedef struct _poolblock
+{
+    struct _poolblock *b_next;
+} t_poolblock;
+
+typedef struct _poolclass
+{
+    t_poolblock *p_free;    /* chain of free blocks */
+    int p_nheap;            /* blocks obtained from the heap */
+    int p_nreused;          /* requests served from the free chain */
+    int p_nfree;            /* blocks currently on the free chain */
+} t_poolclass;
+
+static PERTHREAD t_poolclass pool_class[POOL_NCLASSES];
+static PERTHREAD int pool_nbig;     /* requests too big for any class */
+
+static int pool_getclass(size_t nbytes)
+{
+    int i;
+    for (i = 0; i < POOL_NCLASSES; i++)
+        if (nbytes <= ((size_t)1 << (i + POOL_MINSHIFT)))
+            return (i);
+    return (-1);
+}
+
+void *pool_getbytes(size_t nbytes)
+{
+    int i = pool_getclass(nbytes);
+    t_poolclass *p;
+    t_poolblock *b;
+    if (i < 0)
+    {
+        pool_nbig++;
+        return (getbytes(nbytes));
+    }
+    p = &pool_class[i];
+    if ((b = p->p_free))
+    {
+        p->p_free = b->b_next;
+        p->p_nfree--;
+        p->p_nreused++;
+        memset(b, 0, nbytes);
+        return (b);
+    }
+    p->p_nheap++;
+    return (getbytes((size_t)1 << (i + POOL_MINSHIFT)));
+}
+
+void pool_freebytes(void *x, size_t nbytes)
+{
+    int i = pool_getclass(nbytes);
+    t_poolblock *b = (t_poolblock *)x;
+    if (i < 0)
+    {
+        freebytes(x, nbytes);
+        return;
+    }
+    b->b_next = pool_class[i].p_free;
+    pool_class[i].p_free = b;
+    pool_class[i].p_nfree++;
+}
+
+    /* "pd poolstat" message: print the counters */
+void glob_poolstat(void *dummy)
+{
+    int i;
+    post("pool: block size, heap allocations, reused, currently free");
+    for (i = 0; i < POOL_NCLASSES; i++)
+        post("pool: %d %d %d %d", 1 << (i + POOL_MINSHIFT),
+            pool_class[i].p_nheap, pool_class[i].p_nreused,
+            pool_class[i].p_nfree);
+    post("pool: %d requests too big for the pool", pool_nbig);
+}
+
 #ifdef DEBUGMEM
 #include <stdio.h>
 
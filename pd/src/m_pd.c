@@ -24,6 +24,13 @@ t_pd *pd_new(t_class *c)
     if (!c) 
         bug ("pd_new: apparently called before setup routine");
 
+        /* while pd_objectmaker runs a constructor (pd_typedmess() sets
+        and restores the current class around it), the first object made
+        is the one being constructed, and it and whatever else its
+        constructor allocates are charged to its class.  Inlets and other
+        objects that the constructor makes in turn don't take over. */
+    if (pd_memsampling && pd_currentclass == pd_objectmaker)
+        pd_currentclass = c;
     x = (t_pd *)t_getbytes(c->c_size);
     *x = c;
     if (c->c_patchable)
@@ -408,40 +415,52 @@ void pd_doloadbang(void)
     lastpopped = 0;
 }
 
+    /* while memory accounting is on, the class whose method is running is
+    noted so that allocations can be charged to it (see m_memory.c) */
+#define PD_CHARGE(x, call) \
+    if (pd_memsampling) \
+    { \
+        t_class *was = pd_currentclass; \
+        pd_currentclass = *(x); \
+        call; \
+        pd_currentclass = was; \
+    } \
+    else call
+
 void pd_bang(t_pd *x)
 {
-    (*(*x)->c_bangmethod)(x);
+    PD_CHARGE(x, (*(*x)->c_bangmethod)(x));
 }
 
 void pd_float(t_pd *x, t_float f)
 {
-    (*(*x)->c_floatmethod)(x, f);
+    PD_CHARGE(x, (*(*x)->c_floatmethod)(x, f));
 }
 
 void pd_pointer(t_pd *x, t_gpointer *gp)
 {
-    (*(*x)->c_pointermethod)(x, gp);
+    PD_CHARGE(x, (*(*x)->c_pointermethod)(x, gp));
 }
 
 void pd_symbol(t_pd *x, t_symbol *s)
 {
-    (*(*x)->c_symbolmethod)(x, s);
+    PD_CHARGE(x, (*(*x)->c_symbolmethod)(x, s));
 }
 
 void pd_blob(t_pd *x, t_blob *st) /* MP20061226 blob type */
 {
     /*post("pd_blob: st %p length %lu (*x)->c_blobmethod %p", st, st->s_length, (*x)->c_blobmethod);*/
-    (*(*x)->c_blobmethod)(x, st);
+    PD_CHARGE(x, (*(*x)->c_blobmethod)(x, st));
 }
 
 void pd_list(t_pd *x, t_symbol *s, int argc, t_atom *argv)
 {
-    (*(*x)->c_listmethod)(x, &s_list, argc, argv);
+    PD_CHARGE(x, (*(*x)->c_listmethod)(x, &s_list, argc, argv));
 }
 
 void pd_anything(t_pd *x, t_symbol *s, int argc, t_atom *argv)
 {
-    (*(*x)->c_anymethod)(x, s, argc, argv);
+    PD_CHARGE(x, (*(*x)->c_anymethod)(x, s, argc, argv));
 }
 
 void mess_init(void);
@@ -450,7 +469,16 @@ void conf_init(void);
 void glob_init(void);
 void garray_init(void);
 
+#ifdef PDTHREADS
+PERTHREAD t_pdinstance *pd_this;
+#else
 t_pdinstance *pd_this;
+#endif
+t_pdinstance *pd_maininstance;
+
+struct _instanceugen *ugen_newpdinstance(void);
+void ugen_freepdinstance(struct _instanceugen *x);
+void ugen_stop(void);
 
 static t_symbol *midi_gensym(const char *prefix, const char *name)
 {
@@ -485,6 +513,7 @@ static t_pdinstance *pdinstance_donew(int useprefix)
     x->pd_touchin_sym = midi_gensym(midiprefix, "#touchin");
     x->pd_polytouchin_sym = midi_gensym(midiprefix, "#polytouchin");
     x->pd_midirealtimein_sym = midi_gensym(midiprefix, "#midirealtimein");
+    x->pd_ugen = ugen_newpdinstance();
     return (x);
 }
 
@@ -496,7 +525,7 @@ EXTERN t_pdinstance *pdinstance_new(void)
 void pd_init(void)
 {
     if (!pd_this)
-        pd_this = pdinstance_donew(0);
+        pd_this = pd_maininstance = pdinstance_donew(0);
     mess_init();
     obj_init();
     conf_init();
@@ -509,9 +538,24 @@ EXTERN void pd_setinstance(t_pdinstance *x)
     pd_this = x;
 }
 
+    /* free an instance made by pdinstance_new(), along with its canvases
+    and DSP chain.  Symbols and classes are shared by all instances and
+    stay. */
 EXTERN void pdinstance_free(t_pdinstance *x)
 {
-    /* placeholder - LATER free symtab, dsp chain, classes and canvases */
+    t_pdinstance *was = pd_this;
+    if (x == pd_maininstance)
+    {
+        bug("pdinstance_free");
+        return;
+    }
+    pd_this = x;
+    while (x->pd_canvaslist)
+        pd_free(&x->pd_canvaslist->gl_pd);
+    ugen_stop();
+    ugen_freepdinstance(x->pd_ugen);
+    pd_this = (was == x ? pd_maininstance : was);
+    freebytes(x, sizeof(*x));
 }
 
 EXTERN t_canvas *pd_getcanvaslist(void)
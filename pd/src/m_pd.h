@@ -380,6 +380,9 @@ EXTERN void binbuf_print(t_binbuf *x);
 EXTERN int binbuf_getnatom(t_binbuf *x);
 EXTERN t_atom *binbuf_getvec(t_binbuf *x);
 EXTERN int binbuf_resize(t_binbuf *x, int newsize);
+EXTERN int binbuf_getline(t_binbuf *x, int line, int *startp, int *endp);
+EXTERN void binbuf_changed(t_binbuf *x, int delimiters);
+EXTERN int binbuf_getserial(t_binbuf *x);
 EXTERN void binbuf_eval(t_binbuf *x, t_pd *target, int argc, t_atom *argv);
 EXTERN int binbuf_read(t_binbuf *b, char *filename, char *dirname,
     int crflag);
@@ -636,6 +639,7 @@ EXTERN void mayer_fft(int n, t_sample *real, t_sample *imag);
 EXTERN void mayer_ifft(int n, t_sample *real, t_sample *imag);
 EXTERN void mayer_realfft(int n, t_sample *real);
 EXTERN void mayer_realifft(int n, t_sample *real);
+EXTERN void mayer_prepare(int n);
 
 EXTERN t_float *cos_table;
 #define LOGCOSTABSIZE 9
@@ -649,7 +653,9 @@ EXTERN int canvas_dspstate;
 /*   up/downsampling */
 typedef struct _resample
 {
-  int method;       /* up/downsampling method ID */
+  int method;       /* up/downsampling method ID: 0 zero-padding, 1 hold,
+                       2 linear, or at least RESAMPLE_FIRMIN for a
+                       band-limited FIR with that many taps per sample */
 
   t_int downsample; /* downsampling factor */
   t_int upsample;   /* upsampling factor */
@@ -664,6 +670,9 @@ typedef struct _resample
   int      bufsize;
 } t_resample;
 
+#define RESAMPLE_FIRMIN 3   /* smallest method ID that selects the FIR */
+#define RESAMPLE_FIRDEFAULT 32  /* taps for plain "fir" */
+
 EXTERN void resample_init(t_resample *x);
 EXTERN void resample_free(t_resample *x);
 
@@ -694,6 +703,8 @@ EXTERN_STRUCT _garray;
 EXTERN t_class *garray_class;
 EXTERN int garray_getfloatarray(t_garray *x, int *size, t_float **vec);
 EXTERN int garray_getfloatwords(t_garray *x, int *size, t_word **vec);
+EXTERN int garray_getfloatvec(t_garray *x, int *size, t_float **vec,
+    int *stride);
 EXTERN t_float garray_get(t_garray *x, t_symbol *s, t_int indx);
 EXTERN void garray_redraw(t_garray *x);
 EXTERN int garray_npoints(t_garray *x);
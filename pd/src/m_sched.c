@@ -7,6 +7,8 @@
 #include "m_pd.h"
 #include "m_imp.h"
 #include "s_stuff.h"
+#include <string.h>
+#include <errno.h>
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -49,7 +51,7 @@ struct _clock
 
 t_clock *clock_new(void *owner, t_method fn)
 {
-    t_clock *x = (t_clock *)getbytes(sizeof *x);
+    t_clock *x = (t_clock *)pool_getbytes(sizeof *x);
     x->c_settime = -1;
     x->c_owner = owner;
     x->c_fn = (t_clockmethod)fn;
@@ -170,7 +172,7 @@ double clock_getsystimeafter(double delaytime)
 void clock_free(t_clock *x)
 {
     clock_unset(x);
-    freebytes(x, sizeof *x);
+    pool_freebytes(x, sizeof *x);
 }
 
 /* the following routines maintain a real-execution-time histogram of the
@@ -424,7 +426,7 @@ void sched_tick( void)
         clock_unset(pd_this->pd_clock_setlist);
         outlet_setstacklim();
         (*c->c_fn)(c->c_owner);
-        if (!countdown--)
+        if (!countdown-- && pd_this == pd_maininstance)
         {
             countdown = 5000;
             sys_pollgui();
@@ -434,7 +436,8 @@ void sched_tick( void)
     }
     pd_this->pd_systime = next_sys_time;
     dsp_tick();
-    sched_diddsp++;
+    if (pd_this == pd_maininstance)
+        sched_diddsp++;
 }
 
 /*
@@ -575,8 +578,16 @@ static void m_pollingscheduler( void)
 #endif
 }
 
+    /* share of each tick's duration that the audio callback may spend
+    delivering queued GUI and network messages */
+#define INQUEUE_BUDGET 0.25
+
 void sched_audio_callbackfn(void)
 {
+#ifdef PDTHREADS
+    if (!pd_this)
+        pd_setinstance(pd_maininstance);
+#endif
     sys_lock();
     sys_setmiditimediff(0, 1e-6 * sys_schedadvance);
     sys_addhist(1);
@@ -584,6 +595,8 @@ void sched_audio_callbackfn(void)
     sys_addhist(2);
     sys_pollmidiqueue();
     sys_addhist(3);
+    sys_pollinqueue(INQUEUE_BUDGET * sys_schedblocksize / sys_dacsr);
+    sys_addhist(4);
     sys_pollgui();
     sys_addhist(5);
     sched_pollformeters();
@@ -591,27 +604,51 @@ void sched_audio_callbackfn(void)
     sys_unlock();
 }
 
+    /* In callback mode the main thread reads and parses incoming GUI and
+    network messages and queues them for the audio callback (see
+    sys_pollinput() in s_inter.c).  If the callbacks stop coming we deliver
+    the messages ourselves, and tick the scheduler once a second. */
 static void m_callbackscheduler(void)
 {
+    double lastchange = sys_getrealtime(), lasttick = lastchange;
+    double timewas = pd_this->pd_systime;
     sys_initmidiqueue();
+    sys_lock();
+    sys_setinqueue(1);
+    sys_unlock();
     while (!sys_quit)
     {
-        double timewas = pd_this->pd_systime;
-#ifdef _WIN32
-        Sleep(1000);
-#else
-        sleep(1);
-#endif
-        if (pd_this->pd_systime == timewas)
+        double now;
+        sys_pollinput(1000);
+        now = sys_getrealtime();
+        if (pd_this->pd_systime != timewas)
+        {
+            timewas = pd_this->pd_systime;
+            lastchange = now;
+        }
+        else if (now - lastchange > 0.05)
         {
             sys_lock();
+            sys_pollinqueue(0);
             sys_pollgui();
-            sched_tick();
+            if (now - lasttick >= 1)
+            {
+                sched_tick();
+                timewas = pd_this->pd_systime;
+            }
             sys_unlock();
         }
-        if (sys_idlehook)
-            sys_idlehook();
+        if (now - lasttick >= 1)
+        {
+            lasttick = now;
+            if (sys_idlehook)
+                sys_idlehook();
+        }
     }
+    sys_lock();
+    sys_setinqueue(0);
+    sys_pollinqueue(0);
+    sys_unlock();
 }
 
 int m_mainloop(void)
@@ -641,6 +678,62 @@ int m_batchmain(void)
     return (0);
 }
 
+    /* offline rendering ("-batch -render in out").  Like m_batchmain(), but
+    each tick reads a block of the input file (if any; it was opened by
+    sys_afterargparse()) into adc~ and writes what dac~ left in sys_soundout
+    to "outname".  We stop after "duration" seconds, or at the end of the
+    input if no duration was given, or when the patch quits.  Since nothing
+    waits on a clock this runs as fast as the CPU allows, and the output
+    depends only on the patch and the input. */
+int m_batchrender(const char *outname, int hasinput, double duration)
+{
+    long nframes, frame = 0;
+    double starttime, elapsed;
+    int ret = 0, n;
+    if (duration < 0)
+    {
+        error("-render: need -duration when there's no input file");
+        return (1);
+    }
+        /* "open" the (deviceless) audio now, so that sys_soundin and
+        sys_soundout have their final size before the first block is read
+        into them; otherwise turning DSP on would reallocate them in the
+        middle of that tick and the first block of input would be lost. */
+    if (!audio_isopen())
+        sys_reopen_audio();
+    nframes = (long)(duration * sys_dacsr + 0.5);
+    if (soundfile_renderopenout(outname, sys_outchannels, sys_dacsr,
+        nframes) < 0)
+    {
+        error("%s: %s", outname, strerror(errno));
+        soundfile_renderclose();
+        return (1);
+    }
+    starttime = sys_getrealtime();
+    while (frame < nframes && sys_quit != SYS_QUIT_QUIT)
+    {
+        if (hasinput)
+            soundfile_renderread(sys_soundin, sys_inchannels, DEFDACBLKSIZE);
+        sched_tick();
+        n = (nframes - frame < DEFDACBLKSIZE ? nframes - frame : DEFDACBLKSIZE);
+        if (soundfile_renderwrite(sys_soundout, DEFDACBLKSIZE, n) < 0)
+        {
+            error("%s: %s", outname, strerror(errno));
+            ret = 1;
+            break;
+        }
+        memset(sys_soundout, 0,
+            sys_outchannels * DEFDACBLKSIZE * sizeof(t_sample));
+        frame += n;
+    }
+    soundfile_renderclose();
+    elapsed = sys_getrealtime() - starttime;
+    post("rendered %g seconds of audio in %g seconds (%g times real time)",
+        frame / sys_dacsr, elapsed,
+            (elapsed > 0 ? frame / sys_dacsr / elapsed : 0));
+    return (ret);
+}
+
 /* ------------ thread locking ------------------- */
 
 #if THREAD_LOCKING
@@ -650,6 +743,7 @@ static int sys_mutex_lock = 0;
 void sys_lock(void)
 {
     //fprintf(stderr,"sys_lock\n");
+    RTCHECK("sys_lock()");
     if (!sys_mutex_lock)
     {
         int res = pthread_mutex_lock(&sys_mutex);
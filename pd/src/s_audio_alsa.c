@@ -37,6 +37,7 @@
 #endif
 
 static void alsa_checkiosync( void);
+void alsa_putzeros(int iodev, int n);
 static void alsa_numbertoname(int iodev, char *devname, int nchar);
 static int alsa_jittermax;
 #define ALSA_DEFJITTERMAX 3
@@ -90,6 +91,167 @@ static int alsaio_canmmap(t_alsa_dev *dev)
     return ((err1 < 0) && (err2 >= 0));
 }
 
+    /* sample format conversion between a channel of one of Pd's blocks
+and a device buffer, where successive samples of the channel are "step"
+bytes apart.  The loops are kept simple, clipping in floating point, so
+that the compiler can vectorize the arithmetic.  If "from" is null the
+channel is zeroed (on output); if "to" is null nothing is done (input).
+The 24-bit format is little-endian whatever the host byte order. */
+
+#define ALSA_CLIP(f, max) ((f) > (max) ? (max) : ((f) < -(max) ? -(max) : (f)))
+
+static void alsa_putsamples(int width, t_sample *from, char *to, int step,
+    int n)
+{
+    int i;
+    if (!from)
+    {
+        for (i = 0; i < n; i++)
+            memset(to + i * step, 0, width);
+    }
+    else if (width == 4)
+    {
+        t_alsa_sample32 *sp = (t_alsa_sample32 *)to;
+        int stride = step / 4;
+        for (i = 0; i < n; i++)
+        {
+            float f = from[i] * INT32_MAX;
+            sp[i * stride] = CLIP32(f);
+        }
+    }
+    else if (width == 3)
+    {
+        for (i = 0; i < n; i++)
+        {
+            float f = from[i] * 8388352.f;
+            int s = ALSA_CLIP(f, 8388351);
+            to[i * step] = s & 255;
+            to[i * step + 1] = (s >> 8) & 255;
+            to[i * step + 2] = (s >> 16) & 255;
+        }
+    }
+    else
+    {
+        t_alsa_sample16 *sp = (t_alsa_sample16 *)to;
+        int stride = step / 2;
+        for (i = 0; i < n; i++)
+        {
+            float f = from[i] * 32767.f;
+            sp[i * stride] = ALSA_CLIP(f, 32767);
+        }
+    }
+}
+
+static void alsa_getsamples(int width, char *from, int step, t_sample *to,
+    int n)
+{
+    int i;
+    if (!to)
+        return;
+    if (width == 4)
+    {
+        t_alsa_sample32 *sp = (t_alsa_sample32 *)from;
+        int stride = step / 4;
+        for (i = 0; i < n; i++)
+            to[i] = sp[i * stride] * (float)(1./INT32_MAX);
+    }
+    else if (width == 3)
+    {
+        unsigned char *bp = (unsigned char *)from;
+        for (i = 0; i < n; i++)
+            to[i] = (t_alsa_sample32)(bp[i * step] << 8 |
+                bp[i * step + 1] << 16 | bp[i * step + 2] << 24)
+                    * (float)(1./INT32_MAX);
+    }
+    else
+    {
+        t_alsa_sample16 *sp = (t_alsa_sample16 *)from;
+        int stride = step / 2;
+        for (i = 0; i < n; i++)
+            to[i] = sp[i * stride] * (float)3.051850e-05;
+    }
+}
+
+    /* frames that can be transferred right now.  For mmap access this also
+    brings the buffer pointers up to date, as snd_pcm_mmap_begin() needs,
+    and restarts the device after an xrun. */
+static snd_pcm_sframes_t alsaio_avail(t_alsa_dev *dev)
+{
+    snd_pcm_sframes_t avail;
+    if (!dev->a_mmap)
+    {
+        snd_pcm_status(dev->a_handle, alsa_status);
+        return (snd_pcm_status_get_avail(alsa_status));
+    }
+    if ((avail = snd_pcm_avail_update(dev->a_handle)) == -EPIPE)
+    {
+        sys_log_error(ERR_RESYNC);
+        snd_pcm_prepare(dev->a_handle);
+        if (snd_pcm_stream(dev->a_handle) == SND_PCM_STREAM_CAPTURE)
+            snd_pcm_start(dev->a_handle);
+        avail = snd_pcm_avail_update(dev->a_handle);
+    }
+    return (avail);
+}
+
+static char *alsaio_areaptr(const snd_pcm_channel_area_t *area,
+    snd_pcm_uframes_t offset)
+{
+    return ((char *)area->addr + (area->first + offset * area->step) / 8);
+}
+
+    /* write "n" frames of "chans" channels (the rest silent) straight into
+    the ring buffer of an mmap device, returning the number written.  The
+    ring may wrap, in which case it takes two goes. */
+static int alsaio_mmapout(t_alsa_dev *dev, t_sample *from, int chans, int n)
+{
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset, frames;
+    int done = 0, i;
+    while (done < n)
+    {
+        frames = n - done;
+        if (snd_pcm_mmap_begin(dev->a_handle, &areas, &offset, &frames) < 0
+            || !frames)
+                break;
+        for (i = 0; i < dev->a_channels; i++)
+            alsa_putsamples(dev->a_sampwidth,
+                (i < chans ? from + i * DEFDACBLKSIZE + done : 0),
+                    alsaio_areaptr(&areas[i], offset), areas[i].step / 8,
+                        frames);
+        if (snd_pcm_mmap_commit(dev->a_handle, offset, frames) < 0)
+            break;
+        done += frames;
+    }
+        /* unlike snd_pcm_writei(), committing doesn't start the device */
+    if (done && snd_pcm_state(dev->a_handle) == SND_PCM_STATE_PREPARED)
+        snd_pcm_start(dev->a_handle);
+    return (done);
+}
+
+    /* the same for input; if "to" is null the frames are just dropped */
+static int alsaio_mmapin(t_alsa_dev *dev, t_sample *to, int chans, int n)
+{
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset, frames;
+    int done = 0, i;
+    while (done < n)
+    {
+        frames = n - done;
+        if (snd_pcm_mmap_begin(dev->a_handle, &areas, &offset, &frames) < 0
+            || !frames)
+                break;
+        for (i = 0; i < chans; i++)
+            alsa_getsamples(dev->a_sampwidth,
+                alsaio_areaptr(&areas[i], offset), areas[i].step / 8,
+                    (to ? to + i * DEFDACBLKSIZE + done : 0), frames);
+        if (snd_pcm_mmap_commit(dev->a_handle, offset, frames) < 0)
+            break;
+        done += frames;
+    }
+    return (done);
+}
+
 static int alsaio_setup(t_alsa_dev *dev, int out, int *channels, int *rate,
     int nfrags, int frag_size)
 {
@@ -112,12 +274,19 @@ static int alsaio_setup(t_alsa_dev *dev, int out, int *channels, int *rate,
     err = snd_pcm_hw_params_any(dev->a_handle, hw_params);
     check_error(err, "snd_pcm_hw_params_any");
 
-        /* try to set interleaved access */
+        /* try to set interleaved access, preferring mmap so that we can
+        convert straight into the device's buffer */
     err = snd_pcm_hw_params_set_access(dev->a_handle,
-        hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+        hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+    dev->a_mmap = (err >= 0);
+    if (!dev->a_mmap)
+        err = snd_pcm_hw_params_set_access(dev->a_handle,
+            hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
     if (err < 0)
         return (-1);
     check_error(err, "snd_pcm_hw_params_set_access");
+    if (sys_verbose && dev->a_mmap)
+        post("using interleaved mmap access");
 #if 0       /* enable this to print out which formats are available */
     {
         int i;
@@ -346,8 +515,7 @@ int alsa_open_audio(int naudioindev, int *audioindev, int nchindev,
         while (i--)
         {
             for (iodev = 0; iodev < alsa_noutdev; iodev++)
-                snd_pcm_writei(alsa_outdev[iodev].a_handle, alsa_snd_buf,
-                    DEFDACBLKSIZE);
+                alsa_putzeros(iodev, 1);
         }
     }
     if (inchans)
@@ -397,8 +565,8 @@ int alsa_send_dacs(void)
     static int callno = 0;
     double timelast = timenow;
 #endif
-    t_sample *fp1, *fp2;
-    int i, j, k, iodev, result, ch; 
+    t_sample *fp1;
+    int i, iodev, result;
     int chansintogo, chansouttogo;
     unsigned int transfersize;
 
@@ -425,81 +593,31 @@ int alsa_send_dacs(void)
         alsa_checkiosync();     /* check I/O are in sync and data not late */
 
     for (iodev = 0; iodev < alsa_nindev; iodev++)
-    {
-        snd_pcm_status(alsa_indev[iodev].a_handle, alsa_status);
-        if (snd_pcm_status_get_avail(alsa_status) < transfersize)
+        if (alsaio_avail(&alsa_indev[iodev]) < (snd_pcm_sframes_t)transfersize)
             return SENDDACS_NO;
-    }
     for (iodev = 0; iodev < alsa_noutdev; iodev++)
-    {
-        snd_pcm_status(alsa_outdev[iodev].a_handle, alsa_status);
-        if (snd_pcm_status_get_avail(alsa_status) < transfersize)
+        if (alsaio_avail(&alsa_outdev[iodev]) < (snd_pcm_sframes_t)transfersize)
             return SENDDACS_NO;
-    }
     /* do output */
-    for (iodev = 0, fp1 = sys_soundout, ch = 0; iodev < alsa_noutdev; iodev++)
+    for (iodev = 0, fp1 = sys_soundout; iodev < alsa_noutdev; iodev++)
     {
-        int thisdevchans = alsa_outdev[iodev].a_channels;
+        t_alsa_dev *dev = &alsa_outdev[iodev];
+        int thisdevchans = dev->a_channels, width = dev->a_sampwidth;
         int chans = (chansouttogo < thisdevchans ? chansouttogo : thisdevchans);
         chansouttogo -= chans;
 
-        if (alsa_outdev[iodev].a_sampwidth == 4)
-        {
-            for (i = 0; i < chans; i++, ch++, fp1 += DEFDACBLKSIZE)
-                for (j = i, k = DEFDACBLKSIZE, fp2 = fp1; k--;
-                     j += thisdevchans, fp2++)
-            {
-                float s1 = *fp2 * INT32_MAX;
-                ((t_alsa_sample32 *)alsa_snd_buf)[j] = CLIP32(s1);
-            } 
-            for (; i < thisdevchans; i++, ch++)
-                for (j = i, k = DEFDACBLKSIZE; k--; j += thisdevchans)
-                    ((t_alsa_sample32 *)alsa_snd_buf)[j] = 0;
-        }
-        else if (alsa_outdev[iodev].a_sampwidth == 3)
-        {
-            for (i = 0; i < chans; i++, ch++, fp1 += DEFDACBLKSIZE)
-                for (j = i, k = DEFDACBLKSIZE, fp2 = fp1; k--;
-                     j += thisdevchans, fp2++)
-            {
-                int s = *fp2 * 8388352.;
-                if (s > 8388351)
-                    s = 8388351;
-                else if (s < -8388351)
-                    s = -8388351;
-#if BYTE_ORDER == LITTLE_ENDIAN                                             
-                ((char *)(alsa_snd_buf))[3*j] = (s & 255);
-                ((char *)(alsa_snd_buf))[3*j+1] = ((s>>8) & 255);
-                ((char *)(alsa_snd_buf))[3*j+2] = ((s>>16) & 255);
-#else
-                fprintf(stderr("big endian 24-bit not supported");
-#endif
-            }
-            for (; i < thisdevchans; i++, ch++)
-                for (j = i, k = DEFDACBLKSIZE; k--; j += thisdevchans)
-                    ((char *)(alsa_snd_buf))[3*j] = 
-                    ((char *)(alsa_snd_buf))[3*j+1] = 
-                    ((char *)(alsa_snd_buf))[3*j+2] = 0;
-        }
-        else        /* 16 bit samples */
+        if (dev->a_mmap)
+            result = alsaio_mmapout(dev, fp1, chans, transfersize);
+        else
         {
-            for (i = 0; i < chans; i++, ch++, fp1 += DEFDACBLKSIZE)
-                for (j = ch, k = DEFDACBLKSIZE, fp2 = fp1; k--;
-                     j += thisdevchans, fp2++)
-            {
-                int s = *fp2 * 32767.;
-                if (s > 32767)
-                    s = 32767;
-                else if (s < -32767)
-                    s = -32767;
-                ((t_alsa_sample16 *)alsa_snd_buf)[j] = s;
-            }
-            for (; i < thisdevchans; i++, ch++)
-                for (j = ch, k = DEFDACBLKSIZE; k--; j += thisdevchans)
-                    ((t_alsa_sample16 *)alsa_snd_buf)[j] = 0;
+            for (i = 0; i < thisdevchans; i++)
+                alsa_putsamples(width, (i < chans ? fp1 + i * DEFDACBLKSIZE : 0),
+                    alsa_snd_buf + i * width, thisdevchans * width,
+                        transfersize);
+            result = snd_pcm_writei(dev->a_handle, alsa_snd_buf,
+                transfersize);
         }
-        result = snd_pcm_writei(alsa_outdev[iodev].a_handle, alsa_snd_buf,
-            transfersize);
+        fp1 += chans * DEFDACBLKSIZE;
 
         if (result != (int)transfersize)
         {
@@ -519,9 +637,6 @@ int alsa_send_dacs(void)
             return (SENDDACS_NO);
         }
 
-        /* zero out the output buffer */
-        memset(sys_soundout, 0, DEFDACBLKSIZE * sizeof(*sys_soundout) *
-               sys_outchannels);
         if (sys_getrealtime() - timenow > 0.002)
         {
     #ifdef DEBUG_ALSA_XFER
@@ -532,14 +647,20 @@ int alsa_send_dacs(void)
             sys_log_error(ERR_DACSLEPT);
         }
     }
+        /* zero out the output buffer */
+    memset(sys_soundout, 0, DEFDACBLKSIZE * sizeof(*sys_soundout) *
+           sys_outchannels);
 
             /* do input */
-    for (iodev = 0, fp1 = sys_soundin, ch = 0; iodev < alsa_nindev; iodev++)
+    for (iodev = 0, fp1 = sys_soundin; iodev < alsa_nindev; iodev++)
     {
-        int thisdevchans = alsa_indev[iodev].a_channels;
+        t_alsa_dev *dev = &alsa_indev[iodev];
+        int thisdevchans = dev->a_channels, width = dev->a_sampwidth;
         int chans = (chansintogo < thisdevchans ? chansintogo : thisdevchans);
-        chansouttogo -= chans;
-        result = snd_pcm_readi(alsa_indev[iodev].a_handle, alsa_snd_buf,
+        chansintogo -= chans;
+        if (dev->a_mmap)
+            result = alsaio_mmapin(dev, fp1, chans, transfersize);
+        else result = snd_pcm_readi(dev->a_handle, alsa_snd_buf,
             transfersize);
         if (result < (int)transfersize)
         {
@@ -560,43 +681,12 @@ int alsa_send_dacs(void)
             sys_log_error(ERR_ADCSLEPT);
             return (SENDDACS_NO);
         }
-        if (alsa_indev[iodev].a_sampwidth == 4)
-        {
-            for (i = 0; i < chans; i++, ch++, fp1 += DEFDACBLKSIZE)
-            {
-                for (j = ch, k = DEFDACBLKSIZE, fp2 = fp1; k--;
-                     j += thisdevchans, fp2++)
-                    *fp2 = (float) ((t_alsa_sample32 *)alsa_snd_buf)[j]
-                        * (1./ INT32_MAX);
-            }
-        }
-        else if (alsa_indev[iodev].a_sampwidth == 3)
-        {
-#if BYTE_ORDER == LITTLE_ENDIAN                                             
-            for (i = 0; i < chans; i++, ch++, fp1 += DEFDACBLKSIZE)
-            {
-                for (j = ch, k = DEFDACBLKSIZE, fp2 = fp1; k--;
-                     j += thisdevchans, fp2++)
-                    *fp2 = ((float) (
-                        (((unsigned char *)alsa_snd_buf)[3*j] << 8)
-                        | (((unsigned char *)alsa_snd_buf)[3*j+1] << 16)
-                        | (((unsigned char *)alsa_snd_buf)[3*j+2] << 24)))
-                        * (1./ INT32_MAX);
-            }
-#else
-                fprintf(stderr("big endian 24-bit not supported");
-#endif
-        }
-        else
-        {
-            for (i = 0; i < chans; i++, ch++, fp1 += DEFDACBLKSIZE)
-            {
-                for (j = ch, k = DEFDACBLKSIZE, fp2 = fp1; k--;
-                    j += thisdevchans, fp2++)
-                        *fp2 = (float) ((t_alsa_sample16 *)alsa_snd_buf)[j]
-                            * 3.051850e-05;
-            }
-        }
+        if (!dev->a_mmap)
+            for (i = 0; i < chans; i++)
+                alsa_getsamples(width, alsa_snd_buf + i * width,
+                    thisdevchans * width, fp1 + i * DEFDACBLKSIZE,
+                        transfersize);
+        fp1 += chans * DEFDACBLKSIZE;
     }
 #ifdef DEBUG_ALSA_XFER
     xferno++;
@@ -654,8 +744,10 @@ void alsa_resync( void)
             DEFDACBLKSIZE * sys_outchannels);
     for (i = 0; i < 1000000; i++)
     {
-        result = snd_pcm_writei(alsa_outdev[iodev].a_handle, alsa_snd_buf,
-            DEFDACBLKSIZE);
+        if (alsa_outdev[iodev].a_mmap)
+            result = alsaio_mmapout(&alsa_outdev[iodev], 0, 0, DEFDACBLKSIZE);
+        else result = snd_pcm_writei(alsa_outdev[iodev].a_handle,
+            alsa_snd_buf, DEFDACBLKSIZE);
         if (result != (int)DEFDACBLKSIZE)
             break;
     }
@@ -670,8 +762,10 @@ void alsa_putzeros(int iodev, int n)
             alsa_outdev[iodev].a_channels);
     for (i = 0; i < n; i++)
     {
-        result = snd_pcm_writei(alsa_outdev[iodev].a_handle, alsa_snd_buf,
-            DEFDACBLKSIZE);
+        if (alsa_outdev[iodev].a_mmap)
+            result = alsaio_mmapout(&alsa_outdev[iodev], 0, 0, DEFDACBLKSIZE);
+        else result = snd_pcm_writei(alsa_outdev[iodev].a_handle,
+            alsa_snd_buf, DEFDACBLKSIZE);
 #if 0
         if (result != DEFDACBLKSIZE)
             post("result %d", result);
@@ -685,8 +779,10 @@ void alsa_getzeros(int iodev, int n)
     int i, result;
     for (i = 0; i < n; i++)
     {
-        result = snd_pcm_readi(alsa_indev[iodev].a_handle, alsa_snd_buf,
-            DEFDACBLKSIZE);
+        if (alsa_indev[iodev].a_mmap)
+            result = alsaio_mmapin(&alsa_indev[iodev], 0, 0, DEFDACBLKSIZE);
+        else result = snd_pcm_readi(alsa_indev[iodev].a_handle,
+            alsa_snd_buf, DEFDACBLKSIZE);
 #if 0
         if (result != DEFDACBLKSIZE)
             post("result %d", result);
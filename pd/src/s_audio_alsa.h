@@ -28,6 +28,7 @@ typedef struct _alsa_dev
     int a_channels;
     char **a_addr;
     int a_synced; 
+    int a_mmap;         /* interleaved mmap access, see alsaio_mmapout() */
 } t_alsa_dev;
 
 extern t_alsa_dev alsa_indev[ALSA_MAXDEV];
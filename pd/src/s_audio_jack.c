@@ -29,6 +29,8 @@ static int outport_count = 0;
 static jack_client_t *jack_client = NULL;
 char *jack_client_names[MAX_CLIENTS];
 static int jack_dio_error;
+static t_audiocallback jack_callback;   /* scheduler to run in process() */
+static int jack_cbphase;    /* frames into the current block, see below */
 
 
 pthread_mutex_t jack_mutex;
@@ -40,11 +42,110 @@ int jack_get_srate(void)
     else return 0;
 }
 
+static void jack_copyin(t_sample *to, jack_default_audio_sample_t *from,
+    int n)
+{
+    if (sizeof(t_sample) == sizeof(jack_default_audio_sample_t))
+        memcpy(to, from, n * sizeof(t_sample));
+    else while (n--)
+        *to++ = *from++;
+}
+
+static void jack_copyout(jack_default_audio_sample_t *to, t_sample *from,
+    int n)
+{
+    if (sizeof(t_sample) == sizeof(jack_default_audio_sample_t))
+        memcpy(to, from, n * sizeof(t_sample));
+    else while (n--)
+        *to++ = *from++;
+}
+
+    /* callback mode: run the scheduler right here, one tick per
+    DEFDACBLKSIZE frames, copying straight between the port buffers and
+    sys_soundin/sys_soundout, with no handoff to the scheduler thread.  If
+    the period isn't a multiple of the block size the output goes through
+    jack_outbuf and is one block late, so that a tick can run as soon as a
+    whole block of input has come in.
+        A tick may close or reopen the audio (turning DSP off, or changing
+    the settings), which clears jack_callback or reallocates sys_soundin and
+    sys_soundout; so they are all read once here, and if any of them has
+    changed after a tick the rest of the period is left silent. */
+static void jack_callbackprocess(jack_nframes_t nframes,
+    t_audiocallback callback)
+{
+    jack_default_audio_sample_t *in[NUM_JACK_PORTS], *out[NUM_JACK_PORTS];
+    t_sample *soundin = sys_soundin, *soundout = sys_soundout;
+    int inchans = sys_inchannels, outchans = sys_outchannels;
+    int j, n, frame;
+    for (j = 0; j < inchans; j++)
+        in[j] = jack_port_get_buffer(input_port[j], nframes);
+    for (j = 0; j < outchans; j++)
+        out[j] = jack_port_get_buffer(output_port[j], nframes);
+    if (!jack_cbphase && !(nframes % DEFDACBLKSIZE))
+    {
+        for (frame = 0; frame < nframes; frame += DEFDACBLKSIZE)
+        {
+            for (j = 0; j < inchans; j++)
+                jack_copyin(soundin + j * DEFDACBLKSIZE, in[j] + frame,
+                    DEFDACBLKSIZE);
+            (*callback)();
+            if (jack_callback != callback || sys_soundin != soundin ||
+                sys_soundout != soundout)
+                    goto reopened;
+            for (j = 0; j < outchans; j++)
+                jack_copyout(out[j] + frame, soundout + j * DEFDACBLKSIZE,
+                    DEFDACBLKSIZE);
+            memset(soundout, 0,
+                DEFDACBLKSIZE * sizeof(t_sample) * outchans);
+        }
+        return;
+    }
+    for (frame = 0; frame < nframes; frame += n)
+    {
+        n = DEFDACBLKSIZE - jack_cbphase;
+        if (n > nframes - frame)
+            n = nframes - frame;
+        for (j = 0; j < inchans; j++)
+            jack_copyin(soundin + j * DEFDACBLKSIZE + jack_cbphase,
+                in[j] + frame, n);
+        for (j = 0; j < outchans; j++)
+            jack_copyout(out[j] + frame,
+                jack_outbuf + j * DEFDACBLKSIZE + jack_cbphase, n);
+        if ((jack_cbphase += n) == DEFDACBLKSIZE)
+        {
+            (*callback)();
+            jack_cbphase = 0;
+            if (jack_callback != callback || sys_soundin != soundin ||
+                sys_soundout != soundout)
+            {
+                frame += n;
+                goto reopened;
+            }
+            memcpy(jack_outbuf, soundout,
+                DEFDACBLKSIZE * sizeof(t_sample) * outchans);
+            memset(soundout, 0,
+                DEFDACBLKSIZE * sizeof(t_sample) * outchans);
+        }
+    }
+    return;
+reopened:
+    memset(jack_outbuf, 0, sizeof(jack_outbuf));
+    for (j = 0; j < outchans; j++)
+        memset(out[j] + frame, 0,
+            (nframes - frame) * sizeof(jack_default_audio_sample_t));
+}
+
 static int process (jack_nframes_t nframes, void *arg)
 {
     int j;
     jack_default_audio_sample_t *out, *in;
-        
+    t_audiocallback callback = jack_callback;
+
+    if (callback)
+    {
+        jack_callbackprocess(nframes, callback);
+        return 0;
+    }
     if (nframes > JACK_OUT_MAX) jack_out_max = nframes;
     else jack_out_max = JACK_OUT_MAX;
     if (jack_filled >= nframes)
@@ -257,7 +358,8 @@ void jack_error(const char *desc)
 }
 
 
-int jack_open_audio(int inchans, int outchans, int rate)
+int jack_open_audio(int inchans, int outchans, int rate,
+    t_audiocallback callback)
 {
     int j;
     char port_name[80] = "";
@@ -267,6 +369,7 @@ int jack_open_audio(int inchans, int outchans, int rate)
     jack_status_t status;
 
     jack_dio_error = 0;
+    jack_cbphase = 0;
     
     if ((inchans == 0) && (outchans == 0)) return 0;
 
@@ -402,6 +505,10 @@ int jack_open_audio(int inchans, int outchans, int rate)
     } 
     outport_count = outchans;
 
+    memset(jack_outbuf,0,sizeof(jack_outbuf));
+    jack_cbphase = 0;
+    jack_callback = callback;
+
     /* tell the JACK server that we are ready to roll */
 
     if (new_jack)
@@ -427,6 +534,7 @@ int jack_open_audio(int inchans, int outchans, int rate)
 void jack_close_audio(void) 
 
 {
+    jack_callback = 0;
     jack_started = 0;
     pthread_cond_broadcast(&jack_sem);
 }
@@ -5,6 +5,9 @@
 /* Pd side of the Pd/Pd-gui interface.  Also, some system interface routines
 that didn't really belong anywhere. */
 
+#ifdef __linux__
+#define _GNU_SOURCE     /* for recvmmsg() */
+#endif
 #include "config.h"
 
 #include "m_pd.h"
@@ -67,6 +70,7 @@ typedef int socklen_t;
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #ifdef __APPLE__
 #include <sys/types.h>
@@ -108,6 +112,18 @@ static int stderr_isatty;
    available. */
 #ifdef __linux__
 #include <execinfo.h>
+#endif
+
+    /* on Linux the scheduler waits for input with epoll instead of select */
+#ifdef __linux__
+#define USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#define EPOLL_MAXEVENTS 64
+    /* ... and takes UDP datagrams from the kernel several at a time */
+#define USE_RECVMMSG
+#define UDP_BATCH 32        /* datagrams per recvmmsg() call */
+#define UDP_BUDGET 256      /* most datagrams read per poll of a socket */
 #endif
 
 typedef struct _fdpoll
@@ -115,6 +131,8 @@ typedef struct _fdpoll
     int fdp_fd;
     t_fdpollfn fdp_fn;
     void *fdp_ptr;
+    int fdp_id;         /* registration, see sys_addpollfn() */
+    int fdp_pending;    /* handed to the input queue, don't poll for now */
 } t_fdpoll;
 
 #define INBUFSIZE 4096
@@ -126,8 +144,10 @@ struct _socketreceiver
     int sr_intail;
     void *sr_owner;
     int sr_udp;
+    int sr_binary;      /* pass bytes on as floats instead of parsing them */
     t_socketnotifier sr_notifier;
     t_socketreceivefn sr_socketreceivefn;
+    t_socketnotifier sr_acceptfn;   /* if listening, told of connections */
 };
 
 extern char *pd_version;
@@ -136,6 +156,12 @@ extern int sys_guisetportnumber;
 static int sys_nfdpoll;
 static t_fdpoll *sys_fdpoll;
 static int sys_maxfd;
+static int *sys_fdindex;    /* sys_fdpoll index by descriptor, or -1 */
+static int sys_nfdindex;
+#ifdef USE_EPOLL
+static int sys_epollfd = -1;
+static int sys_timerfd = -1;    /* wakes epoll_wait() to the microsecond */
+#endif
 static int sys_guisock;
 
 static t_binbuf *inbinbuf;
@@ -196,6 +222,90 @@ double sys_getrealtime(void)
 
 extern int sys_nosleep;
 static int fdschanged;
+static int sys_inqueue;     /* true while the main thread feeds the queue */
+static pthread_t sys_inqueuethread;     /* ... which is this one */
+
+    /* the poll entry for a descriptor, or null */
+static t_fdpoll *sys_findfdpoll(int fd)
+{
+    return (fd >= 0 && fd < sys_nfdindex && sys_fdindex[fd] >= 0 ?
+        &sys_fdpoll[sys_fdindex[fd]] : 0);
+}
+
+#ifdef USE_EPOLL
+    /* Descriptors are registered level-triggered: poll functions read
+    once per call from sockets which may block, so an edge-triggered
+    descriptor would lose whatever is left after that read. */
+static int sys_epollinit(void)
+{
+    struct epoll_event ev;
+    if (sys_epollfd >= 0)
+        return (1);
+    if ((sys_epollfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        perror("epoll_create1");
+        return (0);
+    }
+    if ((sys_timerfd = timerfd_create(CLOCK_MONOTONIC,
+        TFD_NONBLOCK | TFD_CLOEXEC)) >= 0)
+    {
+        ev.events = EPOLLIN;
+        ev.data.fd = sys_timerfd;
+        epoll_ctl(sys_epollfd, EPOLL_CTL_ADD, sys_timerfd, &ev);
+    }
+    return (1);
+}
+
+static int sys_epollwait(int microsec)
+{
+    struct epoll_event ev[EPOLL_MAXEVENTS];
+    int i, nev, timeout = 0, didsomething = 0;
+    t_fdpoll *fp;
+        /* epoll_wait() only counts whole milliseconds, so shorter sleeps
+        go by the timer instead (re-arming it also clears an old
+        expiration); a sleep of a millisecond or more is rounded down. */
+    if (microsec >= 1000)
+        timeout = microsec / 1000;
+    else if (microsec > 0)
+    {
+        struct itimerspec it;
+        it.it_interval.tv_sec = it.it_interval.tv_nsec = 0;
+        it.it_value.tv_sec = 0;
+        it.it_value.tv_nsec = microsec * 1000;
+        if (sys_timerfd >= 0 && !timerfd_settime(sys_timerfd, 0, &it, 0))
+            timeout = -1;
+        else timeout = 1;
+    }
+    if ((nev = epoll_wait(sys_epollfd, ev, EPOLL_MAXEVENTS, timeout)) < 0)
+    {
+        if (errno != EINTR)
+            perror("microsleep epoll_wait");
+        return (0);
+    }
+    fdschanged = 0;
+    for (i = 0; i < nev && !fdschanged; i++)
+        if (ev[i].data.fd == sys_timerfd)
+    {
+            /* read the expiration off, or a timer that went off after an
+            earlier wait ended would keep waking the longer ones up */
+        uint64_t nexp;
+        if (read(sys_timerfd, &nexp, sizeof(nexp)) < 0 && errno != EAGAIN)
+            perror("microsleep timerfd");
+    }
+        else if ((fp = sys_findfdpoll(ev[i].data.fd)))
+    {
+#ifdef THREAD_LOCKING
+        sys_lock();
+#endif
+        (*fp->fdp_fn)(fp->fdp_ptr, fp->fdp_fd);
+#ifdef THREAD_LOCKING
+        sys_unlock();
+#endif
+        didsomething = 1;
+    }
+    return (didsomething);
+}
+#endif /* USE_EPOLL */
 
 static int sys_domicrosleep(int microsec, int pollem)
 {
@@ -204,7 +314,16 @@ static int sys_domicrosleep(int microsec, int pollem)
     t_fdpoll *fp;
     timout.tv_sec = 0;
     timout.tv_usec = (sys_nosleep ? 0 : microsec);
-    if (pollem && sys_nfdpoll)
+#ifdef USE_EPOLL
+    if (pollem && sys_nfdpoll && !sys_inqueue && sys_epollfd >= 0)
+    {
+        if (sys_epollwait(sys_nosleep ? 0 : microsec))
+            return (1);
+    }
+    else
+#endif
+        /* in callback mode the main thread does the reading; see below */
+    if (pollem && sys_nfdpoll && !sys_inqueue)
     {
         fd_set readset, writeset, exceptset;
         FD_ZERO(&writeset);
@@ -433,68 +552,181 @@ void sys_sockerror(char *s)
     fprintf(stderr, "%s: %s (%d)\n", s, strerror(err), err);
 }
 
-void sys_addpollfn(int fd, t_fdpollfn fn, void *ptr)
+    /* Every registration of a descriptor gets an id, so that input queued
+    for it can be told from input for a later one that reused the number.
+    While input is queued (see below) the poll list belongs to the main
+    thread, and sys_addpollfn() and sys_rmpollfn() only ask for changes;
+    the lock holder keeps its own account of what is polled here. */
+static int sys_pollid;
+
+typedef struct _fdstate
+{
+    int fs_id;          /* registration id, or 0 if not polled */
+    int fs_closing;     /* removed while queueing; the main thread closes it */
+} t_fdstate;
+
+static t_fdstate *sys_fdstate;
+static int sys_nfdstate;
+
+#define INQ_ADD 0       /* requests to the main thread, see inqueue_request() */
+#define INQ_REMOVE 1
+#define INQ_CLOSE 2
+#define INQ_RESUME 3
+#define INQ_FREE 4
+
+static void inqueue_request(int op, int fd, int id, t_fdpollfn fn,
+    void *ptr);
+
+static int sys_fdislive(int fd, int id)
+{
+    return (fd >= 0 && fd < sys_nfdstate && sys_fdstate[fd].fs_id == id);
+}
+
+static void sys_doaddpollfn(int fd, t_fdpollfn fn, void *ptr, int id)
 {
     int nfd = sys_nfdpoll;
     int size = nfd * sizeof(t_fdpoll);
     t_fdpoll *fp;
+#ifdef USE_EPOLL
+    struct epoll_event ev;
+#endif
     sys_fdpoll = (t_fdpoll *)t_resizebytes(sys_fdpoll, size,
         size + sizeof(t_fdpoll));
     fp = sys_fdpoll + nfd;
     fp->fdp_fd = fd;
     fp->fdp_fn = fn;
     fp->fdp_ptr = ptr;
+    fp->fdp_id = id;
+    fp->fdp_pending = 0;
     sys_nfdpoll = nfd + 1;
     if (fd >= sys_maxfd) sys_maxfd = fd + 1;
+    if (fd >= sys_nfdindex)
+    {
+        int i, newn = 2 * fd + 16;
+        sys_fdindex = (int *)t_resizebytes(sys_fdindex,
+            sys_nfdindex * sizeof(int), newn * sizeof(int));
+        for (i = sys_nfdindex; i < newn; i++)
+            sys_fdindex[i] = -1;
+        sys_nfdindex = newn;
+    }
+    sys_fdindex[fd] = nfd;
+#ifdef USE_EPOLL
+    if (sys_epollinit())
+    {
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(sys_epollfd, EPOLL_CTL_ADD, fd, &ev) < 0 &&
+            errno != EEXIST)
+                perror("epoll_ctl");
+    }
+#endif
     fdschanged = 1;
 }
 
-void sys_rmpollfn(int fd)
+    /* the last entry takes the removed one's place */
+static void sys_dormpollfn(int fd, int id)
 {
     int nfd = sys_nfdpoll;
-    int i, size = nfd * sizeof(t_fdpoll);
+    int size = nfd * sizeof(t_fdpoll);
     t_fdpoll *fp;
     fdschanged = 1;
-    for (i = nfd, fp = sys_fdpoll; i--; fp++)
+    if ((fp = sys_findfdpoll(fd)) && fp->fdp_id == id)
     {
-        if (fp->fdp_fd == fd)
-        {
-            while (i--)
-            {
-                fp[0] = fp[1];
-                fp++;
-            }
-            sys_fdpoll = (t_fdpoll *)t_resizebytes(sys_fdpoll, size,
-                size - sizeof(t_fdpoll));
-            sys_nfdpoll = nfd - 1;
-            return;
-        }
+        *fp = sys_fdpoll[nfd - 1];
+        sys_fdindex[fp->fdp_fd] = fp - sys_fdpoll;
+        sys_fdindex[fd] = -1;
+        sys_fdpoll = (t_fdpoll *)t_resizebytes(sys_fdpoll, size,
+            size - sizeof(t_fdpoll));
+        sys_nfdpoll = nfd - 1;
+#ifdef USE_EPOLL
+            /* fails harmlessly if the descriptor was already closed */
+        if (sys_epollfd >= 0)
+            epoll_ctl(sys_epollfd, EPOLL_CTL_DEL, fd, 0);
+#endif
+    }
+}
+
+static void sys_setfdid(int fd, int id)
+{
+    if (fd >= sys_nfdstate)
+    {
+        int newn = 2 * fd + 16;
+        sys_fdstate = (t_fdstate *)t_resizebytes(sys_fdstate,
+            sys_nfdstate * sizeof(t_fdstate), newn * sizeof(t_fdstate));
+        sys_nfdstate = newn;
+    }
+    sys_fdstate[fd].fs_id = id;
+    sys_fdstate[fd].fs_closing = 0;
+}
+
+void sys_addpollfn(int fd, t_fdpollfn fn, void *ptr)
+{
+    int id = __sync_add_and_fetch(&sys_pollid, 1);
+    sys_setfdid(fd, id);
+    inqueue_request(INQ_ADD, fd, id, fn, ptr);
+}
+
+void sys_rmpollfn(int fd)
+{
+    if (fd < 0 || fd >= sys_nfdstate || !sys_fdstate[fd].fs_id)
+    {
+        post("warning: %d removed from poll list but not found", fd);
+        return;
     }
-    post("warning: %d removed from poll list but not found", fd);
+    inqueue_request(INQ_REMOVE, fd, sys_fdstate[fd].fs_id, 0, 0);
+    sys_fdstate[fd].fs_id = 0;
+        /* the main thread may be reading it; see sys_closesocket() */
+    sys_fdstate[fd].fs_closing = sys_inqueue;
 }
 
 t_socketreceiver *socketreceiver_new(void *owner, t_socketnotifier notifier,
     t_socketreceivefn socketreceivefn, int udp)
 {
     t_socketreceiver *x = (t_socketreceiver *)getbytes(sizeof(*x));
+        /* with -nogui sys_startgui() never runs to make this */
+    if (!inbinbuf)
+        inbinbuf = binbuf_new();
     x->sr_inhead = x->sr_intail = 0;
     x->sr_owner = owner;
     x->sr_notifier = notifier;
     x->sr_socketreceivefn = socketreceivefn;
     x->sr_udp = udp;
+    x->sr_binary = 0;
+    x->sr_acceptfn = 0;
     if (!(x->sr_inbuf = malloc(INBUFSIZE))) bug("t_socketreceiver");;
     return (x);
 }
 
-void socketreceiver_free(t_socketreceiver *x)
+    /* hand whatever arrives to socketreceivefn as a list of byte values,
+    rather than parsing it as messages */
+void socketreceiver_setbinary(t_socketreceiver *x, int onoff)
+{
+    x->sr_binary = (onoff != 0);
+}
+
+    /* make the receiver of a listening stream socket accept connections.
+    Each gets a receiver like this one, and then "fn" is told the new
+    descriptor. */
+void socketreceiver_listen(t_socketreceiver *x, t_socketnotifier fn)
+{
+    x->sr_acceptfn = fn;
+}
+
+static void socketreceiver_dofree(t_socketreceiver *x)
 {
     free(x->sr_inbuf);
     freebytes(x, sizeof(*x));
 }
 
+void socketreceiver_free(t_socketreceiver *x)
+{
+        /* the main thread might still be reading into it */
+    inqueue_request(INQ_FREE, -1, 0, 0, x);
+}
+
     /* this is in a separately called subroutine so that the buffer isn't
     sitting on the stack while the messages are getting passed. */
-static int socketreceiver_doread(t_socketreceiver *x)
+static int socketreceiver_doread(t_socketreceiver *x, t_binbuf *b)
 {
     char messbuf[INBUFSIZE], *bp = messbuf;
     int indx, first = 1;
@@ -511,7 +743,7 @@ static int socketreceiver_doread(t_socketreceiver *x)
         if (c == ';' && (!indx || inbuf[indx-1] != '\\'))
         {
             intail = (indx+1)&(INBUFSIZE-1);
-            binbuf_text(inbinbuf, messbuf, (int)(bp - messbuf));
+            binbuf_text(b, messbuf, (int)(bp - messbuf));
             if (sys_debuglevel & DEBUG_MESSDOWN) {
                 if (stderr_isatty)
                     fprintf(stderr,"\n<- \e[0;1;36m%.*s\e[0m", (int)(bp - messbuf), messbuf);
@@ -526,48 +758,182 @@ static int socketreceiver_doread(t_socketreceiver *x)
     return (0);
 }
 
+    /* parse and send on one datagram; "buf" has room for a terminator */
+static void socketreceiver_doudp(t_socketreceiver *x, char *buf, int ret)
+{
+    buf[ret] = 0;
+#if 0
+    post("%s", buf);
+#endif
+    if (buf[ret-1] != '\n')
+    {
+#if 0
+        buf[ret] = 0;
+        error("dropped bad buffer %s\n", buf);
+#endif
+    }
+    else
+    {
+        char *semi = strchr(buf, ';');
+        if (semi) 
+            *semi = 0;
+        binbuf_text(inbinbuf, buf, strlen(buf));
+        outlet_setstacklim();
+        if (x->sr_socketreceivefn)
+            (*x->sr_socketreceivefn)(x->sr_owner, inbinbuf);
+        else bug("socketreceiver_getudp");
+    }
+}
+
+#ifdef USE_RECVMMSG
+    /* read what's waiting, up to UDP_BUDGET datagrams, UDP_BATCH per system
+    call.  A receiver may be closed by a message it passes on; then the
+    rest of what we read is dropped with it. */
+static int socketreceiver_getudpbatch(t_socketreceiver *x, int fd)
+{
+    static char (*bufs)[INBUFSIZE+1];
+    static struct mmsghdr *msgs;
+    static struct iovec *iovs;
+    static int busy;
+    int i, n, total = 0;
+    t_fdpoll *fp;
+    if (busy)
+        return (0);
+    if (!bufs)
+    {
+        bufs = getbytes(UDP_BATCH * sizeof(*bufs));
+        msgs = (struct mmsghdr *)getbytes(UDP_BATCH * sizeof(*msgs));
+        iovs = (struct iovec *)getbytes(UDP_BATCH * sizeof(*iovs));
+        for (i = 0; i < UDP_BATCH; i++)
+        {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = INBUFSIZE;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+    busy = 1;
+    while (total < UDP_BUDGET)
+    {
+        if ((n = recvmmsg(fd, msgs, UDP_BATCH, MSG_DONTWAIT, 0)) < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                sys_sockerror("recv");
+                sys_rmpollfn(fd);
+                sys_closesocket(fd);
+            }
+            break;
+        }
+        for (i = 0; i < n; i++)
+        {
+            if (msgs[i].msg_len > 0)
+                socketreceiver_doudp(x, bufs[i], msgs[i].msg_len);
+            if (!(fp = sys_findfdpoll(fd)) || fp->fdp_ptr != x)
+                goto done;
+        }
+        total += n;
+        if (n < UDP_BATCH)
+            break;
+    }
+done:
+    busy = 0;
+    return (1);
+}
+#endif /* USE_RECVMMSG */
+
 static void socketreceiver_getudp(t_socketreceiver *x, int fd)
 {
     char buf[INBUFSIZE+1];
-    int ret = recv(fd, buf, INBUFSIZE, 0);
-    if (ret < 0)
+    int ret;
+#ifdef USE_RECVMMSG
+    if (socketreceiver_getudpbatch(x, fd))
+        return;
+#endif
+    if ((ret = recv(fd, buf, INBUFSIZE, 0)) < 0)
     {
         sys_sockerror("recv");
         sys_rmpollfn(fd);
         sys_closesocket(fd);
     }
     else if (ret > 0)
+        socketreceiver_doudp(x, buf, ret);
+}
+
+void sys_exit(void);
+
+    /* the socket failed or the other end closed it */
+static void socketreceiver_drop(t_socketreceiver *x, int fd)
+{
+    if (x == sys_socketreceiver)
     {
-        buf[ret] = 0;
-#if 0
-        post("%s", buf);
-#endif
-        if (buf[ret-1] != '\n')
-        {
-#if 0
-            buf[ret] = 0;
-            error("dropped bad buffer %s\n", buf);
-#endif
-        }
-        else
-        {
-            char *semi = strchr(buf, ';');
-            if (semi) 
-                *semi = 0;
-            binbuf_text(inbinbuf, buf, strlen(buf));
-            outlet_setstacklim();
-            if (x->sr_socketreceivefn)
-                (*x->sr_socketreceivefn)(x->sr_owner, inbinbuf);
-            else bug("socketreceiver_getudp");
-        }
+        fprintf(stderr, "pd: exiting\n");
+        sys_exit();
+        return;
     }
+    if (x->sr_notifier && !x->sr_udp)
+        (*x->sr_notifier)(x->sr_owner, fd);
+    sys_rmpollfn(fd);
+    sys_closesocket(fd);
 }
 
-void sys_exit(void);
+    /* read what's waiting into "b" as a list of byte values; returns what
+    recv() did */
+static int socketreceiver_getbinary(t_socketreceiver *x, int fd, t_binbuf *b)
+{
+    unsigned char buf[MAXPDSTRING];
+    t_atom vec[MAXPDSTRING];
+    int ret = recv(fd, buf, MAXPDSTRING, 0), i;
+    if (ret < 0)
+        sys_sockerror("recv");
+    for (i = 0; i < ret; i++)
+        SETFLOAT(&vec[i], buf[i]);
+    binbuf_clear(b);
+    binbuf_add(b, (ret > 0 ? ret : 0), vec);
+    return (ret);
+}
+
+    /* accept a connection on a listening socket, returning a receiver for
+    it like the listening one, or null if there was none */
+static t_socketreceiver *socketreceiver_accept(t_socketreceiver *x, int fd,
+    int *newfdp)
+{
+    t_socketreceiver *y;
+    if ((*newfdp = accept(fd, 0, 0)) < 0)
+    {
+        sys_sockerror("accept");
+        return (0);
+    }
+    y = socketreceiver_new(x->sr_owner, x->sr_notifier,
+        x->sr_socketreceivefn, 0);
+    y->sr_binary = x->sr_binary;
+    return (y);
+}
 
 void socketreceiver_read(t_socketreceiver *x, int fd)
 {
-    if (x->sr_udp)   /* UDP ("datagram") socket protocol */
+    if (x->sr_acceptfn)
+    {
+        int newfd;
+        t_socketreceiver *y = socketreceiver_accept(x, fd, &newfd);
+        if (y)
+        {
+            sys_addpollfn(newfd, (t_fdpollfn)socketreceiver_read, y);
+            (*x->sr_acceptfn)(x->sr_owner, newfd);
+        }
+    }
+    else if (x->sr_binary)
+    {
+        int ret = socketreceiver_getbinary(x, fd, inbinbuf);
+        if (ret > 0)
+        {
+            outlet_setstacklim();
+            (*x->sr_socketreceivefn)(x->sr_owner, inbinbuf);
+        }
+        else if (ret < 0 || !x->sr_udp)
+            socketreceiver_drop(x, fd);
+    }
+    else if (x->sr_udp)   /* UDP ("datagram") socket protocol */
         socketreceiver_getudp(x, fd);
     else  /* TCP ("streaming") socket protocol */
     {
@@ -617,7 +983,7 @@ void socketreceiver_read(t_socketreceiver *x, int fd)
             {
                 x->sr_inhead += ret;
                 if (x->sr_inhead >= INBUFSIZE) x->sr_inhead = 0;
-                while (socketreceiver_doread(x))
+                while (socketreceiver_doread(x, inbinbuf))
                 {
                     outlet_setstacklim();
                     if (x->sr_socketreceivefn)
@@ -631,7 +997,7 @@ void socketreceiver_read(t_socketreceiver *x, int fd)
     }
 }
 
-void sys_closesocket(int fd)
+static void sys_doclosesocket(int fd)
 {
 #ifdef HAVE_UNISTD_H
     if (fd<0) return;
@@ -642,6 +1008,363 @@ void sys_closesocket(int fd)
 #endif
 }
 
+    /* a descriptor just taken off the poll list while input is queued is
+    closed by the main thread, once it has stopped reading it -- otherwise
+    the number could be reused before then */
+void sys_closesocket(int fd)
+{
+    if (fd >= 0 && fd < sys_nfdstate && sys_fdstate[fd].fs_closing)
+    {
+        sys_fdstate[fd].fs_closing = 0;
+        inqueue_request(INQ_CLOSE, fd, 0, 0, 0);
+    }
+    else sys_doclosesocket(fd);
+}
+
+/* ------------------ queueing input for the audio thread -------------- */
+
+    /* In callback mode the audio callback shouldn't be reading sockets and
+    parsing text, nor waiting for a thread that does.  Instead the main
+    thread polls the sockets and passes what it reads to whoever holds
+    sys_lock() (normally the audio callback) through a single-producer,
+    single-consumer ring: only the main thread fills entries and advances
+    inq_head, and only the lock holder reads them and advances inq_tail.
+    Entries are parsed messages, bytes from binary receivers, accepted
+    connections and sockets that failed or were closed.  Poll functions
+    other than socketreceiver_read() are queued whole, to be called under
+    the lock; their descriptor isn't polled again until then.
+
+    The poll list is the main thread's meanwhile.  The lock holder's changes
+    to it go the other way through a second ring, of requests, which the
+    main thread takes before it polls.  Each entry carries the registration
+    it came from, so the lock holder can skip those for descriptors it has
+    removed since. */
+
+#define INQUEUESIZE 256     /* must be a power of two */
+#define INREQUESTSIZE 256   /* ditto */
+
+#define INQ_MESSAGE 0       /* kinds of entry */
+#define INQ_ACCEPT 1
+#define INQ_DROP 2
+#define INQ_CALL 3
+
+typedef struct _inqueueentry
+{
+    int q_type;
+    int q_fd;                       /* descriptor it came from ... */
+    int q_id;                       /* ... and its registration */
+    t_socketreceiver *q_receiver;   /* its receiver, or ... */
+    t_fdpollfn q_fn;                /* ... poll function to call */
+    void *q_ptr;
+    int q_newfd;                    /* connection accepted */
+    int q_newid;
+    t_binbuf *q_binbuf;             /* message or bytes read */
+} t_inqueueentry;
+
+typedef struct _inrequest
+{
+    int r_op;
+    int r_fd;
+    int r_id;
+    t_fdpollfn r_fn;
+    void *r_ptr;
+} t_inrequest;
+
+static t_inqueueentry *inq_vec;
+static volatile int inq_head, inq_tail;
+static t_inrequest *inr_vec;
+static volatile int inr_head, inr_tail;
+
+static int inqueue_nfree(void)
+{
+    return ((inq_tail - inq_head - 1) & (INQUEUESIZE-1));
+}
+
+    /* pass on the entry at inq_head, after the fields particular to its
+    type have been filled in */
+static void inqueue_push(int type, int fd, int id, t_socketreceiver *x)
+{
+    t_inqueueentry *e = &inq_vec[inq_head];
+    e->q_type = type;
+    e->q_fd = fd;
+    e->q_id = id;
+    e->q_receiver = x;
+    __sync_synchronize();
+    inq_head = (inq_head + 1) & (INQUEUESIZE-1);
+}
+
+    /* main thread: change the poll list as asked */
+static void inqueue_dorequest(int op, int fd, int id, t_fdpollfn fn,
+    void *ptr)
+{
+    t_fdpoll *fp;
+    if (op == INQ_ADD)
+        sys_doaddpollfn(fd, fn, ptr, id);
+    else if (op == INQ_REMOVE)
+        sys_dormpollfn(fd, id);
+    else if (op == INQ_CLOSE)
+        sys_doclosesocket(fd);
+    else if (op == INQ_RESUME)
+    {
+        if ((fp = sys_findfdpoll(fd)) && fp->fdp_id == id)
+            fp->fdp_pending = 0;
+    }
+    else if (op == INQ_FREE)
+        socketreceiver_dofree((t_socketreceiver *)ptr);
+}
+
+    /* main thread: take the requests made so far.  Only those: once a
+    descriptor is closed here its number may come back in a later one. */
+static void inqueue_takerequests(void)
+{
+    int head = inr_head;
+    while (inr_vec && inr_tail != head)
+    {
+        t_inrequest *r = &inr_vec[inr_tail];
+        __sync_synchronize();
+        inqueue_dorequest(r->r_op, r->r_fd, r->r_id, r->r_fn, r->r_ptr);
+        __sync_synchronize();
+        inr_tail = (inr_tail + 1) & (INREQUESTSIZE-1);
+    }
+}
+
+    /* lock holder: change the poll list, or have the main thread do it if
+    it's queueing input.  The ring only fills up if the main thread is held
+    up for a long time; then there's nothing for it but to wait. */
+static void inqueue_request(int op, int fd, int id, t_fdpollfn fn,
+    void *ptr)
+{
+    t_inrequest *r;
+    if (!sys_inqueue || pthread_equal(pthread_self(), sys_inqueuethread))
+    {
+        inqueue_takerequests();
+        inqueue_dorequest(op, fd, id, fn, ptr);
+        return;
+    }
+    while (!((inr_tail - inr_head - 1) & (INREQUESTSIZE-1)))
+#ifdef MSW
+        Sleep(1);
+#else
+        usleep(100);
+#endif
+    r = &inr_vec[inr_head];
+    r->r_op = op;
+    r->r_fd = fd;
+    r->r_id = id;
+    r->r_fn = fn;
+    r->r_ptr = ptr;
+    __sync_synchronize();
+    inr_head = (inr_head + 1) & (INREQUESTSIZE-1);
+}
+
+    /* the main thread's version of socketreceiver_read().  We read at most
+    as many bytes as there are free entries, so that every message that's
+    complete after the read fits in the queue.  Returns entries used.  An
+    accepted connection is polled from here on, so "fp" may be stale after
+    this returns. */
+static int socketreceiver_queue(t_socketreceiver *x, t_fdpoll *fp,
+    int nfree)
+{
+    int fd = fp->fdp_fd, id = fp->fdp_id, ret, n = 0;
+    t_inqueueentry *e = &inq_vec[inq_head];
+    if (x->sr_acceptfn)
+    {
+        t_socketreceiver *y = socketreceiver_accept(x, fd, &e->q_newfd);
+        if (!y)
+            return (0);
+        e->q_newid = __sync_add_and_fetch(&sys_pollid, 1);
+        sys_doaddpollfn(e->q_newfd, (t_fdpollfn)socketreceiver_read, y,
+            e->q_newid);
+        inqueue_push(INQ_ACCEPT, fd, id, x);
+        return (1);
+    }
+    else if (x->sr_binary)
+    {
+        if ((ret = socketreceiver_getbinary(x, fd, e->q_binbuf)) > 0)
+            inqueue_push(INQ_MESSAGE, fd, id, x);
+        else if (ret < 0 || !x->sr_udp)
+            goto drop;
+        else return (0);
+        return (1);
+    }
+    else if (x->sr_udp)
+    {
+        char buf[INBUFSIZE+1], *semi;
+        if ((ret = recv(fd, buf, INBUFSIZE, 0)) < 0)
+        {
+            sys_sockerror("recv");
+            goto drop;
+        }
+        if (ret == 0 || buf[ret-1] != '\n')
+            return (0);
+        buf[ret] = 0;
+        if ((semi = strchr(buf, ';')))
+            *semi = 0;
+        binbuf_text(e->q_binbuf, buf, strlen(buf));
+        inqueue_push(INQ_MESSAGE, fd, id, x);
+        return (1);
+    }
+    else
+    {
+        int readto =
+            (x->sr_inhead >= x->sr_intail ? INBUFSIZE : x->sr_intail-1);
+        if (readto == x->sr_inhead)
+        {
+            fprintf(stderr, "pd: dropped message from gui\n");
+            x->sr_inhead = x->sr_intail = 0;
+            return (0);
+        }
+        if (readto - x->sr_inhead > nfree)
+            readto = x->sr_inhead + nfree;
+        if ((ret = recv(fd, x->sr_inbuf + x->sr_inhead,
+            readto - x->sr_inhead, 0)) <= 0)
+        {
+            if (ret < 0)
+                sys_sockerror("recv");
+            goto drop;
+        }
+        x->sr_inhead += ret;
+        if (x->sr_inhead >= INBUFSIZE) x->sr_inhead = 0;
+        while (n < nfree &&
+            socketreceiver_doread(x, inq_vec[inq_head].q_binbuf))
+        {
+            inqueue_push(INQ_MESSAGE, fd, id, x);
+            n++;
+            if (x->sr_inhead == x->sr_intail)
+                break;
+        }
+        return (n);
+    }
+drop:
+    fp->fdp_pending = 1;
+    inqueue_push(INQ_DROP, fd, id, x);
+    return (1);
+}
+
+    /* start or stop handing input over to the lock holder.  Call this from
+    the main thread, with sys_lock() held. */
+void sys_setinqueue(int onoff)
+{
+    if (onoff && !inq_vec)
+    {
+        int i;
+        inq_vec = (t_inqueueentry *)getbytes(INQUEUESIZE * sizeof(*inq_vec));
+        for (i = 0; i < INQUEUESIZE; i++)
+            inq_vec[i].q_binbuf = binbuf_new();
+        inr_vec = (t_inrequest *)getbytes(INREQUESTSIZE * sizeof(*inr_vec));
+    }
+    if (!onoff)
+        inqueue_takerequests();
+    sys_inqueuethread = pthread_self();
+    sys_inqueue = (onoff != 0);
+}
+
+    /* main thread: wait up to "microsec" for input and queue what comes */
+void sys_pollinput(int microsec)
+{
+    struct timeval timout;
+    fd_set readset;
+    int i, n, nfree, maxfd = 0;
+    t_fdpoll *fp;
+    inqueue_takerequests();
+    nfree = inqueue_nfree();
+    FD_ZERO(&readset);
+    if (nfree)
+        for (fp = sys_fdpoll, i = sys_nfdpoll; i--; fp++)
+            if (!fp->fdp_pending)
+    {
+        FD_SET(fp->fdp_fd, &readset);
+        if (fp->fdp_fd >= maxfd)
+            maxfd = fp->fdp_fd + 1;
+    }
+    if (!maxfd)
+    {
+#ifdef MSW
+        Sleep(microsec/1000);
+#else
+        usleep(microsec);
+#endif
+        return;
+    }
+    timout.tv_sec = 0;
+    timout.tv_usec = microsec;
+    if (select(maxfd, &readset, 0, 0, &timout) <= 0)
+        return;
+        /* descriptors removed meanwhile go now.  They were still open, so
+        none of those left can be a new one with the same number.
+        Connections accepted below are added at the end, and not read
+        from until the next round. */
+    inqueue_takerequests();
+    for (i = 0, n = sys_nfdpoll; i < n && nfree; i++)
+        if (!sys_fdpoll[i].fdp_pending &&
+            FD_ISSET(sys_fdpoll[i].fdp_fd, &readset))
+    {
+        fp = &sys_fdpoll[i];
+        if (fp->fdp_fn == (t_fdpollfn)socketreceiver_read)
+            nfree -= socketreceiver_queue((t_socketreceiver *)fp->fdp_ptr,
+                fp, nfree);
+        else
+        {
+            inq_vec[inq_head].q_fn = fp->fdp_fn;
+            inq_vec[inq_head].q_ptr = fp->fdp_ptr;
+            fp->fdp_pending = 1;
+            inqueue_push(INQ_CALL, fp->fdp_fd, fp->fdp_id, 0);
+            nfree--;
+        }
+    }
+}
+
+    /* lock holder: deliver queued input until "budget" seconds have passed
+    (zero for no limit).  At least one entry is handled per call so the
+    queue always drains eventually.  Returns 1 if anything was done. */
+int sys_pollinqueue(double budget)
+{
+    double deadline = (budget > 0 ? sys_getrealtime() + budget : 0);
+    int didsomething = 0;
+    while (inq_vec && inq_tail != inq_head)
+    {
+        t_inqueueentry *e = &inq_vec[inq_tail];
+        t_socketreceiver *x = e->q_receiver;
+        __sync_synchronize();
+        if (!sys_fdislive(e->q_fd, e->q_id))
+        {
+                /* removed since; close a connection it accepted too */
+            if (e->q_type == INQ_ACCEPT)
+            {
+                sys_setfdid(e->q_newfd, e->q_newid);
+                sys_rmpollfn(e->q_newfd);
+                sys_closesocket(e->q_newfd);
+            }
+        }
+        else if (e->q_type == INQ_MESSAGE)
+        {
+            outlet_setstacklim();
+            if (x->sr_socketreceivefn)
+                (*x->sr_socketreceivefn)(x->sr_owner, e->q_binbuf);
+            else binbuf_eval(e->q_binbuf, 0, 0, 0);
+        }
+        else if (e->q_type == INQ_ACCEPT)
+        {
+            sys_setfdid(e->q_newfd, e->q_newid);
+            (*x->sr_acceptfn)(x->sr_owner, e->q_newfd);
+        }
+        else if (e->q_type == INQ_DROP)
+            socketreceiver_drop(x, e->q_fd);
+        else
+        {
+            (*e->q_fn)(e->q_ptr, e->q_fd);
+            if (sys_fdislive(e->q_fd, e->q_id))
+                inqueue_request(INQ_RESUME, e->q_fd, e->q_id, 0, 0);
+        }
+        __sync_synchronize();
+        inq_tail = (inq_tail + 1) & (INQUEUESIZE-1);
+        didsomething = 1;
+        if (deadline && sys_getrealtime() >= deadline)
+            break;
+    }
+    return (didsomething);
+}
+
 /* ---------------------- sending messages to the GUI ------------------ */
 #define GUI_ALLOCCHUNK 8192
 #define GUI_UPDATESLICE 512 /* how much we try to do in one idle period */
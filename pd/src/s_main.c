@@ -88,6 +88,9 @@ static int sys_listplease;
 int sys_externalschedlib;
 char sys_externalschedlibname[MAXPDSTRING];
 static int sys_batch;
+static char *sys_renderin, *sys_renderout;  /* files for -render */
+static double sys_renderduration = -1;
+static int sys_renderhasinput;
 int sys_extraflags;
 char sys_extraflagsstring[MAXPDSTRING];
 int sys_run_scheduler(const char *externalschedlibname,
@@ -426,6 +429,13 @@ int sys_main(int argc, char **argv)
     if (sys_externalschedlib)
         return (sys_run_scheduler(sys_externalschedlibname,
             sys_extraflagsstring));
+    else if (sys_batch && sys_renderout)
+    {
+        if (strcmp(sys_renderin, "-") && !sys_renderhasinput)
+            return (1);
+        return (m_batchrender(sys_renderout, sys_renderhasinput,
+            sys_renderduration));
+    }
     else if (sys_batch)
         return (m_batchmain());
     else
@@ -539,6 +549,10 @@ static char *(usagemessage[]) = {
 "-schedlib <file> -- plug in external scheduler\n",
 "-extraflags <s>  -- string argument to send schedlib\n",
 "-batch           -- run off-line as a batch process\n",
+"-render <in> <out> -- render off-line from soundfile <in> (or - for none)\n",
+"                    to soundfile <out>, faster than real time\n",
+"-duration <secs> -- length of the -render output (default: that of <in>)\n",
+"-rtcheck         -- report allocation, locking and I/O in the DSP chain\n",
 "-autopatch       -- enable auto-patching new from selected objects\n",
 "-k12             -- enable K-12 education mode (requires L2Ork K12 lib)\n",
 "-unique          -- enable multiple instances (disabled by default)\n",
@@ -1005,6 +1019,24 @@ int sys_argparse(int argc, char **argv)
             sys_printtostderr = sys_nogui = 1;
             argc--; argv++;
         }
+        else if (!strcmp(*argv, "-render") && argc > 2)
+        {
+            sys_renderin = argv[1];
+            sys_renderout = argv[2];
+            sys_batch = 1;
+            sys_printtostderr = sys_nogui = 1;
+            argc -= 3; argv += 3;
+        }
+        else if (!strcmp(*argv, "-duration") && argc > 1)
+        {
+            sys_renderduration = atof(argv[1]);
+            argc -= 2; argv += 2;
+        }
+        else if (!strcmp(*argv, "-rtcheck"))
+        {
+            sys_rtcheck = 1;
+            argc--; argv++;
+        }
         else if (!strcmp(*argv, "-noautopatch"))
         {
             sys_noautopatch = 1;
@@ -1189,6 +1221,43 @@ static void sys_afterargparse(void)
         callback = sys_main_callback;
     if (sys_main_blocksize)
         blocksize = sys_main_blocksize;
+    if (sys_renderout)
+    {
+            /* offline rendering: adc~ gets the input file's channels, at
+            its sample rate unless -r says otherwise; dac~ gets the
+            requested output channels or two by default.  No audio
+            device is opened; the "devices" below only carry channel
+            counts. */
+        int inchans, inrate;
+        long inframes;
+        sys_audioapi = API_NONE;
+        if (strcmp(sys_renderin, "-"))
+        {
+            if (soundfile_renderopenin(sys_renderin, &inchans, &inrate,
+                &inframes) < 0)
+                    error("%s: can't open input soundfile", sys_renderin);
+            else
+            {
+                sys_renderhasinput = 1;
+                naudioindev = nchindev = 1;
+                chindev[0] = inchans;
+                if (!sys_main_srate)
+                    rate = inrate;
+                else if (inrate != rate)
+                    post("warning: %s: sample rate %d, rendering at %d",
+                        sys_renderin, inrate, rate);
+                if (sys_renderduration < 0)
+                    sys_renderduration = (double)inframes / inrate;
+            }
+        }
+        if (sys_nchout < 0 || !nchoutdev)
+        {
+            naudiooutdev = nchoutdev = 1;
+            choutdev[0] = 2;
+        }
+        else if (!naudiooutdev)
+            naudiooutdev = 1;
+    }
     sys_set_audio_settings(naudioindev, audioindev, nchindev, chindev,
         naudiooutdev, audiooutdev, nchoutdev, choutdev, rate, advance, 
         callback, blocksize);
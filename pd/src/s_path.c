@@ -550,6 +550,7 @@ int sys_open(const char *path, int oflag, ...)
     int i, fd;
     char pathbuf[MAXPDSTRING];
     wchar_t ucs2path[MAXPDSTRING];
+    RTCHECK("sys_open()");
     sys_bashfilename(path, pathbuf);
     u8_utf8toucs2(ucs2path, MAXPDSTRING, pathbuf, MAXPDSTRING-1);
     /* For the create mode, Win32 does not have the same possibilities,
@@ -566,6 +567,7 @@ FILE *sys_fopen(const char *filename, const char *mode)
     char namebuf[MAXPDSTRING];
     wchar_t ucs2buf[MAXPDSTRING];
     wchar_t ucs2mode[MAXPDSTRING];
+    RTCHECK("sys_fopen()");
     sys_bashfilename(filename, namebuf);
     u8_utf8toucs2(ucs2buf, MAXPDSTRING, namebuf, MAXPDSTRING-1);
     /* mode only uses ASCII, so no need for a full conversion, just copy it */
@@ -578,6 +580,7 @@ int sys_open(const char *path, int oflag, ...)
 {
     int fd;
     char pathbuf[MAXPDSTRING];
+    RTCHECK("sys_open()");
     sys_bashfilename(path, pathbuf);
     if (oflag & O_CREAT)
     {
@@ -606,6 +609,7 @@ int sys_open(const char *path, int oflag, ...)
 FILE *sys_fopen(const char *filename, const char *mode)
 {
   char namebuf[MAXPDSTRING];
+  RTCHECK("sys_fopen()");
   sys_bashfilename(filename, namebuf);
   return fopen(namebuf, mode);
 }
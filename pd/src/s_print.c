@@ -3,6 +3,7 @@
 * WARRANTIES, see the file, "LICENSE.txt," in this distribution.  */
 
 #include "m_pd.h"
+#include "m_imp.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -50,6 +51,7 @@ static char* strnpointerid(char *dest, const void *pointer, size_t len)
 static void doerror(const void *object, const char *s)
 {
     char upbuf[MAXPDSTRING];
+    RTCHECK("error()");
     upbuf[MAXPDSTRING-1]=0;
 
     if (sys_printhook || sys_printhook_error)
@@ -82,6 +84,7 @@ static void dologpost(const void *object, const int level, const char *s)
        header doesn't end up overflowing the buffer. */
     char upbuf[MAXPDSTRING * 2];
 
+    RTCHECK("post()");
     // what about sys_printhook_verbose ?
     if (sys_printhook) 
     {
@@ -114,6 +117,7 @@ static void dologpost(const void *object, const int level, const char *s)
 
 static void dopost(const char *s)
 {
+    RTCHECK("post()");
     if (sys_printhook)
         (*sys_printhook)(s);
     else if (sys_printtostderr)
@@ -188,6 +188,16 @@ EXTERN void sys_log_error(int type);
 #define SCHED_AUDIO_POLL 1 
 #define SCHED_AUDIO_CALLBACK 2
 void sched_set_using_audio(int flag);
+int m_batchrender(const char *outname, int hasinput, double duration);
+
+/* d_soundfile.c: file access for m_batchrender() */
+int soundfile_renderopenin(const char *filename, int *p_nchannels,
+    int *p_samplerate, long *p_nframes);
+int soundfile_renderopenout(const char *filename, int nchannels,
+    t_float samplerate, long nframes);
+int soundfile_renderread(t_sample *vec, int nchannels, int n);
+int soundfile_renderwrite(t_sample *vec, int n, int nframes);
+void soundfile_renderclose(void);
 
 /* s_inter.c */
 
@@ -205,6 +215,8 @@ typedef void (*t_socketreceivefn)(void *x, t_binbuf *b);
 EXTERN t_socketreceiver *socketreceiver_new(void *owner,
     t_socketnotifier notifier, t_socketreceivefn socketreceivefn, int udp);
 EXTERN void socketreceiver_read(t_socketreceiver *x, int fd);
+EXTERN void socketreceiver_setbinary(t_socketreceiver *x, int onoff);
+EXTERN void socketreceiver_listen(t_socketreceiver *x, t_socketnotifier fn);
 EXTERN void sys_sockerror(char *s);
 EXTERN void sys_closesocket(int fd);
 
@@ -291,7 +303,8 @@ void alsa_getdevs(char *indevlist, int *nindevs,
     char *outdevlist, int *noutdevs, int *canmulti, 
         int maxndev, int devdescsize);
 
-int jack_open_audio(int wantinchans, int wantoutchans, int srate);
+int jack_open_audio(int wantinchans, int wantoutchans, int srate,
+    t_audiocallback callback);
 void jack_close_audio(void);
 int jack_send_dacs(void);
 void jack_reportidle(void);
@@ -362,6 +375,9 @@ EXTERN void sys_setmiditimediff(double inbuftime, double outbuftime);
 EXTERN void sched_tick(void );
 EXTERN void sys_pollmidiqueue(void );
 EXTERN int sys_pollgui(void );
+EXTERN void sys_setinqueue(int onoff);
+EXTERN void sys_pollinput(int microsec);
+EXTERN int sys_pollinqueue(double budget);
 EXTERN void sys_setchsr(int chin, int chout, int sr);
 
 EXTERN void inmidi_noteon(int portno, int channel, int pitch, int velo);
@@ -380,20 +396,19 @@ EXTERN void inmidi_polyaftertouch(int portno,
 extern t_widgetbehavior text_widgetbehavior;
 
 /* in x_list.c */
-    /* List element for storage.  Keep an atom and, in case it's a pointer,
-        an associated 'gpointer' to protect against stale pointers. */
-typedef struct _listelem
-{
-    t_atom l_a;
-    t_gpointer l_p;
-} t_listelem;
+    /* A list's items live in a t_alistbuf, which several lists may share
+        (and which is kept alive while being output); it's copied when one
+        of them changes it.  The items are kept as plain atoms so they can
+        be output as they are. */
+typedef struct _alistbuf t_alistbuf;
 
 struct _alist
 {
     t_pd l_pd;          /* object to point inlets to */
     int l_n;            /* number of items */
     int l_npointer;     /* number of pointers */
-    t_listelem *l_vec;  /* pointer to items */
+    t_atom *l_vec;      /* pointer to items (in l_buf) */
+    t_alistbuf *l_buf;  /* storage for items, or null if none */
 };
 
 #ifndef t_alist
@@ -70,120 +70,259 @@ void atoms_copy(int argc, t_atom *from, t_atom *to)
 
 t_class *alist_class;
 
-void alist_init(t_alist *x)
+struct _alistbuf
 {
-    x->l_pd = alist_class;
-    x->l_n = x->l_npointer = 0;
-    x->l_vec = 0;
+    int b_refcount;     /* number of lists (and outputs) using it */
+    int b_n;            /* number of items */
+    int b_size;         /* number of items there's room for */
+    int b_npointer;     /* number of pointers */
+    t_atom *b_vec;      /* the items */
+    t_gpointer *b_gp;   /* gpointers for pointer items, or null */
+};
+
+    /* storage being output by alist_output(), so that a list receiving
+    exactly what's being output can share it instead of copying it. */
+static t_alistbuf *alist_sending;
+
+static t_alistbuf *alistbuf_new(int size)
+{
+    t_alistbuf *b = (t_alistbuf *)getbytes(sizeof(*b));
+    if (!b || !(b->b_vec = (t_atom *)getbytes(size * sizeof(*b->b_vec))))
+    {
+        if (b)
+            freebytes(b, sizeof(*b));
+        error("list_alloc: out of memory");
+        return (0);
+    }
+    b->b_refcount = 1;
+    b->b_n = b->b_npointer = 0;
+    b->b_size = size;
+    b->b_gp = 0;
+    return (b);
 }
 
-void alist_clear(t_alist *x)
+static void alistbuf_release(t_alistbuf *b)
 {
     int i;
-    for (i = 0; i < x->l_n; i++)
+    if (!b || --b->b_refcount > 0)
+        return;
+    if (b->b_gp)
+    {
+        for (i = 0; i < b->b_n; i++)
+            if (b->b_vec[i].a_type == A_POINTER)
+                gpointer_unset(&b->b_gp[i]);
+        freebytes(b->b_gp, b->b_size * sizeof(*b->b_gp));
+    }
+    freebytes(b->b_vec, b->b_size * sizeof(*b->b_vec));
+    freebytes(b, sizeof(*b));
+}
+
+    /* point pointer items from "onset" on to their gpointers again after
+    the gpointers have moved */
+static void alistbuf_fixpointers(t_alistbuf *b, int onset)
+{
+    int i;
+    for (i = onset; i < b->b_n; i++)
+        if (b->b_vec[i].a_type == A_POINTER)
+            b->b_vec[i].a_w.w_gpointer = &b->b_gp[i];
+}
+
+static int alistbuf_resize(t_alistbuf *b, int size)
+{
+    t_atom *vec;
+    t_gpointer *gp;
+    if (!(vec = (t_atom *)resizebytes(b->b_vec,
+        b->b_size * sizeof(*b->b_vec), size * sizeof(*b->b_vec))))
+            return (0);
+    b->b_vec = vec;
+    if (b->b_gp)
     {
-        if (x->l_vec[i].l_a.a_type == A_POINTER)
-            gpointer_unset(x->l_vec[i].l_a.a_w.w_gpointer);
+        if (!(gp = (t_gpointer *)resizebytes(b->b_gp,
+            b->b_size * sizeof(*b->b_gp), size * sizeof(*b->b_gp))))
+                return (0);
+        b->b_gp = gp;
+        alistbuf_fixpointers(b, 0);
     }
-    if (x->l_vec)
-        freebytes(x->l_vec, x->l_n * sizeof(*x->l_vec));
+    b->b_size = size;
+    return (1);
 }
 
-static void alist_copyin(t_alist *x, t_symbol *s, int argc, t_atom *argv,
-    int where)
+    /* copy atoms into the storage at "where", taking a copy of any
+    pointers.  The caller sets b_n. */
+static void alistbuf_copyin(t_alistbuf *b, int argc, t_atom *argv, int where)
 {
     int i, j;
     for (i = 0, j = where; i < argc; i++, j++)
     {
-        x->l_vec[j].l_a = argv[i];
-        if (x->l_vec[j].l_a.a_type == A_POINTER)
+        b->b_vec[j] = argv[i];
+        if (argv[i].a_type == A_POINTER)
         {
-            x->l_npointer++;
-            gpointer_copy(x->l_vec[j].l_a.a_w.w_gpointer, &x->l_vec[j].l_p);
-            x->l_vec[j].l_a.a_w.w_gpointer = &x->l_vec[j].l_p;
+            if (!b->b_gp && !(b->b_gp = (t_gpointer *)getbytes(
+                b->b_size * sizeof(*b->b_gp))))
+            {
+                error("list_alloc: out of memory");
+                SETSYMBOL(&b->b_vec[j], gensym("(pointer)"));
+                continue;
+            }
+            b->b_npointer++;
+            gpointer_copy(argv[i].a_w.w_gpointer, &b->b_gp[j]);
+            b->b_vec[j].a_w.w_gpointer = &b->b_gp[j];
         }
     }
 }
 
-    /* set contents to a list */
-void alist_list(t_alist *x, t_symbol *s, int argc, t_atom *argv)
+static void alist_setbuf(t_alist *x, t_alistbuf *b)
 {
-    int i;
-    alist_clear(x);
-    if (!(x->l_vec = (t_listelem *)getbytes(argc * sizeof(*x->l_vec))))
+    x->l_buf = b;
+    x->l_vec = (b ? b->b_vec : 0);
+    x->l_n = (b ? b->b_n : 0);
+    x->l_npointer = (b ? b->b_npointer : 0);
+}
+
+    /* get storage for "n" items that's ours alone, keeping the items we
+    have.  If it's shared with another list or being output we copy it. */
+static int alist_reserve(t_alist *x, int n)
+{
+    t_alistbuf *b = x->l_buf, *b2;
+    if (b && b->b_refcount == 1)
     {
-        x->l_n = 0;
-        error("list_alloc: out of memory");
-        return;
+        if (n > b->b_size &&
+            !alistbuf_resize(b, (n > 2 * b->b_size ? n : 2 * b->b_size)))
+        {
+            error("list: out of memory");
+            return (0);
+        }
     }
-    x->l_n = argc;
-    x->l_npointer = 0;
-    for (i = 0; i < argc; i++)
+    else if (b || n)
     {
-        x->l_vec[i].l_a = argv[i];
-        if (x->l_vec[i].l_a.a_type == A_POINTER)
+        if (!(b2 = alistbuf_new(n)))
+            return (0);
+        if (b)
         {
-            x->l_npointer++;
-            gpointer_copy(x->l_vec[i].l_a.a_w.w_gpointer, &x->l_vec[i].l_p);
-            x->l_vec[i].l_a.a_w.w_gpointer = &x->l_vec[i].l_p;
+            alistbuf_copyin(b2, b->b_n, b->b_vec, 0);
+            b2->b_n = b->b_n;
+            alistbuf_release(b);
         }
+        b = b2;
+    }
+    alist_setbuf(x, b);
+    return (1);
+}
+
+void alist_init(t_alist *x)
+{
+    x->l_pd = alist_class;
+    x->l_n = x->l_npointer = 0;
+    x->l_vec = 0;
+    x->l_buf = 0;
+}
+
+void alist_clear(t_alist *x)
+{
+    alistbuf_release(x->l_buf);
+    alist_setbuf(x, 0);
+}
+
+    /* add items to the end */
+static void alist_append(t_alist *x, int argc, t_atom *argv)
+{
+    int n = x->l_n;
+    if (!argc || !alist_reserve(x, n + argc))
+        return;
+    alistbuf_copyin(x->l_buf, argc, argv, n);
+    x->l_buf->b_n = n + argc;
+    alist_setbuf(x, x->l_buf);
+}
+
+    /* add items to the beginning */
+static void alist_prepend(t_alist *x, int argc, t_atom *argv)
+{
+    int n = x->l_n;
+    t_alistbuf *b;
+    if (!argc || !alist_reserve(x, n + argc))
+        return;
+    b = x->l_buf;
+    memmove(b->b_vec + argc, b->b_vec, n * sizeof(*b->b_vec));
+    if (b->b_gp)
+        memmove(b->b_gp + argc, b->b_gp, n * sizeof(*b->b_gp));
+    b->b_n = n + argc;
+        /* we always have to fix gpointers because of memmove() */
+    if (b->b_npointer)
+        alistbuf_fixpointers(b, argc);
+    alistbuf_copyin(b, argc, argv, 0);
+    alist_setbuf(x, b);
+}
+
+    /* set contents to a list */
+void alist_list(t_alist *x, t_symbol *s, int argc, t_atom *argv)
+{
+    t_alistbuf *b = alist_sending;
+        /* if it's another list being output, share its storage */
+    if (b && argc && argc == b->b_n && argv == b->b_vec)
+    {
+        b->b_refcount++;
+        alist_clear(x);
+        alist_setbuf(x, b);
+        return;
     }
+    alist_clear(x);
+    alist_append(x, argc, argv);
 }
 
     /* set contents to an arbitrary non-list message */
 void alist_anything(t_alist *x, t_symbol *s, int argc, t_atom *argv)
 {
-    int i;
+    t_atom a;
     alist_clear(x);
-    if (!(x->l_vec = (t_listelem *)getbytes((argc+1) * sizeof(*x->l_vec))))
-    {
-        x->l_n = 0;
-        error("list_alloc: out of memory");
+    SETSYMBOL(&a, s);
+    if (!alist_reserve(x, argc + 1))
         return;
-    }
-    x->l_n = argc+1;
-    x->l_npointer = 0;
-    SETSYMBOL(&x->l_vec[0].l_a, s);
-    for (i = 0; i < argc; i++)
-    {
-        x->l_vec[i+1].l_a = argv[i];
-        if (x->l_vec[i+1].l_a.a_type == A_POINTER)
-        {
-            x->l_npointer++;            
-            gpointer_copy(x->l_vec[i+1].l_a.a_w.w_gpointer, &x->l_vec[i+1].l_p);
-            x->l_vec[i+1].l_a.a_w.w_gpointer = &x->l_vec[i+1].l_p;
-        }
-    }
+    alist_append(x, 1, &a);
+    alist_append(x, argc, argv);
 }
 
 void alist_toatoms(t_alist *x, t_atom *to, int onset, int count)
 {
     int i;
     for (i = 0; i < count; i++)
-        to[i] = x->l_vec[onset + i].l_a;
+        to[i] = x->l_vec[onset + i];
 }
 
 void alist_clone(t_alist *x, t_alist *y, int onset, int count)
 {
-    int i;
-    y->l_pd = alist_class;
-    y->l_n = count;
-    y->l_npointer = 0;
-    if (!(y->l_vec = (t_listelem *)getbytes(y->l_n * sizeof(*y->l_vec))))
+    alist_init(y);
+    if (!onset && count == x->l_n && x->l_buf)
     {
-        y->l_n = 0;
-        error("list_alloc: out of memory");
+        x->l_buf->b_refcount++;
+        alist_setbuf(y, x->l_buf);
     }
-    else for (i = 0; i < count; i++)
+    else if (alist_reserve(y, count))
+        alist_append(y, count, x->l_vec + onset);
+}
+
+    /* keep our storage, if any, from going away while the caller outputs
+    atoms copied from it */
+static t_alistbuf *alist_hold(t_alist *x)
+{
+    if (x->l_buf)
+        x->l_buf->b_refcount++;
+    return (x->l_buf);
+}
+
+    /* output items directly from our storage */
+static void alist_output(t_alist *x, t_outlet *out, int onset, int count)
+{
+    t_alistbuf *b = alist_hold(x), *was = alist_sending;
+    t_atom dummy;
+    if (!b)
     {
-        y->l_vec[i].l_a = x->l_vec[onset + i].l_a;
-        if (y->l_vec[i].l_a.a_type == A_POINTER)
-        {
-            gpointer_copy(y->l_vec[i].l_a.a_w.w_gpointer, &y->l_vec[i].l_p);
-            y->l_vec[i].l_a.a_w.w_gpointer = &y->l_vec[i].l_p;
-            y->l_npointer++;
-        }
+        outlet_list(out, &s_list, 0, &dummy);
+        return;
     }
+    alist_sending = b;
+    outlet_list(out, &s_list, count, b->b_vec + onset);
+    alist_sending = was;
+    alistbuf_release(b);
 }
 
 void alist_setup(void)
@@ -218,24 +357,21 @@ static void list_append_list(t_list_append *x, t_symbol *s,
     int argc, t_atom *argv)
 {
     t_atom *outv;
+    t_alistbuf *b;
     int n, outc;
+    if (!argc)
+    {
+        alist_output(&x->x_alist, x->x_obj.ob_outlet, 0, x->x_alist.l_n);
+        return;
+    }
     n = x->x_alist.l_n;
     outc = n + argc;
     XL_ATOMS_ALLOCA(outv, outc);
     atoms_copy(argc, argv, outv);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv+argc, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv+argc, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-    }
+    b = alist_hold(&x->x_alist);
+    alist_toatoms(&x->x_alist, outv+argc, 0, n);
+    outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
+    alistbuf_release(b);
     XL_ATOMS_FREEA(outv, outc);
 }
 
@@ -243,25 +379,17 @@ static void list_append_anything(t_list_append *x, t_symbol *s,
     int argc, t_atom *argv)
 {
     t_atom *outv;
+    t_alistbuf *b;
     int n, outc;
     n = x->x_alist.l_n;
     outc = n + argc + 1;
     XL_ATOMS_ALLOCA(outv, outc);
     SETSYMBOL(outv, s);
     atoms_copy(argc, argv, outv + 1);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv + 1 + argc, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv + 1 + argc, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-    }
+    b = alist_hold(&x->x_alist);
+    alist_toatoms(&x->x_alist, outv + 1 + argc, 0, n);
+    outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
+    alistbuf_release(b);
     XL_ATOMS_FREEA(outv, outc);
 }
 
@@ -325,56 +453,18 @@ static void *list_cat_new( void)
 static void list_cat_list(t_list_cat *x, t_symbol *s,
     int argc, t_atom *argv)
 {
-    t_atom *outv;
-    int n, outc;
-    n = x->x_alist.l_n;
-    outc = n + argc;
-    XL_ATOMS_ALLOCA(outv, outc);
-    atoms_copy(argc, argv, outv + x->x_alist.l_n);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv, 0, n);
-        alist_list(&x->x_alist, s, outc, outv);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv, 0, n);
-        alist_list(&x->x_alist, s, outc, outv);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-    }
-    XL_ATOMS_FREEA(outv, outc);
+    alist_append(&x->x_alist, argc, argv);
+    alist_output(&x->x_alist, x->x_obj.ob_outlet, 0, x->x_alist.l_n);
 }
 
 static void list_cat_anything(t_list_cat *x, t_symbol *s,
     int argc, t_atom *argv)
 {
-    t_atom *outv;
-    int n, outc;
-    n = x->x_alist.l_n;
-    outc = n + argc + 1;
-    XL_ATOMS_ALLOCA(outv, outc);
-    SETSYMBOL(outv + x->x_alist.l_n, s);
-    atoms_copy(argc, argv, outv + x->x_alist.l_n + 1);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv, 0, n);
-        alist_list(&x->x_alist, s, outc, outv);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv, 0, n);
-        alist_list(&x->x_alist, s, outc, outv);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-    }
-    XL_ATOMS_FREEA(outv, outc);
+    t_atom a;
+    SETSYMBOL(&a, s);
+    alist_append(&x->x_alist, 1, &a);
+    alist_append(&x->x_alist, argc, argv);
+    alist_output(&x->x_alist, x->x_obj.ob_outlet, 0, x->x_alist.l_n);
 }
 
 static void list_cat_clear(t_list_cat *x)
@@ -427,24 +517,21 @@ static void list_prepend_list(t_list_prepend *x, t_symbol *s,
     int argc, t_atom *argv)
 {
     t_atom *outv;
+    t_alistbuf *b;
     int n, outc;
+    if (!argc)
+    {
+        alist_output(&x->x_alist, x->x_obj.ob_outlet, 0, x->x_alist.l_n);
+        return;
+    }
     n = x->x_alist.l_n;
     outc = n + argc;
     XL_ATOMS_ALLOCA(outv, outc);
     atoms_copy(argc, argv, outv + n);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-    }
+    b = alist_hold(&x->x_alist);
+    alist_toatoms(&x->x_alist, outv, 0, n);
+    outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
+    alistbuf_release(b);
     XL_ATOMS_FREEA(outv, outc);
 }
 
@@ -454,25 +541,17 @@ static void list_prepend_anything(t_list_prepend *x, t_symbol *s,
     int argc, t_atom *argv)
 {
     t_atom *outv;
+    t_alistbuf *b;
     int n, outc;
     n = x->x_alist.l_n;
     outc = n + argc + 1;
     XL_ATOMS_ALLOCA(outv, outc);
     SETSYMBOL(outv + n, s);
     atoms_copy(argc, argv, outv + n + 1);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv, 0, n);
-        outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
-    }
+    b = alist_hold(&x->x_alist);
+    alist_toatoms(&x->x_alist, outv, 0, n);
+    outlet_list(x->x_obj.ob_outlet, &s_list, outc, outv);
+    alistbuf_release(b);
     XL_ATOMS_FREEA(outv, outc);
 }
 
@@ -520,87 +599,38 @@ static void list_store_list(t_list_store *x, t_symbol *s,
     int argc, t_atom *argv)
 {
     t_atom *outv;
+    t_alistbuf *b;
     int n, outc;
+    if (!argc)
+    {
+        alist_output(&x->x_alist, x->x_out1, 0, x->x_alist.l_n);
+        return;
+    }
     n = x->x_alist.l_n;
     outc = n + argc;
     ATOMS_ALLOCA(outv, outc);
     atoms_copy(argc, argv, outv);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, 0, n);
-        alist_toatoms(&y, outv+argc, 0, n);
-        outlet_list(x->x_out1, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv+argc, 0, n);
-        outlet_list(x->x_out1, &s_list, outc, outv);
-    }
+    b = alist_hold(&x->x_alist);
+    alist_toatoms(&x->x_alist, outv+argc, 0, n);
+    outlet_list(x->x_out1, &s_list, outc, outv);
+    alistbuf_release(b);
     ATOMS_FREEA(outv, outc);
 }
 
-/* function to restore gpointers after the list has moved in memory */
-static void list_store_restore_gpointers(t_list_store *x, int offset, int count)
-{
-    t_listelem *vec = x->x_alist.l_vec + offset;
-    while (count--)
-    {
-        if (vec->l_a.a_type == A_POINTER)
-            vec->l_a.a_w.w_gpointer = &vec->l_p;
-        vec++;
-    }
-}
-
 static void list_store_append(t_list_store *x, t_symbol *s,
     int argc, t_atom *argv)
 {
-    t_listelem *oldptr = x->x_alist.l_vec;
-
-    if (!(x->x_alist.l_vec = (t_listelem *)resizebytes(x->x_alist.l_vec,
-        (x->x_alist.l_n) * sizeof(*x->x_alist.l_vec),
-        (x->x_alist.l_n + argc) * sizeof(*x->x_alist.l_vec))))
-    {
-        x->x_alist.l_n = 0;
-        error("list: out of memory");
-        return;
-    }
-
-        /* fix gpointers if resizebytes() has moved the alist in memory */
-    if (x->x_alist.l_vec != oldptr && x->x_alist.l_npointer)
-        list_store_restore_gpointers(x, 0, x->x_alist.l_n);
-
-    alist_copyin(&x->x_alist, s, argc, argv, x->x_alist.l_n);
-    x->x_alist.l_n += argc;
+    alist_append(&x->x_alist, argc, argv);
 }
 
 static void list_store_prepend(t_list_store *x, t_symbol *s,
     int argc, t_atom *argv)
 {
-    if (!(x->x_alist.l_vec = (t_listelem *)resizebytes(x->x_alist.l_vec,
-    (x->x_alist.l_n) * sizeof(*x->x_alist.l_vec),
-    (x->x_alist.l_n + argc) * sizeof(*x->x_alist.l_vec))))
-    {
-        x->x_alist.l_n = 0;
-        error("list: out of memory");
-        return;
-    }
-
-    memmove(x->x_alist.l_vec + argc, x->x_alist.l_vec,
-        x->x_alist.l_n * sizeof(*x->x_alist.l_vec));
-
-        /* we always have to fix gpointers because of memmove() */
-    if (x->x_alist.l_npointer)
-        list_store_restore_gpointers(x, argc, x->x_alist.l_n);
-
-    alist_copyin(&x->x_alist, s, argc, argv, 0);
-    x->x_alist.l_n += argc;
+    alist_prepend(&x->x_alist, argc, argv);
 }
 
 static void list_store_get(t_list_store *x, float f1, float f2)
 {
-    t_atom *outv;
     int onset = f1, outc = f2;
     if (onset < 0 || outc < 0)
     {
@@ -612,21 +642,7 @@ static void list_store_get(t_list_store *x, float f1, float f2)
         outlet_bang(x->x_out2);
         return;
     }
-    ATOMS_ALLOCA(outv, outc);
-    if (x->x_alist.l_npointer)
-    {
-        t_alist y;
-        alist_clone(&x->x_alist, &y, onset, outc);
-        alist_toatoms(&y, outv, 0, outc);
-        outlet_list(x->x_out1, &s_list, outc, outv);
-        alist_clear(&y);
-    }
-    else
-    {
-        alist_toatoms(&x->x_alist, outv, onset, outc);
-        outlet_list(x->x_out1, &s_list, outc, outv);
-    }
-    ATOMS_FREEA(outv, outc);
+    alist_output(&x->x_alist, x->x_out1, onset, outc);
 }
 
 static void list_store_free(t_list_store *x)
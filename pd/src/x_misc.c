@@ -25,6 +25,7 @@
 #include <sys/param.h>
 #endif
 #ifdef MSW
+#include <windows.h>
 #include <wtypes.h>
 #include <time.h>
 #endif
@@ -403,197 +404,599 @@ static void realtime_setup(void)
 
 /* ---------- oscparse - parse simple OSC messages ----------------- */
 
+/* The incoming list is first copied into bytes, and the message is decoded
+from those.  Addresses given as creation arguments, or bound to receive names
+with "bind", are kept in a tree with one node per address component; a
+message whose address (which may be an OSC pattern) reaches any of them goes
+to each as a list of its arguments only.  Anything else comes out of the
+rightmost outlet as before, with the address split into symbols; the last
+few addresses seen are cached so that these aren't looked up every time.
+With "-t", bundles timetagged in the future are held back with a clock until
+their time comes.  */
+
 static t_class *oscparse_class;
 
+typedef struct _oschandler
+{
+    t_outlet *h_outlet;         /* an outlet for a creation argument... */
+    t_symbol *h_send;           /* ...or a receive name from "bind" */
+    struct _oschandler *h_next;
+} t_oschandler;
+
+typedef struct _oscnode
+{
+    t_symbol *n_name;           /* one component of the address */
+    int n_len;
+    struct _oscnode *n_child;
+    struct _oscnode *n_next;
+    t_oschandler *n_handlers;
+} t_oscnode;
+
+#define OSCPARSE_NCACHE 64      /* addresses to remember, a power of two */
+
+typedef struct _oscaddr
+{
+    char *a_name;
+    int a_len;
+    t_symbol **a_vec;
+    int a_n;
+} t_oscaddr;
+
+typedef struct _oscdelay
+{
+    struct _oscparse *d_owner;
+    t_clock *d_clock;
+    double d_time;              /* the timetag, in seconds since 1900 */
+    unsigned char *d_buf;       /* the bundle's elements */
+    int d_size;
+    struct _oscdelay *d_next;
+} t_oscdelay;
+
 typedef struct _oscparse
 {
     t_object x_obj;
+    t_outlet *x_out;            /* messages nobody asked for */
+    t_oscnode x_root;
+    int x_timetags;             /* "-t" flag: honor bundle timetags */
+    t_oscdelay *x_delayed;
+    t_oscaddr x_cache[OSCPARSE_NCACHE];
 } t_oscparse;
 
 #define ROUNDUPTO4(x) (((x) + 3) & (~3))
 
-#define READINT(x)  ((((int)(((x)  )->a_w.w_float)) & 0xff) << 24) | \
-                    ((((int)(((x)+1)->a_w.w_float)) & 0xff) << 16) | \
-                    ((((int)(((x)+2)->a_w.w_float)) & 0xff) << 8) | \
-                    ((((int)(((x)+3)->a_w.w_float)) & 0xff) << 0)
+#define READINT(p)  ((((uint32_t)(p)[0]) << 24) | \
+                    (((uint32_t)(p)[1]) << 16) | \
+                    (((uint32_t)(p)[2]) << 8) | ((uint32_t)(p)[3]))
 
-static t_symbol *grabstring(int argc, t_atom *argv, int *ip, int slash)
+#define NTP_UNIXOFFSET 2208988800.  /* seconds from 1900 to 1970 */
+
+    /* the wall clock in seconds since 1900, as in OSC timetags */
+static double oscparse_now(void)
 {
-    char buf[MAXPDSTRING];
-    int nchar;
-    if (slash)
-        while (*ip < argc && argv[*ip].a_w.w_float == '/')
-            (*ip)++;
-    for (nchar = 0; nchar < MAXPDSTRING-1 && *ip < argc; nchar++, (*ip)++)
+#ifdef MSW
+    FILETIME ft;
+    ULARGE_INTEGER t;
+    GetSystemTimeAsFileTime(&ft);
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+        /* 100-nanosecond units since 1601 */
+    return (t.QuadPart * 1e-7 - 11644473600. + NTP_UNIXOFFSET);
+#else
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec + NTP_UNIXOFFSET + 1e-6 * now.tv_usec);
+#endif
+}
+
+    /* match an OSC address pattern against one address component */
+static int oscparse_match(const char *p, const char *pe,
+    const char *s, const char *se)
+{
+    while (p < pe)
     {
-        char c = argv[*ip].a_w.w_float;
-        if (c == 0 || (slash && c == '/'))
-            break;
-        buf[nchar] = c;
+        if (*p == '*')
+        {
+            while (p < pe && *p == '*')
+                p++;
+            if (p == pe)
+                return (1);
+            for (; s < se; s++)
+                if (oscparse_match(p, pe, s, se))
+                    return (1);
+            return (0);
+        }
+        else if (*p == '?')
+        {
+            if (s == se)
+                return (0);
+            p++, s++;
+        }
+        else if (*p == '[')
+        {
+            int negate = 0, hit = 0;
+            if (s == se)
+                return (0);
+            if (++p < pe && *p == '!')
+                negate = 1, p++;
+            while (p < pe && *p != ']')
+            {
+                if (p + 2 < pe && p[1] == '-' && p[2] != ']')
+                {
+                    if (*s >= p[0] && *s <= p[2])
+                        hit = 1;
+                    p += 3;
+                }
+                else if (*p++ == *s)
+                    hit = 1;
+            }
+            if (p == pe || hit == negate)
+                return (0);
+            p++, s++;
+        }
+        else if (*p == '{')
+        {
+            const char *alt = p + 1, *close, *end;
+            for (close = alt; close < pe && *close != '}'; close++)
+                ;
+            if (close == pe)
+                return (0);
+            for (; alt <= close; alt = end + 1)
+            {
+                for (end = alt; end < close && *end != ','; end++)
+                    ;
+                if (end - alt <= se - s && !strncmp(alt, s, end - alt) &&
+                    oscparse_match(close + 1, pe, s + (end - alt), se))
+                        return (1);
+            }
+            return (0);
+        }
+        else if (s == se || *p++ != *s++)
+            return (0);
     }
-    buf[nchar] = 0;
-    if (!slash)
-        *ip = ROUNDUPTO4(*ip+1);
-    if (*ip > argc)
-        *ip = argc;
-    return (gensym(buf));
+    return (s == se);
 }
 
-static void oscparse_list(t_oscparse *x, t_symbol *s, int argc, t_atom *argv)
+    /* send the arguments to everyone registered for the address in
+    [p, end); returns the number of handlers reached */
+static int oscparse_dispatch(t_oscnode *n, const char *p, const char *end,
+    int argc, t_atom *argv)
 {
-    int i, j, j2, k, outc = 1, blob = 0, typeonset, dataonset, nfield;
-    t_atom *outv;
-    if (!argc)
-        return;
-    for (i = 0; i < argc; i++)
-        if (argv[i].a_type != A_FLOAT)
+    const char *seg;
+    int nmatch = 0, wild = 0;
+    while (p < end && *p == '/')
+        p++;
+    if (p == end)
     {
-        pd_error(x, "oscparse: takes numbers only");
-        return;
+        t_oschandler *h;
+        for (h = n->n_handlers; h; h = h->h_next)
+        {
+            if (h->h_outlet)
+                outlet_list(h->h_outlet, 0, argc, argv);
+            else if (!h->h_send)
+                continue;
+            else if (h->h_send->s_thing)
+                pd_list(h->h_send->s_thing, 0, argc, argv);
+            nmatch++;
+        }
+        return (nmatch);
     }
-    if (argv[0].a_w.w_float == '#') /* it's a bundle */
+    for (seg = p; p < end && *p != '/'; p++)
+        if (*p == '*' || *p == '?' || *p == '[' || *p == '{')
+            wild = 1;
+    for (n = n->n_child; n; n = n->n_next)
     {
-        if (argv[1].a_w.w_float != 'b' || argc < 16)
+        if (wild)
         {
-            pd_error(x, "oscparse: malformed bundle");
-            return;
+            if (oscparse_match(seg, p, n->n_name->s_name,
+                n->n_name->s_name + n->n_len))
+                    nmatch += oscparse_dispatch(n, p, end, argc, argv);
         }
-            /* we ignore the timetag since there's no correct way to
-            convert it to Pd logical time that I can think of.  LATER
-            consider at least outputting timetag differentially converted
-            into Pd time units. */
-        for (i = 16; i < argc-4; )
+        else if (n->n_len == p - seg &&
+            !memcmp(seg, n->n_name->s_name, n->n_len))
+            return (oscparse_dispatch(n, p, end, argc, argv));
+    }
+    return (nmatch);
+}
+
+    /* find the node for an address, making it if "create" is set */
+static t_oscnode *oscparse_node(t_oscparse *x, t_symbol *s, int create)
+{
+    t_oscnode *n = &x->x_root, *c;
+    const char *p = s->s_name, *seg;
+    char buf[MAXPDSTRING];
+    while (1)
+    {
+        while (*p == '/')
+            p++;
+        if (!*p)
+            return (n);
+        for (seg = p; *p && *p != '/'; p++)
+            ;
+        for (c = n->n_child; c; c = c->n_next)
+            if (c->n_len == p - seg &&
+                !strncmp(seg, c->n_name->s_name, c->n_len))
+                break;
+        if (!c)
         {
-            int msize = READINT(argv+i);
-            if (msize <= 0 || msize & 3)
-            {
-                pd_error(x, "oscparse: bad bundle element size");
-                return;
-            }
-            oscparse_list(x, 0, msize, argv+i+4);
-            i += msize+4;
+            int len = (p - seg < MAXPDSTRING ? p - seg : MAXPDSTRING-1);
+            if (!create)
+                return (0);
+            strncpy(buf, seg, len);
+            buf[len] = 0;
+            c = (t_oscnode *)getbytes(sizeof(*c));
+            c->n_name = gensym(buf);
+            c->n_len = len;
+            c->n_handlers = 0;
+            c->n_child = 0;
+            c->n_next = n->n_child;
+            n->n_child = c;
         }
+        n = c;
+    }
+}
+
+static void oscparse_freenode(t_oscnode *n)
+{
+    t_oscnode *c;
+    t_oschandler *h;
+    while ((c = n->n_child))
+    {
+        n->n_child = c->n_next;
+        oscparse_freenode(c);
+        freebytes(c, sizeof(*c));
+    }
+    while ((h = n->n_handlers))
+    {
+        n->n_handlers = h->h_next;
+        freebytes(h, sizeof(*h));
+    }
+}
+
+static void oscparse_addhandler(t_oscnode *n, t_outlet *o, t_symbol *s)
+{
+    t_oschandler *h, **hp;
+    for (hp = &n->n_handlers; *hp; hp = &(*hp)->h_next)
+        ;
+    h = (t_oschandler *)getbytes(sizeof(*h));
+    h->h_outlet = o;
+    h->h_send = s;
+    h->h_next = 0;
+    *hp = h;
+}
+
+    /* handlers are only marked unused here, never freed, in case we're
+    called from one of them while they're being gone through */
+static void oscparse_bind(t_oscparse *x, t_symbol *addr, t_symbol *s)
+{
+    t_oscnode *n = oscparse_node(x, addr, 1);
+    t_oschandler *h;
+    for (h = n->n_handlers; h; h = h->h_next)
+        if (h->h_send == s)
+            return;
+    for (h = n->n_handlers; h; h = h->h_next)
+        if (!h->h_outlet && !h->h_send)
+    {
+        h->h_send = s;
         return;
     }
-    else if (argv[0].a_w.w_float != '/')
+    oscparse_addhandler(n, 0, s);
+}
+
+static void oscparse_unbind(t_oscparse *x, t_symbol *addr, t_symbol *s)
+{
+    t_oscnode *n = oscparse_node(x, addr, 0);
+    t_oschandler *h;
+    if (n)
+        for (h = n->n_handlers; h; h = h->h_next)
+            if (h->h_send == s)
+                h->h_send = 0;
+}
+
+    /* the address split into symbols, from the cache if possible */
+static t_oscaddr *oscparse_address(t_oscparse *x, const char *name, int len)
+{
+    unsigned int hash = 2166136261u;
+    int i, n;
+    const char *p, *seg;
+    char buf[MAXPDSTRING];
+    t_oscaddr *a;
+    for (i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    a = &x->x_cache[hash & (OSCPARSE_NCACHE-1)];
+    if (a->a_name && a->a_len == len && !memcmp(a->a_name, name, len))
+        return (a);
+    if (a->a_name)
+    {
+        freebytes(a->a_name, a->a_len);
+        freebytes(a->a_vec, a->a_n * sizeof(t_symbol *));
+    }
+    for (i = n = 0; i < len; i++)
+        if (name[i] == '/' && i + 1 < len && name[i+1] != '/')
+            n++;
+    a->a_name = (char *)getbytes(len);
+    memcpy(a->a_name, name, len);
+    a->a_len = len;
+    a->a_vec = (t_symbol **)getbytes(n * sizeof(t_symbol *));
+    a->a_n = 0;
+    for (p = name; p < name + len && a->a_n < n; )
+    {
+        while (p < name + len && *p == '/')
+            p++;
+        for (seg = p; p < name + len && *p != '/'; p++)
+            ;
+        i = (p - seg < MAXPDSTRING ? p - seg : MAXPDSTRING-1);
+        memcpy(buf, seg, i);
+        buf[i] = 0;
+        a->a_vec[a->a_n++] = gensym(buf);
+    }
+    return (a);
+}
+
+    /* a string argument, advancing *ip past it and its padding */
+static t_symbol *oscparse_string(const unsigned char *buf, int n, int *ip)
+{
+    char sbuf[MAXPDSTRING];
+    int nchar;
+    for (nchar = 0; nchar < MAXPDSTRING-1 && *ip < n && buf[*ip];
+        nchar++, (*ip)++)
+            sbuf[nchar] = buf[*ip];
+    sbuf[nchar] = 0;
+    *ip = ROUNDUPTO4(*ip+1);
+    if (*ip > n)
+        *ip = n;
+    return (gensym(sbuf));
+}
+
+static void oscparse_message(t_oscparse *x, const unsigned char *buf, int n)
+{
+    int i, j, j2, k, maxout, nslash = 0, blob = 0, typeonset, dataonset,
+        nfield;
+    t_atom *outv, *argv;
+    t_oscaddr *a;
+    if (buf[0] != '/')
     {
         pd_error(x, "oscparse: not an OSC message (no leading slash)");
         return;
     }
-    for (i = 1; i < argc && argv[i].a_w.w_float != 0; i++)
-        if (argv[i].a_w.w_float == '/')
-            outc++;
+    for (i = 1; i < n && buf[i] != 0; i++)
+        if (buf[i] == '/')
+            nslash++;
+    j = i;      /* length of the address */
     i = ROUNDUPTO4(i+1);
-    if (argv[i].a_w.w_float != ',' || (i+1) >= argc)
+    if (i + 1 >= n || buf[i] != ',')
     {
         pd_error(x, "oscparse: malformed type string (char %d, index %d)",
-            (int)(argv[i].a_w.w_float), i);
+            (i < n ? buf[i] : 0), i);
         return;
     }
     typeonset = ++i;
-    for (; i < argc && argv[i].a_w.w_float != 0; i++)
-        if (argv[i].a_w.w_float == 'b')
+    for (; i < n && buf[i] != 0; i++)
+        if (buf[i] == 'b')
             blob = 1;
     nfield = i - typeonset;
-    if (blob)
-        outc += argc - typeonset;
-    else outc += nfield;
-    outv = (t_atom *)alloca(outc * sizeof(t_atom));
     dataonset = ROUNDUPTO4(i + 1);
-    /* post("outc %d, typeonset %d, dataonset %d, nfield %d", outc, typeonset,
-        dataonset, nfield); */
-    for (i = j = 0; i < typeonset-1 && argv[i].a_w.w_float != 0 &&
-        j < outc; j++)
-            SETSYMBOL(outv+j, grabstring(argc, argv, &i, 1));
-    for (i = typeonset, k = dataonset; i < typeonset + nfield; i++)
+    maxout = nslash + 1 + (blob ? n - typeonset : nfield);
+    outv = (t_atom *)alloca(maxout * sizeof(t_atom));
+        /* arguments go after room for the address, which is filled in
+        only if no handler takes the message */
+    argv = outv + nslash + 1;
+    for (i = typeonset, k = dataonset, j2 = 0; i < typeonset + nfield; i++)
     {
         union
         {
             float z_f;
             uint32_t z_i;
         } z;
-        float f;
         int blobsize;
-        switch ((int)(argv[i].a_w.w_float))
+        switch (buf[i])
         {
         case 'f':
-            if (k > argc - 4)
+            if (k > n - 4)
                 goto tooshort;
-            z.z_i = READINT(argv+k);
-            f = z.z_f;
-            if (PD_BADFLOAT(f))
-                f = 0;
-            if (j >= outc)
-            {
-                bug("oscparse 1: %d >=%d", j, outc);
-                return;
-            }
-            SETFLOAT(outv+j, f);
-            j++; k += 4;
+            z.z_i = READINT(buf+k);
+            if (PD_BADFLOAT(z.z_f))
+                z.z_f = 0;
+            SETFLOAT(argv+j2, z.z_f);
+            j2++; k += 4;
             break;
         case 'i':
-            if (k > argc - 4)
+            if (k > n - 4)
                 goto tooshort;
-            if (j >= outc)
-            {
-                bug("oscparse 2");
-                return;
-            }
-            SETFLOAT(outv+j, READINT(argv+k));
-            j++; k += 4;
+            SETFLOAT(argv+j2, (int32_t)READINT(buf+k));
+            j2++; k += 4;
             break;
         case 's':
-            if (j >= outc)
-            {
-                bug("oscparse 3");
-                return;
-            }
-            SETSYMBOL(outv+j, grabstring(argc, argv, &k, 0));
-            j++;
+            SETSYMBOL(argv+j2, oscparse_string(buf, n, &k));
+            j2++;
             break;
         case 'b':
-            if (k > argc - 4)
+            if (k > n - 4)
                 goto tooshort;
-            blobsize = READINT(argv+k);
+            blobsize = (int32_t)READINT(buf+k);
             k += 4;
-            if (blobsize < 0 || blobsize > argc - k)
+            if (blobsize < 0 || blobsize > n - k)
                 goto tooshort;
-            if (j + blobsize + 1 > outc)
-            {
-                bug("oscparse 4");
-                return;
-            }
-            if (k + blobsize > argc)
-                goto tooshort;
-            SETFLOAT(outv+j, blobsize);
-            j++;
-            for (j2 = 0; j2 < blobsize; j++, j2++, k++)
-                SETFLOAT(outv+j, argv[k].a_w.w_float);
+            SETFLOAT(argv+j2, blobsize);
+            j2++;
+            for (; blobsize--; j2++, k++)
+                SETFLOAT(argv+j2, buf[k]);
             k = ROUNDUPTO4(k);
             break;
         default:
-            pd_error(x, "oscparse: unknown tag '%c' (%d)",
-                (int)(argv[i].a_w.w_float), (int)(argv[i].a_w.w_float));
+            pd_error(x, "oscparse: unknown tag '%c' (%d)", buf[i], buf[i]);
         }
     }
-    outlet_list(x->x_obj.ob_outlet, 0, j, outv);
+    if (x->x_root.n_child &&
+        oscparse_dispatch(&x->x_root, (const char *)buf,
+            (const char *)buf + j, j2, argv))
+                return;
+    a = oscparse_address(x, (const char *)buf, j);
+    for (i = 0; i < a->a_n; i++)
+        SETSYMBOL(argv - a->a_n + i, a->a_vec[i]);
+    outlet_list(x->x_out, 0, a->a_n + j2, argv - a->a_n);
     return;
 tooshort:
     pd_error(x, "oscparse: OSC message ended prematurely");
 }
 
-static t_oscparse *oscparse_new(t_symbol *s, int argc, t_atom *argv)
+static void oscparse_delaytick(t_oscdelay *d);
+
+    /* a message or bundle.  "now" is the time that bundle timetags are
+    measured against: the wall clock, or the timetag of an enclosing
+    bundle that we've waited for. */
+static void oscparse_packet(t_oscparse *x, const unsigned char *buf, int n,
+    double now)
+{
+    int i;
+    if (buf[0] != '#')
+    {
+        oscparse_message(x, buf, n);
+        return;
+    }
+    if (n < 16 || buf[1] != 'b')
+    {
+        pd_error(x, "oscparse: malformed bundle");
+        return;
+    }
+        /* a timetag of 1 means "immediately" */
+    if (x->x_timetags && (READINT(buf+8) || READINT(buf+12) > 1))
+    {
+        double when = READINT(buf+8) + READINT(buf+12) * (1./4294967296.);
+        if (when > now)
+        {
+            t_oscdelay *d = (t_oscdelay *)getbytes(sizeof(*d));
+            d->d_owner = x;
+            d->d_clock = clock_new(d, (t_method)oscparse_delaytick);
+            d->d_time = when;
+            d->d_size = n - 16;
+            d->d_buf = (unsigned char *)getbytes(d->d_size);
+            memcpy(d->d_buf, buf + 16, d->d_size);
+            d->d_next = x->x_delayed;
+            x->x_delayed = d;
+            clock_delay(d->d_clock, 1000. * (when - now));
+            return;
+        }
+    }
+    for (i = 16; i <= n - 4; )
+    {
+        int msize = (int32_t)READINT(buf+i);
+        if (msize <= 0 || msize & 3 || msize > n - i - 4)
+        {
+            pd_error(x, "oscparse: bad bundle element size");
+            return;
+        }
+        oscparse_packet(x, buf+i+4, msize, now);
+        i += msize+4;
+    }
+}
+
+    /* run the elements of a bundle whose time has come; they're in the
+    form of a bundle with its 16-byte header taken off. */
+static void oscparse_delaytick(t_oscdelay *d)
+{
+    t_oscparse *x = d->d_owner;
+    t_oscdelay **dp;
+    int i;
+    for (dp = &x->x_delayed; *dp != d; dp = &(*dp)->d_next)
+        ;
+    *dp = d->d_next;
+    for (i = 0; i <= d->d_size - 4; )
+    {
+        int msize = (int32_t)READINT(d->d_buf+i);
+        if (msize <= 0 || msize & 3 || msize > d->d_size - i - 4)
+        {
+            pd_error(x, "oscparse: bad bundle element size");
+            break;
+        }
+        oscparse_packet(x, d->d_buf+i+4, msize, d->d_time);
+        i += msize+4;
+    }
+    clock_free(d->d_clock);
+    freebytes(d->d_buf, d->d_size);
+    freebytes(d, sizeof(*d));
+}
+
+static void oscparse_list(t_oscparse *x, t_symbol *s, int argc, t_atom *argv)
+{
+    unsigned char *buf;
+    int i;
+    if (argc < 1)
+        return;
+    buf = (unsigned char *)alloca(argc);
+    for (i = 0; i < argc; i++)
+    {
+        if (argv[i].a_type != A_FLOAT)
+        {
+            pd_error(x, "oscparse: takes numbers only");
+            return;
+        }
+        buf[i] = (int)argv[i].a_w.w_float;
+    }
+    oscparse_packet(x, buf, argc,
+        (x->x_timetags && buf[0] == '#' ? oscparse_now() : 0));
+}
+
+static void *oscparse_new(t_symbol *s, int argc, t_atom *argv)
 {
     t_oscparse *x = (t_oscparse *)pd_new(oscparse_class);
-    outlet_new(&x->x_obj, gensym("list"));
+    x->x_root.n_name = &s_;
+    x->x_root.n_len = 0;
+    x->x_root.n_child = 0;
+    x->x_root.n_next = 0;
+    x->x_root.n_handlers = 0;
+    x->x_timetags = 0;
+    x->x_delayed = 0;
+    memset(x->x_cache, 0, sizeof(x->x_cache));
+    for (; argc && argv->a_type == A_SYMBOL &&
+        *argv->a_w.w_symbol->s_name == '-'; argc--, argv++)
+    {
+        if (!strcmp(argv->a_w.w_symbol->s_name, "-t"))
+            x->x_timetags = 1;
+        else pd_error(x, "oscparse: unknown flag '%s'",
+            argv->a_w.w_symbol->s_name);
+    }
+    for (; argc; argc--, argv++)
+    {
+        t_outlet *o = outlet_new(&x->x_obj, &s_list);
+        if (argv->a_type == A_SYMBOL)
+            oscparse_addhandler(oscparse_node(x, argv->a_w.w_symbol, 1),
+                o, 0);
+        else pd_error(x, "oscparse: address expected");
+    }
+    x->x_out = outlet_new(&x->x_obj, &s_list);
     return (x);
 }
 
+static void oscparse_free(t_oscparse *x)
+{
+    t_oscdelay *d;
+    int i;
+    while ((d = x->x_delayed))
+    {
+        x->x_delayed = d->d_next;
+        clock_free(d->d_clock);
+        freebytes(d->d_buf, d->d_size);
+        freebytes(d, sizeof(*d));
+    }
+    for (i = 0; i < OSCPARSE_NCACHE; i++)
+        if (x->x_cache[i].a_name)
+    {
+        freebytes(x->x_cache[i].a_name, x->x_cache[i].a_len);
+        freebytes(x->x_cache[i].a_vec,
+            x->x_cache[i].a_n * sizeof(t_symbol *));
+    }
+    oscparse_freenode(&x->x_root);
+}
+
 void oscparse_setup(void)
 {
     oscparse_class = class_new(gensym("oscparse"), (t_newmethod)oscparse_new,
-        0, sizeof(t_oscparse), 0, A_GIMME, 0);
+        (t_method)oscparse_free, sizeof(t_oscparse), 0, A_GIMME, 0);
     class_addlist(oscparse_class, oscparse_list);
+    class_addmethod(oscparse_class, (t_method)oscparse_bind,
+        gensym("bind"), A_SYMBOL, A_SYMBOL, 0);
+    class_addmethod(oscparse_class, (t_method)oscparse_unbind,
+        gensym("unbind"), A_SYMBOL, A_SYMBOL, 0);
 }
 
 /* --------- oscformat - format simple OSC messages -------------- */
@@ -4,11 +4,15 @@
 
 /* network */
 
+#ifdef __linux__
+#define _GNU_SOURCE     /* for sendmmsg() */
+#endif
 #include "m_pd.h"
 #include "s_stuff.h"
 
 #include <sys/types.h>
 #include <string.h>
+#include <errno.h>
 #ifdef _WIN32
 #include <winsock.h>
 #else
@@ -17,9 +21,23 @@
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
 #define SOCKET_ERROR -1
 #endif
 
+    /* UDP messages sent at one logical time go out together, in batches of
+    up to NETSEND_BATCH datagrams per system call.  The first one of a burst
+    is sent right away so that a lone message isn't held up. */
+#ifdef __linux__
+#define NETSEND_MMSG
+#define NETSEND_BATCH 32
+#endif
+
+    /* receive buffer for UDP netreceive, so that a burst of small packets
+    arriving during a long DSP tick isn't dropped; the OS may cap it */
+#define NETRECEIVE_UDPBUF (1024*1024)
+
 #ifdef _WIN32
 # include <malloc.h> /* MSVC or mingw on windows */
 #elif defined(__linux__) || defined(__APPLE__)
@@ -38,6 +56,14 @@ typedef struct _netsend
     int x_sockfd;
     int x_protocol;
     int x_bin;
+#ifdef NETSEND_MMSG
+    t_clock *x_flushclock;          /* end of burst; null for netreceive */
+    int x_burst;                    /* clock is set */
+    int x_nqueued;
+    char *x_queue[NETSEND_BATCH];   /* datagrams waiting to be sent */
+    int x_queuelen[NETSEND_BATCH];
+    struct _netsend *x_nextpending;
+#endif
 } t_netsend;
 
 static t_class *netreceive_class;
@@ -51,7 +77,10 @@ typedef struct _netreceive
     int x_old;
 } t_netreceive;
 
-static void netreceive_notify(t_netreceive *x, int fd);
+#ifdef NETSEND_MMSG
+static void netsend_flush(t_netsend *x);
+static t_netsend *netsend_pending;  /* those with datagrams queued */
+#endif
 
 static void *netsend_new(t_symbol *s, int argc, t_atom *argv)
 {
@@ -85,38 +114,30 @@ static void *netsend_new(t_symbol *s, int argc, t_atom *argv)
     }
     x->x_sockfd = -1;
     x->x_msgout = outlet_new(&x->x_obj, &s_anything);
+#ifdef NETSEND_MMSG
+    if (x->x_protocol == SOCK_DGRAM)
+        x->x_flushclock = clock_new(x, (t_method)netsend_flush);
+#endif
     return (x);
 }
 
-static void netsend_readbin(t_netsend *x, int fd)
+    /* bytes from a binary connection, one atom per byte */
+static void netsend_readbin(void *z, t_binbuf *b)
 {
-    unsigned char inbuf[MAXPDSTRING];
-    int ret = recv(fd, inbuf, MAXPDSTRING, 0), i;
+    t_netsend *x = (t_netsend *)z;
+    int natom = binbuf_getnatom(b), i;
+    t_atom *at = binbuf_getvec(b);
     if (!x->x_msgout)
     {
         bug("netsend_readbin");
         return;
     }
-    if (ret <= 0)
-    {
-        if (ret < 0)
-            sys_sockerror("recv");
-        sys_rmpollfn(fd);
-        sys_closesocket(fd);
-        if (x->x_obj.ob_pd == netreceive_class)
-            netreceive_notify((t_netreceive *)x, fd);
-    }
-    else if (x->x_protocol == SOCK_DGRAM)
-    {
-        t_atom *ap = (t_atom *)alloca(ret * sizeof(t_atom));
-        for (i = 0; i < ret; i++)
-            SETFLOAT(ap+i, inbuf[i]);
-        outlet_list(x->x_msgout, 0, ret, ap);
-    }
+    if (x->x_protocol == SOCK_DGRAM)
+        outlet_list(x->x_msgout, 0, natom, at);
     else
     {
-        for (i = 0; i < ret; i++)
-            outlet_float(x->x_msgout, inbuf[i]);
+        for (i = 0; i < natom; i++)
+            outlet_float(x->x_msgout, atom_getfloat(at+i));
     }
 }
 
@@ -224,21 +245,26 @@ static void netsend_connect(t_netsend *x, t_symbol *hostname,
     x->x_sockfd = sockfd;
     if (x->x_msgout)    /* add polling function for return messages */
     {
-        if (x->x_bin)
-            sys_addpollfn(sockfd, (t_fdpollfn)netsend_readbin, x);
-        else
-        {
-            t_socketreceiver *y =
-                socketreceiver_new((void *)x, 0, netsend_doit,
+        t_socketreceiver *y =
+            socketreceiver_new((void *)x, 0,
+                (x->x_bin ? netsend_readbin : netsend_doit),
                     x->x_protocol == SOCK_DGRAM);
-            sys_addpollfn(sockfd, (t_fdpollfn)socketreceiver_read, y);
-        }
+        socketreceiver_setbinary(y, x->x_bin);
+        sys_addpollfn(sockfd, (t_fdpollfn)socketreceiver_read, y);
     }
     outlet_float(x->x_obj.ob_outlet, 1);
 }
 
 static void netsend_disconnect(t_netsend *x)
 {
+#ifdef NETSEND_MMSG
+    if (x->x_flushclock)
+    {
+        netsend_flush(x);
+        clock_unset(x->x_flushclock);
+        x->x_burst = 0;
+    }
+#endif
     if (x->x_sockfd >= 0)
     {
         sys_rmpollfn(x->x_sockfd);
@@ -248,29 +274,115 @@ static void netsend_disconnect(t_netsend *x)
     }
 }
 
-static int netsend_dosend(t_netsend *x, int sockfd,
-    t_symbol *s, int argc, t_atom *argv)
+    /* the bytes to send for a message, in a buffer to be freed with
+    freebytes(*bufp, *lengthp) */
+static void netsend_format(t_netsend *x, int argc, t_atom *argv,
+    char **bufp, int *lengthp)
 {
-    char *buf, *bp;
-    int length, sent, fail = 0;
-    t_binbuf *b = 0;
     if (x->x_bin)
     {
         int i;
-        buf = alloca(argc);
+        *bufp = getbytes(argc);
         for (i = 0; i < argc; i++)
-            ((unsigned char *)buf)[i] = atom_getfloatarg(i, argc, argv);
-        length = argc;
+            ((unsigned char *)*bufp)[i] = atom_getfloatarg(i, argc, argv);
+        *lengthp = argc;
     }
     else
     {
         t_atom at;
-        b = binbuf_new();
+        t_binbuf *b = binbuf_new();
         binbuf_add(b, argc, argv);
         SETSEMI(&at);
         binbuf_add(b, 1, &at);
-        binbuf_gettext(b, &buf, &length);
+        binbuf_gettext(b, bufp, lengthp);
+        binbuf_free(b);
+    }
+}
+
+#ifdef NETSEND_MMSG
+    /* send the queued datagrams; on failure, disconnect */
+static void netsend_flush(t_netsend *x)
+{
+    struct mmsghdr msgs[NETSEND_BATCH];
+    struct iovec iovs[NETSEND_BATCH];
+    int i, done = 0, fail = 0;
+    t_netsend **xp;
+    x->x_burst = 0;
+    if (!x->x_nqueued)
+        return;
+    for (xp = &netsend_pending; *xp; xp = &(*xp)->x_nextpending)
+        if (*xp == x)
+    {
+        *xp = x->x_nextpending;
+        break;
+    }
+    memset(msgs, 0, x->x_nqueued * sizeof(*msgs));
+    for (i = 0; i < x->x_nqueued; i++)
+    {
+        iovs[i].iov_base = x->x_queue[i];
+        iovs[i].iov_len = x->x_queuelen[i];
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (done < x->x_nqueued)
+    {
+        int n = sendmmsg(x->x_sockfd, msgs + done, x->x_nqueued - done, 0);
+        if (n <= 0)
+        {
+            sys_sockerror("netsend");
+            fail = 1;
+            break;
+        }
+        done += n;
+    }
+    for (i = 0; i < x->x_nqueued; i++)
+        freebytes(x->x_queue[i], x->x_queuelen[i]);
+    x->x_nqueued = 0;
+    if (fail)
+        netsend_disconnect(x);
+}
+
+    /* queue a UDP message if a burst is under way; returns 0 if the caller
+    should send it itself */
+static int netsend_queue(t_netsend *x, int argc, t_atom *argv)
+{
+    if (!x->x_burst)
+    {
+        clock_delay(x->x_flushclock, 0);
+        x->x_burst = 1;
+        return (0);
+    }
+    if (!x->x_nqueued)
+    {
+        x->x_nextpending = netsend_pending;
+        netsend_pending = x;
+    }
+    netsend_format(x, argc, argv, &x->x_queue[x->x_nqueued],
+        &x->x_queuelen[x->x_nqueued]);
+    if (++x->x_nqueued == NETSEND_BATCH)
+    {
+        netsend_flush(x);
+        if (x->x_sockfd >= 0)
+            x->x_burst = 1;
     }
+    return (1);
+}
+
+    /* Pd may quit before the flush clock goes off (for instance on
+    "; pd quit" at the same logical time); send what's left on the way out */
+static void netsend_flushpending(void)
+{
+    while (netsend_pending)
+        netsend_flush(netsend_pending);
+}
+#endif /* NETSEND_MMSG */
+
+static int netsend_dosend(t_netsend *x, int sockfd,
+    t_symbol *s, int argc, t_atom *argv)
+{
+    char *buf, *bp;
+    int length, sent, fail = 0;
+    netsend_format(x, argc, argv, &buf, &length);
     for (bp = buf, sent = 0; sent < length;)
     {
         static double lastwarntime;
@@ -304,11 +416,7 @@ static int netsend_dosend(t_netsend *x, int sockfd,
         }
     }
     /* done: */
-    if (!x->x_bin)
-    {
-        t_freebytes(buf, length);
-        binbuf_free(b);
-    }
+    freebytes(buf, length);
     return (fail);
 }
 
@@ -317,6 +425,10 @@ static void netsend_send(t_netsend *x, t_symbol *s, int argc, t_atom *argv)
 {
     if (x->x_sockfd >= 0)
     {
+#ifdef NETSEND_MMSG
+        if (x->x_flushclock && netsend_queue(x, argc, argv))
+            return;
+#endif
         if (netsend_dosend(x, x->x_sockfd, s, argc, argv))
             netsend_disconnect(x);
     }
@@ -325,6 +437,10 @@ static void netsend_send(t_netsend *x, t_symbol *s, int argc, t_atom *argv)
 static void netsend_free(t_netsend *x)
 {
     netsend_disconnect(x);
+#ifdef NETSEND_MMSG
+    if (x->x_flushclock)
+        clock_free(x->x_flushclock);
+#endif
 }
 
 static void netsend_setup(void)
@@ -338,6 +454,9 @@ static void netsend_setup(void)
         gensym("disconnect"), 0);
     class_addmethod(netsend_class, (t_method)netsend_send, gensym("send"),
         A_GIMME, 0);
+#ifdef NETSEND_MMSG
+    atexit(netsend_flushpending);
+#endif
 }
 
 /* ----------------------------- netreceive ------------------------- */
@@ -359,28 +478,15 @@ static void netreceive_notify(t_netreceive *x, int fd)
     outlet_float(x->x_ns.x_connectout, x->x_nconnections);
 }
 
-static void netreceive_connectpoll(t_netreceive *x)
+    /* a new connection, already being polled by the socketreceiver the
+    listening one cloned for it */
+static void netreceive_connected(t_netreceive *x, int fd)
 {
-    int fd = accept(x->x_ns.x_sockfd, 0, 0);
-    if (fd < 0) post("netreceive: accept failed");
-    else
-    {
-        int nconnections = x->x_nconnections+1;
-
-        x->x_connections = (int *)t_resizebytes(x->x_connections,
-            x->x_nconnections * sizeof(int), nconnections * sizeof(int));
-        x->x_connections[x->x_nconnections] = fd;
-        if (x->x_ns.x_bin)
-            sys_addpollfn(fd, (t_fdpollfn)netsend_readbin, x);
-        else
-        {
-            t_socketreceiver *y = socketreceiver_new((void *)x,
-            (t_socketnotifier)netreceive_notify,
-                (x->x_ns.x_msgout ? netsend_doit : 0), 0);
-            sys_addpollfn(fd, (t_fdpollfn)socketreceiver_read, y);
-        }
-        outlet_float(x->x_ns.x_connectout, (x->x_nconnections = nconnections));
-    }
+    int nconnections = x->x_nconnections+1;
+    x->x_connections = (int *)t_resizebytes(x->x_connections,
+        x->x_nconnections * sizeof(int), nconnections * sizeof(int));
+    x->x_connections[x->x_nconnections] = fd;
+    outlet_float(x->x_ns.x_connectout, (x->x_nconnections = nconnections));
 }
 
 static void netreceive_closeall(t_netreceive *x)
@@ -426,12 +532,13 @@ static void netreceive_listen(t_netreceive *x, t_floatarg fportno)
         (char *)&intarg, sizeof(intarg)) < 0)
             post("netreceive: setsockopt (SO_REUSEADDR) failed\n");
 #endif
-#if 0
-    intarg = 0;
-    if (setsockopt(x->x_ns.x_sockfd, SOL_SOCKET, SO_RCVBUF,
-        &intarg, sizeof(intarg)) < 0)
-            post("setsockopt (SO_RCVBUF) failed\n");
-#endif
+    if (x->x_ns.x_protocol == SOCK_DGRAM)
+    {
+        intarg = NETRECEIVE_UDPBUF;
+        if (setsockopt(x->x_ns.x_sockfd, SOL_SOCKET, SO_RCVBUF,
+            (char *)&intarg, sizeof(intarg)) < 0)
+                post("netreceive: setsockopt (SO_RCVBUF) failed\n");
+    }
     intarg = 1;
     if (setsockopt(x->x_ns.x_sockfd, SOL_SOCKET, SO_BROADCAST,
         (const void *)&intarg, sizeof(intarg)) < 0)
@@ -460,16 +567,13 @@ static void netreceive_listen(t_netreceive *x, t_floatarg fportno)
 
     if (x->x_ns.x_protocol == SOCK_DGRAM)        /* datagram protocol */
     {
-        if (x->x_ns.x_bin)
-            sys_addpollfn(x->x_ns.x_sockfd, (t_fdpollfn)netsend_readbin, x);
-        else
-        {
-            t_socketreceiver *y = socketreceiver_new((void *)x,
-                (t_socketnotifier)netreceive_notify,
-                    (x->x_ns.x_msgout ? netsend_doit : 0), 1);
-            sys_addpollfn(x->x_ns.x_sockfd, (t_fdpollfn)socketreceiver_read, y);
-            x->x_ns.x_connectout = 0;
-        }
+        t_socketreceiver *y = socketreceiver_new((void *)x,
+            (t_socketnotifier)netreceive_notify,
+                (x->x_ns.x_bin ? netsend_readbin :
+                    (x->x_ns.x_msgout ? netsend_doit : 0)), 1);
+        socketreceiver_setbinary(y, x->x_ns.x_bin);
+        sys_addpollfn(x->x_ns.x_sockfd, (t_fdpollfn)socketreceiver_read, y);
+        x->x_ns.x_connectout = 0;
     }
     else        /* streaming protocol */
     {
@@ -481,7 +585,15 @@ static void netreceive_listen(t_netreceive *x, t_floatarg fportno)
         }
         else
         {
-            sys_addpollfn(x->x_ns.x_sockfd, (t_fdpollfn)netreceive_connectpoll, x);
+                /* connections get a copy of this receiver; see
+                socketreceiver_listen() */
+            t_socketreceiver *y = socketreceiver_new((void *)x,
+                (t_socketnotifier)netreceive_notify,
+                    (x->x_ns.x_bin ? netsend_readbin :
+                        (x->x_ns.x_msgout ? netsend_doit : 0)), 0);
+            socketreceiver_setbinary(y, x->x_ns.x_bin);
+            socketreceiver_listen(y, (t_socketnotifier)netreceive_connected);
+            sys_addpollfn(x->x_ns.x_sockfd, (t_fdpollfn)socketreceiver_read, y);
             x->x_ns.x_connectout = outlet_new(&x->x_ns.x_obj, &s_float);
         }
     }
@@ -566,9 +678,944 @@ static void netreceive_setup(void)
         gensym("send"), A_GIMME, 0);
 }
 
+/* ----------------------- netsend~ and netreceive~ ---------------------- */
+
+/* Audio over UDP.  netsend~ packs one or more DSP blocks of its inputs into
+each datagram, as 16- or 24-bit integers or 32-bit floats, after a header
+giving a stream number (new each time the sender connects), a sequence
+number and the layout.  netreceive~ files datagrams in a jitter buffer by
+sequence number and plays them some time later.  How much later adapts:
+the target is the spread in arrival times over the last few seconds, plus
+a datagram.  The delay grows toward it by waiting whenever the next
+datagram hasn't arrived, and shrinks by skipping datagrams when the
+buffer has stayed fuller than the target for half a second.  A datagram
+that's missing while enough later ones are there is taken as lost and
+replaced by the last one played back and forth, fading out; going in and
+out of that, and skipping, are crossfaded.
+
+The "simulate" method on netreceive~ drops and delays incoming datagrams
+at random, so all of this can be tried over the loopback interface. */
+
+#define NETAUDIO_MAGIC 0x50644131   /* "PdA1" */
+#define NETAUDIO_HEADER 24
+#define NETAUDIO_MAXPAYLOAD 65000   /* sample bytes in a datagram */
+#define NETAUDIO_MAXFRAMES 8192     /* frames in a datagram */
+#define NETAUDIO_MAXSLOTS 4096      /* datagrams in the jitter buffer */
+#define NETAUDIO_MAXRECV 256        /* datagrams read per DSP tick */
+#define NETAUDIO_XFADE 64           /* crossfade length in frames */
+#define NETAUDIO_CONCEAL 2048       /* frames for concealment to fade out */
+#define NETAUDIO_HISTORY 8          /* half seconds of jitter to go by */
+
+static void netaudio_put32(unsigned char *p, unsigned int v)
+{
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static unsigned int netaudio_get32(const unsigned char *p)
+{
+    return (((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+        ((unsigned int)p[2] << 8) | p[3]);
+}
+
+static void netaudio_nonblock(int fd)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket(fd, FIONBIO, &on);
+#else
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+    /* convert "n" frames from "nchans" inputs to interleaved big-endian
+    samples of "bytes" bytes each.  Each channel is done in one loop, with
+    no per-sample branches but the clipping, so the compiler can vectorize
+    the arithmetic. */
+static void netaudio_encode(unsigned char *buf, t_sample **in, int nchans,
+    int n, int bytes)
+{
+    int ch, i, stride = nchans * bytes;
+    for (ch = 0; ch < nchans; ch++)
+    {
+        t_sample *fp = in[ch];
+        unsigned char *p = buf + ch * bytes;
+        if (bytes == 2)
+        {
+            for (i = 0; i < n; i++, p += stride)
+            {
+                t_sample f = fp[i];
+                int v;
+                f = (f > 1 ? 1 : (f < -1 ? -1 : f));
+                v = (int)(f * 32767.f + 32768.5f) - 32768;
+                p[0] = v >> 8; p[1] = v;
+            }
+        }
+        else if (bytes == 3)
+        {
+            for (i = 0; i < n; i++, p += stride)
+            {
+                t_sample f = fp[i];
+                int v;
+                f = (f > 1 ? 1 : (f < -1 ? -1 : f));
+                v = (int)(f * 8388607.f + 8388608.5f) - 8388608;
+                p[0] = v >> 16; p[1] = v >> 8; p[2] = v;
+            }
+        }
+        else
+        {
+            for (i = 0; i < n; i++, p += stride)
+            {
+                union { float f; unsigned int u; } v;
+                v.f = fp[i];
+                netaudio_put32(p, v.u);
+            }
+        }
+    }
+}
+
+    /* the reverse, into interleaved floats, "outchans" to a frame; channels
+    that aren't in the datagram are zeroed and extra ones dropped */
+static void netaudio_decode(t_float *out, int outchans,
+    const unsigned char *buf, int nchans, int n, int bytes)
+{
+    int ch, i, stride = nchans * bytes;
+    for (ch = 0; ch < outchans; ch++)
+    {
+        t_float *fp = out + ch;
+        const unsigned char *p = buf + ch * bytes;
+        if (ch >= nchans)
+        {
+            for (i = 0; i < n; i++)
+                fp[i * outchans] = 0;
+        }
+        else if (bytes == 2)
+        {
+            for (i = 0; i < n; i++, p += stride)
+                fp[i * outchans] = (short)((p[0] << 8) | p[1]) *
+                    (1.f / 32767.f);
+        }
+        else if (bytes == 3)
+        {
+            for (i = 0; i < n; i++, p += stride)
+                fp[i * outchans] = ((int)(((unsigned int)p[0] << 24) |
+                    (p[1] << 16) | (p[2] << 8)) >> 8) * (1.f / 8388607.f);
+        }
+        else
+        {
+            for (i = 0; i < n; i++, p += stride)
+            {
+                union { float f; unsigned int u; } v;
+                v.u = netaudio_get32(p);
+                fp[i * outchans] = v.f;
+            }
+        }
+    }
+}
+
+    /* a datagram's header:
+        0   magic
+        4   stream number
+        8   sequence number
+        12  number of channels
+        16  frames
+        20  bytes per sample (2, 3, or 4 for float) */
+
+static t_class *netsend_tilde_class;
+
+typedef struct _netsend_tilde
+{
+    t_object x_obj;
+    t_float x_f;
+    int x_sockfd;
+    int x_nchans;
+    int x_bytes;            /* bytes per sample */
+    int x_nblocks;          /* DSP blocks per datagram */
+    int x_blockcount;       /* blocks in the datagram being filled */
+    int x_frames;           /* frames in it */
+    unsigned int x_stream;
+    unsigned int x_seq;
+    t_sample **x_invec;
+    unsigned char *x_packet;
+    int x_senderr;          /* error to report, from the clock */
+    t_clock *x_errclock;
+} t_netsend_tilde;
+
+static int netaudio_bytes(t_floatarg bits)
+{
+    return (bits == 16 ? 2 : (bits == 24 ? 3 : (bits == 32 ? 4 : 0)));
+}
+
+static void netsend_tilde_senderr(t_netsend_tilde *x)
+{
+    pd_error(x, "netsend~: send: %s", strerror(x->x_senderr));
+}
+
+static void netsend_tilde_flush(t_netsend_tilde *x)
+{
+    int size = NETAUDIO_HEADER + x->x_frames * x->x_nchans * x->x_bytes;
+    unsigned char *p = x->x_packet;
+    netaudio_put32(p, NETAUDIO_MAGIC);
+    netaudio_put32(p + 4, x->x_stream);
+    netaudio_put32(p + 8, x->x_seq++);
+    netaudio_put32(p + 12, x->x_nchans);
+    netaudio_put32(p + 16, x->x_frames);
+    netaudio_put32(p + 20, x->x_bytes);
+        /* a full socket buffer, or nobody listening yet, isn't worth a
+        word; anything else is reported once */
+    if (send(x->x_sockfd, (char *)p, size, 0) < 0 && errno != EAGAIN &&
+        errno != EWOULDBLOCK && errno != ECONNREFUSED && !x->x_senderr)
+    {
+        x->x_senderr = errno;
+        clock_delay(x->x_errclock, 0);
+    }
+    x->x_frames = x->x_blockcount = 0;
+}
+
+static t_int *netsend_tilde_perform(t_int *w)
+{
+    t_netsend_tilde *x = (t_netsend_tilde *)(w[1]);
+    int n = (int)(w[2]), framebytes = x->x_nchans * x->x_bytes;
+    if (x->x_sockfd >= 0 && n * framebytes <= NETAUDIO_MAXPAYLOAD &&
+        n <= NETAUDIO_MAXFRAMES)
+    {
+        if ((x->x_frames + n) * framebytes > NETAUDIO_MAXPAYLOAD ||
+            x->x_frames + n > NETAUDIO_MAXFRAMES)
+                netsend_tilde_flush(x);
+        netaudio_encode(x->x_packet + NETAUDIO_HEADER +
+            x->x_frames * framebytes, x->x_invec, x->x_nchans, n, x->x_bytes);
+        x->x_frames += n;
+        if (++x->x_blockcount >= x->x_nblocks)
+            netsend_tilde_flush(x);
+    }
+    return (w+3);
+}
+
+static void netsend_tilde_dsp(t_netsend_tilde *x, t_signal **sp)
+{
+    int i;
+    if (sp[0]->s_n * x->x_nchans * 4 > NETAUDIO_MAXPAYLOAD ||
+        sp[0]->s_n > NETAUDIO_MAXFRAMES)
+    {
+        pd_error(x, "netsend~: block too big for a datagram");
+        return;
+    }
+    for (i = 0; i < x->x_nchans; i++)
+        x->x_invec[i] = sp[i]->s_vec;
+    x->x_frames = x->x_blockcount = 0;
+    dsp_add(netsend_tilde_perform, 2, x, sp[0]->s_n);
+}
+
+static void netsend_tilde_disconnect(t_netsend_tilde *x)
+{
+    if (x->x_sockfd >= 0)
+    {
+        sys_closesocket(x->x_sockfd);
+        x->x_sockfd = -1;
+        outlet_float(x->x_obj.ob_outlet, 0);
+    }
+}
+
+static void netsend_tilde_connect(t_netsend_tilde *x, t_symbol *hostname,
+    t_floatarg fportno)
+{
+    struct sockaddr_in server = {0};
+    struct hostent *hp;
+    int sockfd, intarg = 1;
+    netsend_tilde_disconnect(x);
+    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+    {
+        sys_sockerror("socket");
+        return;
+    }
+    if (!(hp = gethostbyname(hostname->s_name)))
+    {
+        pd_error(x, "netsend~: bad host %s", hostname->s_name);
+        sys_closesocket(sockfd);
+        return;
+    }
+    if (setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST,
+        (const void *)&intarg, sizeof(intarg)) < 0)
+            post("netsend~: setsockopt (SO_BROADCAST) failed");
+    server.sin_family = AF_INET;
+    memcpy((char *)&server.sin_addr, (char *)hp->h_addr, hp->h_length);
+    server.sin_port = htons((u_short)fportno);
+    if (connect(sockfd, (struct sockaddr *)&server, sizeof(server)) < 0)
+    {
+        sys_sockerror("netsend~: connect");
+        sys_closesocket(sockfd);
+        return;
+    }
+        /* the DSP thread mustn't wait on the network */
+    netaudio_nonblock(sockfd);
+    x->x_sockfd = sockfd;
+    x->x_stream = (unsigned int)(sys_getrealtime() * 1e6) ^
+        (unsigned int)(size_t)x;
+    x->x_seq = 0;
+    x->x_frames = x->x_blockcount = 0;
+    x->x_senderr = 0;
+    outlet_float(x->x_obj.ob_outlet, 1);
+}
+
+static void netsend_tilde_format(t_netsend_tilde *x, t_floatarg bits)
+{
+    int bytes = netaudio_bytes(bits);
+    if (!bytes)
+        pd_error(x, "netsend~: format %g: use 16, 24, or 32 (float)", bits);
+    else x->x_bytes = bytes, x->x_frames = x->x_blockcount = 0;
+}
+
+static void netsend_tilde_packing(t_netsend_tilde *x, t_floatarg f)
+{
+    x->x_nblocks = (f < 1 ? 1 : (f > 64 ? 64 : f));
+}
+
+static void *netsend_tilde_new(t_symbol *s, int argc, t_atom *argv)
+{
+    t_netsend_tilde *x = (t_netsend_tilde *)pd_new(netsend_tilde_class);
+    int i;
+    x->x_bytes = 2;
+    x->x_nblocks = 1;
+    while (argc && argv->a_type == A_SYMBOL &&
+        *argv->a_w.w_symbol->s_name == '-')
+    {
+        char *flag = argv->a_w.w_symbol->s_name;
+        if (!strcmp(flag, "-f") && argc > 1)
+        {
+            netsend_tilde_format(x, atom_getfloatarg(1, argc, argv));
+            argc--; argv++;
+        }
+        else if (!strcmp(flag, "-p") && argc > 1)
+        {
+            netsend_tilde_packing(x, atom_getfloatarg(1, argc, argv));
+            argc--; argv++;
+        }
+        else
+        {
+            pd_error(x, "netsend~: unknown flag ...");
+            postatom(argc, argv); endpost();
+        }
+        argc--; argv++;
+    }
+    x->x_nchans = (argc ? atom_getfloatarg(0, argc, argv) : 1);
+    if (x->x_nchans < 1)
+        x->x_nchans = 1;
+    else if (x->x_nchans > NETAUDIO_MAXPAYLOAD / (4 * DEFDACBLKSIZE))
+        x->x_nchans = NETAUDIO_MAXPAYLOAD / (4 * DEFDACBLKSIZE);
+    for (i = 1; i < x->x_nchans; i++)
+        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    outlet_new(&x->x_obj, &s_float);
+    x->x_invec = (t_sample **)getbytes(x->x_nchans * sizeof(t_sample *));
+    x->x_packet = (unsigned char *)getbytes(NETAUDIO_HEADER +
+        NETAUDIO_MAXPAYLOAD);
+    x->x_errclock = clock_new(x, (t_method)netsend_tilde_senderr);
+    x->x_sockfd = -1;
+    return (x);
+}
+
+static void netsend_tilde_free(t_netsend_tilde *x)
+{
+    netsend_tilde_disconnect(x);
+    clock_free(x->x_errclock);
+    freebytes(x->x_invec, x->x_nchans * sizeof(t_sample *));
+    freebytes(x->x_packet, NETAUDIO_HEADER + NETAUDIO_MAXPAYLOAD);
+}
+
+static t_class *netreceive_tilde_class;
+
+#define NETAUDIO_IDLE 0         /* waiting for a stream */
+#define NETAUDIO_BUFFERING 1    /* filling the buffer before playing */
+#define NETAUDIO_PLAYING 2
+
+typedef struct _netreceive_tilde
+{
+    t_object x_obj;
+    t_outlet *x_statout;
+    int x_sockfd;
+    int x_nchans;
+    t_sample **x_outvec;
+    unsigned char *x_recvbuf;
+    t_float x_sr;
+    t_float x_mindelayms;
+    t_float x_maxdelayms;
+        /* the jitter buffer, x_nslots datagrams of x_pktframes frames */
+    int x_state;
+    unsigned int x_stream;
+    int x_pktframes;
+    int x_nslots;
+    int x_bufframes;            /* room in x_buf, in frames */
+    t_float *x_buf;
+    unsigned int *x_slotseq;
+    double *x_slotready;        /* when it may be played, or -1 if empty */
+    unsigned int x_playseq;     /* datagram being played */
+    int x_playoff;              /* frames of it played */
+    int x_lostmode;             /* concealing it because it's lost */
+        /* concealment and crossfades */
+    t_float *x_lastgood;        /* last datagram played */
+    int x_havelastgood;
+    int x_concealing;
+    int x_concealpos;
+    t_float x_concealgain;
+    t_float *x_tmpbuf;
+    t_float *x_fade;            /* what we're crossfading out of */
+    int x_fadelen;
+    int x_fadeleft;
+        /* adapting the delay, all in frames */
+    double x_now;
+    int x_mindelay;
+    int x_maxdelay;
+    int x_target;
+    int x_ahead;                /* how much is waiting to be played */
+    int x_nvisible;             /* datagrams that are waiting */
+    int x_winleft;
+    int x_winmin;
+    int x_waiting;              /* for a datagram that hasn't come */
+    int x_wantskip;
+    unsigned int x_seqbase;
+    double x_dmin;              /* earliest and latest arrival this half */
+    double x_dmax;              /* second, relative to the sequence number */
+    double x_histmin[NETAUDIO_HISTORY];
+    double x_histmax[NETAUDIO_HISTORY];
+    int x_nhist;
+    double x_silent;
+        /* statistics */
+    int x_nreceived;
+    int x_nlost;
+    int x_nlate;
+    int x_nskipped;
+    int x_nunderrun;
+        /* simulated network trouble */
+    t_float x_simloss;
+    t_float x_simjitter;        /* msec */
+    unsigned int x_simseed;
+} t_netreceive_tilde;
+
+static t_float netreceive_tilde_random(t_netreceive_tilde *x)
+{
+    x->x_simseed = x->x_simseed * 1103515245 + 12345;
+    return ((x->x_simseed >> 8) * (1.f / 16777216.f));
+}
+
+    /* start over with a new stream, or after the old one stopped */
+static void netreceive_tilde_reset(t_netreceive_tilde *x, unsigned int stream,
+    int pktframes)
+{
+    int i;
+    x->x_stream = stream;
+    x->x_pktframes = pktframes;
+    x->x_nslots = x->x_bufframes / pktframes;
+    if (x->x_nslots > NETAUDIO_MAXSLOTS)
+        x->x_nslots = NETAUDIO_MAXSLOTS;
+    for (i = 0; i < NETAUDIO_MAXSLOTS; i++)
+        x->x_slotready[i] = -1;
+    x->x_state = NETAUDIO_IDLE;
+    x->x_playoff = x->x_lostmode = 0;
+    x->x_havelastgood = x->x_concealing = 0;
+    x->x_concealgain = 1;
+    x->x_fadeleft = 0;
+    x->x_target = (x->x_mindelay > pktframes ? x->x_mindelay : pktframes);
+    x->x_winmin = 0x7fffffff;
+    x->x_waiting = x->x_wantskip = 0;
+    x->x_dmin = 1e30;
+    x->x_dmax = -1e30;
+    x->x_nhist = 0;
+    x->x_silent = 0;
+}
+
+    /* the samples of a datagram if it's here and may be played */
+static t_float *netreceive_tilde_slot(t_netreceive_tilde *x, unsigned int seq)
+{
+    int slot = seq % x->x_nslots;
+    if (x->x_slotseq[slot] == seq && x->x_slotready[slot] >= 0 &&
+        x->x_slotready[slot] <= x->x_now)
+            return (x->x_buf + (size_t)slot * x->x_pktframes * x->x_nchans);
+    else return (0);
+}
+
+    /* file a datagram in the jitter buffer */
+static void netreceive_tilde_store(t_netreceive_tilde *x,
+    const unsigned char *p, int size)
+{
+    unsigned int stream, seq;
+    int nchans, frames, bytes, slot, ahead;
+    double arrival;
+    if (size < NETAUDIO_HEADER || netaudio_get32(p) != NETAUDIO_MAGIC)
+        return;
+    stream = netaudio_get32(p + 4);
+    seq = netaudio_get32(p + 8);
+    nchans = netaudio_get32(p + 12);
+    frames = netaudio_get32(p + 16);
+    bytes = netaudio_get32(p + 20);
+    if ((bytes != 2 && bytes != 3 && bytes != 4) || nchans < 1 ||
+        frames < 1 || frames > NETAUDIO_MAXFRAMES ||
+        frames > x->x_bufframes / 2 ||
+        size < NETAUDIO_HEADER + frames * nchans * bytes)
+            return;
+    if (x->x_simloss > 0 && netreceive_tilde_random(x) < x->x_simloss)
+        return;
+    x->x_nreceived++;
+    if (stream != x->x_stream || frames != x->x_pktframes)
+        netreceive_tilde_reset(x, stream, frames);
+    ahead = (int)(seq - x->x_playseq);
+    if (x->x_state == NETAUDIO_IDLE ||
+        (x->x_state == NETAUDIO_BUFFERING && ahead < 0 &&
+            ahead > -x->x_nslots))
+    {
+        if (x->x_state == NETAUDIO_IDLE)
+            x->x_state = NETAUDIO_BUFFERING, x->x_seqbase = seq;
+        x->x_playseq = seq;
+        ahead = 0;
+    }
+    if (ahead < 0)
+    {
+        x->x_nlate++;
+        return;
+    }
+    else if (ahead >= x->x_nslots)
+    {
+            /* too far ahead to keep, so the sender must have moved on
+            without us; start again from here */
+        netreceive_tilde_reset(x, stream, frames);
+        x->x_state = NETAUDIO_BUFFERING;
+        x->x_playseq = x->x_seqbase = seq;
+    }
+    slot = seq % x->x_nslots;
+    x->x_slotseq[slot] = seq;
+    x->x_slotready[slot] = x->x_now + (x->x_simjitter > 0 ?
+        netreceive_tilde_random(x) * x->x_simjitter * x->x_sr * 0.001 : 0);
+    arrival = x->x_slotready[slot] -
+        (double)(int)(seq - x->x_seqbase) * frames;
+    if (arrival < x->x_dmin)
+        x->x_dmin = arrival;
+    if (arrival > x->x_dmax)
+        x->x_dmax = arrival;
+    netaudio_decode(x->x_buf + (size_t)slot * frames * x->x_nchans,
+        x->x_nchans, p + NETAUDIO_HEADER, nchans, frames, bytes);
+}
+
+    /* count what's waiting to be played */
+static void netreceive_tilde_scan(t_netreceive_tilde *x)
+{
+    int i, n = 0;
+    for (i = 0; i < x->x_nslots; i++)
+        if (x->x_slotready[i] >= 0 && x->x_slotready[i] <= x->x_now &&
+            (unsigned int)(x->x_slotseq[i] - x->x_playseq) <
+                (unsigned int)x->x_nslots)
+                    n++;
+    x->x_nvisible = n;
+    x->x_ahead = n * x->x_pktframes - x->x_playoff;
+    if (x->x_ahead < 0)
+        x->x_ahead = 0;
+}
+
+    /* make up "n" frames from the last good datagram, played backward from
+    its end, then forward, and so on, fading out */
+static void netreceive_tilde_conceal(t_netreceive_tilde *x, t_float *out,
+    int n)
+{
+    int i, ch, nchans = x->x_nchans, len = x->x_pktframes;
+    t_float decr = 1.f / NETAUDIO_CONCEAL;
+    for (i = 0; i < n; i++, out += nchans)
+    {
+        int pos = x->x_concealpos, k;
+        t_float *in;
+        if (!x->x_havelastgood || x->x_concealgain <= 0)
+        {
+            for (ch = 0; ch < nchans; ch++)
+                out[ch] = 0;
+            continue;
+        }
+        k = (pos < len ? len - 1 - pos : pos - len);
+        in = x->x_lastgood + k * nchans;
+        for (ch = 0; ch < nchans; ch++)
+            out[ch] = in[ch] * x->x_concealgain;
+        if (++x->x_concealpos == 2 * len)
+            x->x_concealpos = 0;
+        x->x_concealgain -= decr;
+    }
+}
+
+    /* copy interleaved frames to the outputs, crossfading if need be */
+static void netreceive_tilde_out(t_netreceive_tilde *x, t_float *in,
+    int onset, int n)
+{
+    int i, ch, nchans = x->x_nchans;
+    for (ch = 0; ch < nchans; ch++)
+    {
+        t_sample *out = x->x_outvec[ch] + onset;
+        for (i = 0; i < n; i++)
+            out[i] = in[i * nchans + ch];
+    }
+    for (i = 0; i < n && x->x_fadeleft; i++, x->x_fadeleft--)
+    {
+        int k = x->x_fadelen - x->x_fadeleft;
+        t_float w = (t_float)k / x->x_fadelen,
+            *from = x->x_fade + k * nchans;
+        for (ch = 0; ch < nchans; ch++)
+            x->x_outvec[ch][onset + i] = w * x->x_outvec[ch][onset + i] +
+                (1 - w) * from[ch];
+    }
+}
+
+static void netreceive_tilde_startfade(t_netreceive_tilde *x, t_float *from,
+    int n)
+{
+    x->x_fadelen = x->x_fadeleft = n;
+    if (from)
+        memcpy(x->x_fade, from, n * x->x_nchans * sizeof(t_float));
+    else netreceive_tilde_conceal(x, x->x_fade, n);
+}
+
+    /* once every half second: set the target delay from the spread in
+    arrival times, and skip ahead if we've been holding on to more */
+static void netreceive_tilde_adapt(t_netreceive_tilde *x)
+{
+    double lo, hi;
+    int i, n;
+    if (x->x_dmax >= x->x_dmin)
+    {
+        n = x->x_nhist % NETAUDIO_HISTORY;
+        x->x_histmin[n] = x->x_dmin;
+        x->x_histmax[n] = x->x_dmax;
+        x->x_nhist++;
+    }
+    n = (x->x_nhist < NETAUDIO_HISTORY ? x->x_nhist : NETAUDIO_HISTORY);
+    for (i = 0, lo = 1e30, hi = -1e30; i < n; i++)
+    {
+        if (x->x_histmin[i] < lo)
+            lo = x->x_histmin[i];
+        if (x->x_histmax[i] > hi)
+            hi = x->x_histmax[i];
+    }
+    if (n)
+    {
+        x->x_target = (hi - lo) + x->x_pktframes;
+        if (x->x_target < x->x_mindelay)
+            x->x_target = x->x_mindelay;
+        if (x->x_target > x->x_maxdelay)
+            x->x_target = x->x_maxdelay;
+    }
+    if (x->x_winmin >= x->x_target + x->x_pktframes)
+        x->x_wantskip = (x->x_winmin - x->x_target) / x->x_pktframes;
+    x->x_winmin = 0x7fffffff;
+    x->x_dmin = 1e30;
+    x->x_dmax = -1e30;
+    x->x_winleft += x->x_sr * 0.5;
+}
+
+static void netreceive_tilde_play(t_netreceive_tilde *x, int n)
+{
+    int done = 0, ch, i;
+    t_float *p;
+    if (x->x_pktframes)
+        netreceive_tilde_scan(x);
+    if (x->x_state == NETAUDIO_BUFFERING && x->x_ahead >= x->x_target &&
+        netreceive_tilde_slot(x, x->x_playseq))
+    {
+        x->x_state = NETAUDIO_PLAYING;
+        memset(x->x_fade, 0, NETAUDIO_XFADE * x->x_nchans * sizeof(t_float));
+        x->x_fadelen = x->x_fadeleft = NETAUDIO_XFADE;
+        x->x_winleft = x->x_sr * 0.5;
+    }
+    if (x->x_state != NETAUDIO_PLAYING)
+    {
+        for (ch = 0; ch < x->x_nchans; ch++)
+            for (i = 0; i < n; i++)
+                x->x_outvec[ch][i] = 0;
+        return;
+    }
+    if (x->x_ahead < x->x_winmin)
+        x->x_winmin = x->x_ahead;
+    while (done < n)
+    {
+        int chunk;
+        if (!x->x_lostmode && (p = netreceive_tilde_slot(x, x->x_playseq)))
+        {
+            if (x->x_concealing)
+            {
+                netreceive_tilde_startfade(x, 0, NETAUDIO_XFADE);
+                x->x_concealing = 0;
+            }
+            if (x->x_waiting)
+            {
+                x->x_nunderrun++;
+                x->x_waiting = x->x_wantskip = 0;
+            }
+            x->x_concealgain = 1;
+            x->x_silent = 0;
+            chunk = x->x_pktframes - x->x_playoff;
+            if (chunk > n - done)
+                chunk = n - done;
+            netreceive_tilde_out(x, p + x->x_playoff * x->x_nchans,
+                done, chunk);
+            done += chunk;
+            if ((x->x_playoff += chunk) == x->x_pktframes)
+            {
+                memcpy(x->x_lastgood, p,
+                    x->x_pktframes * x->x_nchans * sizeof(t_float));
+                x->x_havelastgood = 1;
+                x->x_slotready[x->x_playseq % x->x_nslots] = -1;
+                x->x_playseq++;
+                x->x_playoff = 0;
+                    /* drop a datagram, crossfading from its beginning
+                    into the one after */
+                if (x->x_wantskip &&
+                    (p = netreceive_tilde_slot(x, x->x_playseq)) &&
+                    netreceive_tilde_slot(x, x->x_playseq + 1))
+                {
+                    netreceive_tilde_startfade(x, p,
+                        (x->x_pktframes < NETAUDIO_XFADE ?
+                            x->x_pktframes : NETAUDIO_XFADE));
+                    x->x_slotready[x->x_playseq % x->x_nslots] = -1;
+                    x->x_playseq++;
+                    x->x_nskipped++;
+                    x->x_wantskip--;
+                }
+            }
+        }
+        else
+        {
+                /* if later datagrams are in and there's enough of them,
+                this one is lost, so play something else in its place.
+                Otherwise we ran dry; wait for it, so that the delay
+                grows. */
+            if (!x->x_lostmode && !x->x_playoff && x->x_nvisible &&
+                x->x_ahead >= x->x_target)
+            {
+                x->x_lostmode = 1;
+                x->x_waiting = 0;
+                x->x_nlost++;
+            }
+            else if (!x->x_lostmode)
+                x->x_waiting = 1;
+            if (!x->x_concealing)
+            {
+                x->x_concealing = 1;
+                x->x_concealpos = 0;
+            }
+            chunk = n - done;
+            if (chunk > x->x_pktframes - x->x_playoff)
+                chunk = x->x_pktframes - x->x_playoff;
+            netreceive_tilde_conceal(x, x->x_tmpbuf, chunk);
+            netreceive_tilde_out(x, x->x_tmpbuf, done, chunk);
+            done += chunk;
+            if (x->x_lostmode)
+            {
+                if ((x->x_playoff += chunk) == x->x_pktframes)
+                {
+                    x->x_playseq++;
+                    x->x_playoff = 0;
+                    x->x_lostmode = 0;
+                }
+            }
+            else if (x->x_concealgain <= 0)
+                x->x_silent += chunk;
+        }
+    }
+    if ((x->x_winleft -= n) <= 0)
+        netreceive_tilde_adapt(x);
+        /* after a second of silence, wait for the stream to come back */
+    if (x->x_silent > x->x_sr)
+        netreceive_tilde_reset(x, x->x_stream, x->x_pktframes);
+}
+
+static t_int *netreceive_tilde_perform(t_int *w)
+{
+    t_netreceive_tilde *x = (t_netreceive_tilde *)(w[1]);
+    int n = (int)(w[2]), i, size;
+    if (x->x_sockfd >= 0)
+        for (i = 0; i < NETAUDIO_MAXRECV; i++)
+    {
+        if ((size = recv(x->x_sockfd, (char *)x->x_recvbuf,
+            NETAUDIO_HEADER + NETAUDIO_MAXPAYLOAD, 0)) < 0)
+                break;
+        netreceive_tilde_store(x, x->x_recvbuf, size);
+    }
+    netreceive_tilde_play(x, n);
+    x->x_now += n;
+    return (w+3);
+}
+
+    /* the buffer is sized here, when the sample rate is known */
+static void netreceive_tilde_dsp(t_netreceive_tilde *x, t_signal **sp)
+{
+    int i, bufframes;
+    x->x_sr = sp[0]->s_sr;
+    x->x_maxdelay = x->x_maxdelayms * x->x_sr * 0.001;
+    x->x_mindelay = x->x_mindelayms * x->x_sr * 0.001;
+    bufframes = x->x_maxdelay + 2 * NETAUDIO_MAXFRAMES;
+    if (bufframes != x->x_bufframes)
+    {
+        x->x_buf = (t_float *)resizebytes(x->x_buf,
+            (size_t)x->x_bufframes * x->x_nchans * sizeof(t_float),
+            (size_t)bufframes * x->x_nchans * sizeof(t_float));
+        x->x_bufframes = bufframes;
+    }
+    if (x->x_pktframes)
+        netreceive_tilde_reset(x, x->x_stream, x->x_pktframes);
+    for (i = 0; i < x->x_nchans; i++)
+        x->x_outvec[i] = sp[i]->s_vec;
+    dsp_add(netreceive_tilde_perform, 2, x, sp[0]->s_n);
+}
+
+static void netreceive_tilde_close(t_netreceive_tilde *x)
+{
+    if (x->x_sockfd >= 0)
+    {
+        sys_closesocket(x->x_sockfd);
+        x->x_sockfd = -1;
+    }
+}
+
+static void netreceive_tilde_listen(t_netreceive_tilde *x, t_floatarg fportno)
+{
+    struct sockaddr_in server = {0};
+    int portno = fportno, intarg;
+    netreceive_tilde_close(x);
+    if (portno <= 0)
+        return;
+    if ((x->x_sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+    {
+        sys_sockerror("socket");
+        return;
+    }
+    intarg = 1;
+    if (setsockopt(x->x_sockfd, SOL_SOCKET, SO_REUSEADDR,
+        (char *)&intarg, sizeof(intarg)) < 0)
+            post("netreceive~: setsockopt (SO_REUSEADDR) failed");
+    intarg = NETRECEIVE_UDPBUF;
+    if (setsockopt(x->x_sockfd, SOL_SOCKET, SO_RCVBUF,
+        (char *)&intarg, sizeof(intarg)) < 0)
+            post("netreceive~: setsockopt (SO_RCVBUF) failed");
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = INADDR_ANY;
+    server.sin_port = htons((u_short)portno);
+    if (bind(x->x_sockfd, (struct sockaddr *)&server, sizeof(server)) < 0)
+    {
+        sys_sockerror("netreceive~: bind");
+        netreceive_tilde_close(x);
+        return;
+    }
+    netaudio_nonblock(x->x_sockfd);
+}
+
+static void netreceive_tilde_delay(t_netreceive_tilde *x, t_floatarg mindelay,
+    t_floatarg maxdelay)
+{
+    x->x_mindelayms = (mindelay < 0 ? 0 : mindelay);
+    x->x_maxdelayms = (maxdelay < x->x_mindelayms + 10 ?
+        x->x_mindelayms + 10 : maxdelay);
+    canvas_update_dsp();
+}
+
+    /* drop a fraction of datagrams and delay the others at random by up to
+    "jitter" msec, for testing; "seed" restarts the random numbers */
+static void netreceive_tilde_simulate(t_netreceive_tilde *x, t_floatarg loss,
+    t_floatarg jitter, t_floatarg seed)
+{
+    x->x_simloss = (loss < 0 ? 0 : (loss > 1 ? 1 : loss));
+    x->x_simjitter = (jitter < 0 ? 0 : jitter);
+    if (seed != 0)
+        x->x_simseed = seed;
+}
+
+static void netreceive_tilde_bang(t_netreceive_tilde *x)
+{
+    t_atom at[7];
+    t_float msec = (x->x_sr > 0 ? 1000 / x->x_sr : 0);
+    SETFLOAT(at, (x->x_state == NETAUDIO_PLAYING ? x->x_ahead * msec : 0));
+    SETFLOAT(at+1, x->x_target * msec);
+    SETFLOAT(at+2, x->x_nreceived);
+    SETFLOAT(at+3, x->x_nlost);
+    SETFLOAT(at+4, x->x_nlate);
+    SETFLOAT(at+5, x->x_nskipped);
+    SETFLOAT(at+6, x->x_nunderrun);
+    outlet_list(x->x_statout, 0, 7, at);
+}
+
+static void *netreceive_tilde_new(t_floatarg fportno, t_floatarg fnchans)
+{
+    t_netreceive_tilde *x =
+        (t_netreceive_tilde *)pd_new(netreceive_tilde_class);
+    int i;
+    x->x_nchans = (fnchans < 1 ? 1 : (fnchans > 256 ? 256 : fnchans));
+    for (i = 0; i < x->x_nchans; i++)
+        outlet_new(&x->x_obj, &s_signal);
+    x->x_statout = outlet_new(&x->x_obj, &s_list);
+    x->x_outvec = (t_sample **)getbytes(x->x_nchans * sizeof(t_sample *));
+    x->x_recvbuf = (unsigned char *)getbytes(NETAUDIO_HEADER +
+        NETAUDIO_MAXPAYLOAD);
+    x->x_buf = (t_float *)getbytes(0);
+    x->x_slotseq = (unsigned int *)getbytes(
+        NETAUDIO_MAXSLOTS * sizeof(unsigned int));
+    x->x_slotready = (double *)getbytes(NETAUDIO_MAXSLOTS * sizeof(double));
+    x->x_lastgood = (t_float *)getbytes(
+        NETAUDIO_MAXFRAMES * x->x_nchans * sizeof(t_float));
+    x->x_tmpbuf = (t_float *)getbytes(
+        NETAUDIO_MAXFRAMES * x->x_nchans * sizeof(t_float));
+    x->x_fade = (t_float *)getbytes(
+        NETAUDIO_XFADE * x->x_nchans * sizeof(t_float));
+    x->x_sr = sys_getsr();
+    x->x_mindelayms = 0;
+    x->x_maxdelayms = 500;
+    x->x_simseed = 1;
+    x->x_sockfd = -1;
+    if (fportno > 0)
+        netreceive_tilde_listen(x, fportno);
+    return (x);
+}
+
+static void netreceive_tilde_free(t_netreceive_tilde *x)
+{
+    netreceive_tilde_close(x);
+    freebytes(x->x_outvec, x->x_nchans * sizeof(t_sample *));
+    freebytes(x->x_recvbuf, NETAUDIO_HEADER + NETAUDIO_MAXPAYLOAD);
+    freebytes(x->x_buf,
+        (size_t)x->x_bufframes * x->x_nchans * sizeof(t_float));
+    freebytes(x->x_slotseq, NETAUDIO_MAXSLOTS * sizeof(unsigned int));
+    freebytes(x->x_slotready, NETAUDIO_MAXSLOTS * sizeof(double));
+    freebytes(x->x_lastgood,
+        NETAUDIO_MAXFRAMES * x->x_nchans * sizeof(t_float));
+    freebytes(x->x_tmpbuf, NETAUDIO_MAXFRAMES * x->x_nchans * sizeof(t_float));
+    freebytes(x->x_fade, NETAUDIO_XFADE * x->x_nchans * sizeof(t_float));
+}
+
+static void netaudio_setup(void)
+{
+    netsend_tilde_class = class_new(gensym("netsend~"),
+        (t_newmethod)netsend_tilde_new, (t_method)netsend_tilde_free,
+        sizeof(t_netsend_tilde), 0, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(netsend_tilde_class, t_netsend_tilde, x_f);
+    class_addmethod(netsend_tilde_class, (t_method)netsend_tilde_dsp,
+        gensym("dsp"), 0);
+    class_addmethod(netsend_tilde_class, (t_method)netsend_tilde_connect,
+        gensym("connect"), A_SYMBOL, A_FLOAT, 0);
+    class_addmethod(netsend_tilde_class, (t_method)netsend_tilde_disconnect,
+        gensym("disconnect"), 0);
+    class_addmethod(netsend_tilde_class, (t_method)netsend_tilde_format,
+        gensym("format"), A_FLOAT, 0);
+    class_addmethod(netsend_tilde_class, (t_method)netsend_tilde_packing,
+        gensym("packing"), A_FLOAT, 0);
+
+    netreceive_tilde_class = class_new(gensym("netreceive~"),
+        (t_newmethod)netreceive_tilde_new, (t_method)netreceive_tilde_free,
+        sizeof(t_netreceive_tilde), 0, A_DEFFLOAT, A_DEFFLOAT, 0);
+    class_addmethod(netreceive_tilde_class, (t_method)netreceive_tilde_dsp,
+        gensym("dsp"), 0);
+    class_addmethod(netreceive_tilde_class, (t_method)netreceive_tilde_listen,
+        gensym("listen"), A_FLOAT, 0);
+    class_addmethod(netreceive_tilde_class, (t_method)netreceive_tilde_delay,
+        gensym("delay"), A_FLOAT, A_FLOAT, 0);
+    class_addmethod(netreceive_tilde_class,
+        (t_method)netreceive_tilde_simulate, gensym("simulate"),
+        A_FLOAT, A_FLOAT, A_DEFFLOAT, 0);
+    class_addbang(netreceive_tilde_class, netreceive_tilde_bang);
+    class_sethelpsymbol(netreceive_tilde_class, gensym("netsend~"));
+}
+
 void x_net_setup(void)
 {
     netsend_setup();
     netreceive_setup();
+    netaudio_setup();
 }
 
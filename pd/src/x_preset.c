@@ -534,17 +534,17 @@ static void preset_node_anything(t_preset_node *x, t_symbol *s, int argc, t_atom
     alist_list(&x->pn_val, 0, argc, argv);
     if (PH_DEBUG)
     {
-        if (x->pn_val.l_vec->l_a.a_type == A_SYMBOL)
+        if (x->pn_val.l_vec->a_type == A_SYMBOL)
             fprintf(stderr,"    %zx data is %s\n",
-                (t_int)x, x->pn_val.l_vec->l_a.a_w.w_symbol->s_name);
-        else if (x->pn_val.l_vec->l_a.a_type == A_FLOAT)
+                (t_int)x, x->pn_val.l_vec->a_w.w_symbol->s_name);
+        else if (x->pn_val.l_vec->a_type == A_FLOAT)
             fprintf(stderr,"    %zx data is %f\n",
-                (t_int)x, x->pn_val.l_vec->l_a.a_w.w_float);
+                (t_int)x, x->pn_val.l_vec->a_w.w_float);
     }
     // check for pointers and warn user presetting them has not been tested
     for (i = 0; i < x->pn_val.l_n; i++)
     {
-        if (x->pn_val.l_vec[i].l_a.a_type == A_POINTER)
+        if (x->pn_val.l_vec[i].a_type == A_POINTER)
         {
             pd_error(x, "preset_node preset received a pointer as part "
                         "of a list--this has not been tested, use at your "
@@ -1001,12 +1001,12 @@ void preset_hub_save(t_gobj *z, t_binbuf *b)
 	                        (int)np->np_preset);
 	                    for (i = 0; i < np->np_val.l_n; i++)
 	                    {
-	                        if (np->np_val.l_vec[i].l_a.a_type == A_FLOAT)
+	                        if (np->np_val.l_vec[i].a_type == A_FLOAT)
 	                            binbuf_addv(b, "f",
-	                                np->np_val.l_vec[i].l_a.a_w.w_float);
-	                        else if (np->np_val.l_vec[i].l_a.a_type == A_SYMBOL)
+	                                np->np_val.l_vec[i].a_w.w_float);
+	                        else if (np->np_val.l_vec[i].a_type == A_SYMBOL)
 	                            binbuf_addv(b, "s",
-	                                np->np_val.l_vec[i].l_a.a_w.w_symbol);    
+	                                np->np_val.l_vec[i].a_w.w_symbol);    
 	                    }
 	                }
 	                np = np->np_next;
@@ -1183,19 +1183,19 @@ void preset_hub_store(t_preset_hub *h, t_float f)
                             fprintf(stderr,"    node data len = %d, "
                                            "old hub data len = %d\n",
                                 hd1->phd_node->pn_val.l_n, np2->np_val.l_n);
-                            if (hd1->phd_node->pn_val.l_vec->l_a.a_type ==
+                            if (hd1->phd_node->pn_val.l_vec->a_type ==
                                 A_SYMBOL)
                             {
                                 fprintf(stderr,"    %zx outputs %s\n",
                                     (t_int)hd1->phd_node,
-                                    hd1->phd_node->pn_val.l_vec->l_a.a_w.w_symbol->s_name);
+                                    hd1->phd_node->pn_val.l_vec->a_w.w_symbol->s_name);
                             }
-                            else if (hd1->phd_node->pn_val.l_vec->l_a.a_type ==
+                            else if (hd1->phd_node->pn_val.l_vec->a_type ==
                                      A_FLOAT)
                             {
                                 fprintf(stderr,"    %zx outputs %f\n",
                                 (t_int)hd1->phd_node,
-                                hd1->phd_node->pn_val.l_vec->l_a.a_w.w_float);
+                                hd1->phd_node->pn_val.l_vec->a_w.w_float);
                             }
                         }
                         alist_clear(&np2->np_val);
@@ -1206,19 +1206,19 @@ void preset_hub_store(t_preset_hub *h, t_float f)
                             fprintf(stderr,"    node data len = %d, "
                                            "NEW hub data len = %d\n",
                                 hd1->phd_node->pn_val.l_n, np2->np_val.l_n);
-                            if (hd1->phd_node->pn_val.l_vec->l_a.a_type ==
+                            if (hd1->phd_node->pn_val.l_vec->a_type ==
                                 A_SYMBOL)
                             {
                                 fprintf(stderr,"    %zx outputs %s\n",
                                     (t_int)hd1->phd_node,
-                                    np2->np_val.l_vec->l_a.a_w.w_symbol->s_name);
+                                    np2->np_val.l_vec->a_w.w_symbol->s_name);
                             }
-                            else if (hd1->phd_node->pn_val.l_vec->l_a.a_type ==
+                            else if (hd1->phd_node->pn_val.l_vec->a_type ==
                                      A_FLOAT)
                             {
                                 fprintf(stderr,"    %zx outputs %f\n",
                                     (t_int)hd1->phd_node,
-                                    np2->np_val.l_vec->l_a.a_w.w_float);
+                                    np2->np_val.l_vec->a_w.w_float);
                             }
                         }
                         /* finally if this is the first preset,
@@ -1985,12 +1985,12 @@ void preset_hub_write(t_preset_hub *x, t_symbol *filename)
                         (int)np->np_preset);
                     for (i = 0; i < np->np_val.l_n; i++)
                     {
-                        if (np->np_val.l_vec[i].l_a.a_type == A_FLOAT)
+                        if (np->np_val.l_vec[i].a_type == A_FLOAT)
                             binbuf_addv(b, "f",
-                                np->np_val.l_vec[i].l_a.a_w.w_float);
-                        else if (np->np_val.l_vec[i].l_a.a_type == A_SYMBOL)
+                                np->np_val.l_vec[i].a_w.w_float);
+                        else if (np->np_val.l_vec[i].a_type == A_SYMBOL)
                             binbuf_addv(b, "s",
-                                np->np_val.l_vec[i].l_a.a_w.w_symbol);    
+                                np->np_val.l_vec[i].a_w.w_symbol);    
                     }
                 }
                 np = np->np_next;
@@ -2379,12 +2379,12 @@ void preset_hub_writepreset(t_preset_hub *x, t_symbol *filename, float preset)
                     binbuf_addv(b, "si", gensym("%preset%"), (int)np->np_preset);
                     for (i = 0; i < np->np_val.l_n; i++)
                     {
-                        if (np->np_val.l_vec[i].l_a.a_type == A_FLOAT)
+                        if (np->np_val.l_vec[i].a_type == A_FLOAT)
                             binbuf_addv(b, "f",
-                                np->np_val.l_vec[i].l_a.a_w.w_float);
-                        else if (np->np_val.l_vec[i].l_a.a_type == A_SYMBOL)
+                                np->np_val.l_vec[i].a_w.w_float);
+                        else if (np->np_val.l_vec[i].a_type == A_SYMBOL)
                             binbuf_addv(b, "s",
-                                np->np_val.l_vec[i].l_a.a_w.w_symbol);    
+                                np->np_val.l_vec[i].a_w.w_symbol);    
                     }
                 }
                 np = np->np_next;
@@ -247,28 +247,6 @@ static void textbuf_free(t_textbuf *x)
         pd_unbind(x2, gensym("#A"));
 }
 
-    /* random helper function */
-static int text_nthline(int n, t_atom *vec, int line, int *startp, int *endp)
-{
-    int i, cnt = 0;
-    for (i = 0; i < n; i++)
-    {
-        if (cnt == line)
-        {
-            int j = i;
-            while (j < n && vec[j].a_type != A_SEMI &&
-                vec[j].a_type != A_COMMA)
-                    j++;
-            *startp = i;
-            *endp = j;
-            return (1);
-        }
-        else if (vec[i].a_type == A_SEMI || vec[i].a_type == A_COMMA)
-            cnt++;
-    }
-    return (0);
-}
-
 /* text_define object - text buffer, accessible by other accessor objects */
 
 typedef struct _text_define
@@ -858,7 +836,7 @@ static void text_get_float(t_text_get *x, t_floatarg f)
     n = binbuf_getnatom(b);
     startfield = x->x_f1;
     nfield = x->x_f2;
-    if (text_nthline(n, vec, f, &start, &end))
+    if (binbuf_getline(b, f, &start, &end))
     {
         int outc = end - start, k;
         t_atom *outv;
@@ -947,6 +925,7 @@ static void text_set_list(t_text_set *x,
 {
     t_binbuf *b = text_client_getbuf(&x->x_tc);
     int start, end, n, lineno = x->x_f1, fieldno = x->x_f2, i;
+    int appended = 0, delimiters = 0;
     t_atom *vec;
     if (!b)
        return;
@@ -957,7 +936,7 @@ static void text_set_list(t_text_set *x,
         pd_error(x, "text set: line number (%d) < 0", lineno);
         return;
     }
-    if (text_nthline(n, vec, lineno, &start, &end))
+    if (binbuf_getline(b, lineno, &start, &end))
     {
         if (fieldno < 0)
         {
@@ -992,14 +971,14 @@ static void text_set_list(t_text_set *x,
     }
     else if (fieldno < 0)  /* if line number too high just append to end */
     {
-        int addsemi = (n && vec[n-1].a_type != A_SEMI &&
-            vec[n-1].a_type != A_COMMA), newsize = n + addsemi + argc + 1;
-        (void)binbuf_resize(b, newsize);
+            /* (binbuf_add() keeps the line index as it goes) */
+        if (n && vec[n-1].a_type != A_SEMI && vec[n-1].a_type != A_COMMA)
+            binbuf_addsemi(b);
+        start = binbuf_getnatom(b);
+        binbuf_add(b, argc, argv);
+        binbuf_addsemi(b);
         vec = binbuf_getvec(b);
-        if (addsemi)
-            SETSEMI(&vec[n]);
-        SETSEMI(&vec[newsize-1]);
-        start = n+addsemi;
+        appended = 1;
     }
     else
     {
@@ -1011,7 +990,11 @@ static void text_set_list(t_text_set *x,
         if (argv[i].a_type == A_POINTER)
             SETSYMBOL(&vec[start+i], gensym("(pointer)"));
         else vec[start+i] = argv[i];
+        if (argv[i].a_type == A_SEMI || argv[i].a_type == A_COMMA)
+            delimiters = 1;
     }
+    if (!appended)
+        binbuf_changed(b, delimiters);
     text_client_senditup(&x->x_tc);
 }
 
@@ -1068,12 +1051,19 @@ static void text_insert_list(t_text_insert *x,
         return;
     }
     nwas = binbuf_getnatom(b);
-    if (!text_nthline(nwas, binbuf_getvec(b), lineno, &start, &end))
-        start = nwas;
-    (void)binbuf_resize(b, (n = nwas + argc + 1));
-    vec = binbuf_getvec(b);
-    if (start < n)
+    if (binbuf_getline(b, lineno, &start, &end))
+    {
+        (void)binbuf_resize(b, (n = nwas + argc + 1));
+        vec = binbuf_getvec(b);
         memmove(&vec[start+(argc+1)], &vec[start], sizeof(*vec) * (nwas-start));
+    }
+    else    /* append; binbuf_add() keeps the line index as it goes */
+    {
+        start = nwas;
+        binbuf_add(b, argc, argv);
+        binbuf_addsemi(b);
+        vec = binbuf_getvec(b);
+    }
     for (i = 0; i < argc; i++)
     {
         if (argv[i].a_type == A_POINTER)
@@ -1118,7 +1108,7 @@ static void text_delete_float(t_text_delete *x, t_floatarg f)
     n = binbuf_getnatom(b);
     if (lineno < 0)
         binbuf_clear(b);
-    else if (text_nthline(n, vec, lineno, &start, &end))
+    else if (binbuf_getline(b, lineno, &start, &end))
     {
         if (end < n)
             end++;
@@ -1180,13 +1170,10 @@ static void text_size_bang(t_text_size *x)
 static void text_size_float(t_text_size *x, t_floatarg f)
 {
     t_binbuf *b = text_client_getbuf(&x->x_tc);
-    int start, end, n;
-    t_atom *vec;
+    int start, end;
     if (!b)
        return;
-    vec = binbuf_getvec(b);
-    n = binbuf_getnatom(b);
-    if (text_nthline(n, vec, f, &start, &end))
+    if (binbuf_getline(b, f, &start, &end))
         outlet_float(x->x_out1, end-start);
     else outlet_float(x->x_out1, -1);
 }
@@ -1272,12 +1259,51 @@ typedef struct _key
     int k_binop;
 } t_key;
 
+    /* with the "-index" flag, text search keeps an index of the lines so
+    that it needn't compare the search key against all of them.  If the
+    first key is "=" the lines are hashed on the leading "=" keys; otherwise
+    the values of the first key's field are kept sorted.  The index is kept
+    up to date with lines appended to the text, and made again after any
+    other change (which we learn of from binbuf_getserial()).  Only lines
+    the index turns up are compared, in the same way as for a full search,
+    so the result is the same. */
+
+typedef struct _searchline
+{
+    int l_line;             /* line number */
+    int l_start;            /* onset of the line in the binbuf */
+    int l_n;                /* number of fields */
+    int l_next;             /* next line in the same hash bucket or -1 */
+} t_searchline;
+
+typedef struct _searchsort
+{
+    t_float s_value;        /* value of the first key's field */
+    int s_line;             /* index into the lines */
+} t_searchsort;
+
 typedef struct _text_search
 {
     t_text_client x_tc;
     t_outlet *x_out1;       /* line indices */
     int x_nkeys;
     t_key *x_keyvec;
+    int x_index;            /* whether to keep an index */
+    int x_nhash;            /* number of leading "=" keys; 0 if sorting */
+    t_binbuf *x_ibuf;       /* binbuf the index is of ... */
+    int x_iserial;          /* ... and binbuf_getserial() for it */
+    int x_inatom;           /* atoms indexed (complete lines only) */
+    int x_inline;           /* number of lines indexed */
+    int x_inan;             /* a NaN was found so we can't sort */
+    t_searchline *x_lines;  /* lines in the index */
+    int x_nlines;
+    int x_linesize;
+    int *x_hashhead;        /* first and last line in each bucket */
+    int *x_hashtail;
+    int x_hashsize;
+    t_searchsort *x_sort;   /* lines sorted by value, then unsorted ones */
+    int x_nsorted;
+    int x_sortsize;
 } t_text_search;
 
 static void *text_search_new(t_symbol *s, int argc, t_atom *argv)
@@ -1285,6 +1311,9 @@ static void *text_search_new(t_symbol *s, int argc, t_atom *argv)
     t_text_search *x = (t_text_search *)pd_new(text_search_class);
     int i, key, nkey, nextop;
     x->x_out1 = outlet_new(&x->x_obj, &s_list);
+    while (argc && argv->a_type == A_SYMBOL &&
+        !strcmp(argv->a_w.w_symbol->s_name, "-index"))
+            x->x_index = 1, argc--, argv++;
     text_client_argparse(&x->x_tc, &argc, &argv, "text search");
     for (i = nkey = 0; i < argc; i++)
         if (argv[i].a_type == A_FLOAT)
@@ -1325,12 +1354,479 @@ static void *text_search_new(t_symbol *s, int argc, t_atom *argv)
                     "text search: unknown operation argument: %s", s);
         }
     }
+    for (x->x_nhash = 0; x->x_nhash < x->x_nkeys &&
+        x->x_keyvec[x->x_nhash].k_binop == KB_EQ; x->x_nhash++)
+            ;
     if (x->x_struct)
         pointerinlet_new(&x->x_obj, &x->x_gp);
     else symbolinlet_new(&x->x_obj, &x->x_tc.tc_sym);
     return (x);
 }
 
+    /* does the line starting at "start" match?  "failed" is set once we've
+    complained about the search key */
+static int text_search_match(t_text_search *x, t_atom *vec, int start,
+    int thisn, int argc, t_atom *argv, int *failed)
+{
+    int j, field = x->x_keyvec[0].k_field, binop = x->x_keyvec[0].k_binop,
+        nkeys = x->x_nkeys;
+    for (j = 0; j < argc; )
+    {
+        if (field >= thisn ||
+            vec[start+field].a_type != argv[j].a_type)
+                return (0);
+        if (argv[j].a_type == A_FLOAT)      /* arg is a float */
+        {
+            switch (binop)
+            {
+                case KB_EQ:
+                    if (vec[start+field].a_w.w_float !=
+                        argv[j].a_w.w_float)
+                            return (0);
+                break;
+                case KB_GT:
+                    if (vec[start+field].a_w.w_float <=
+                        argv[j].a_w.w_float)
+                            return (0);
+                break;
+                case KB_GE:
+                    if (vec[start+field].a_w.w_float <
+                        argv[j].a_w.w_float)
+                            return (0);
+                break;
+                case KB_LT:
+                    if (vec[start+field].a_w.w_float >=
+                        argv[j].a_w.w_float)
+                            return (0);
+                break;
+                case KB_LE:
+                    if (vec[start+field].a_w.w_float >
+                        argv[j].a_w.w_float)
+                            return (0);
+                break;
+                    /* the other possibility ('near') never fails */
+            }
+        }
+        else                                /* arg is a symbol */
+        {
+            if (binop != KB_EQ)
+            {
+                if (!*failed)
+                {
+                    pd_error(x,
+            "text search (%s): only exact matches allowed for symbols",
+                        argv[j].a_w.w_symbol->s_name);
+                    *failed = 1;
+                }
+                return (0);
+            }
+            if (vec[start+field].a_w.w_symbol !=
+                argv[j].a_w.w_symbol)
+                    return (0);
+        }
+        if (++j >= nkeys)    /* if at last key just increment field */
+            field++;
+        else field = x->x_keyvec[j].k_field,    /* else next key */
+                binop = x->x_keyvec[j].k_binop;
+    }
+    return (1);
+}
+
+    /* given that a line matches, is it better than the best one so far? */
+static int text_search_better(t_text_search *x, t_atom *vec, int start,
+    int thisn, int beststart, int argc, t_atom *argv)
+{
+    int j, field = x->x_keyvec[0].k_field, binop = x->x_keyvec[0].k_binop,
+        nkeys = x->x_nkeys;
+    for (j = 0; j < argc; )
+    {
+        if (field >= thisn
+            || vec[start+field].a_type != argv[j].a_type)
+                bug("text search 2");
+        if (argv[j].a_type == A_FLOAT)      /* arg is a float */
+        {
+            float thisv = vec[start+field].a_w.w_float,
+                bestv = (beststart >= 0 ?
+                    vec[beststart+field].a_w.w_float : -1e20);
+            switch (binop)
+            {
+                case KB_GT:
+                case KB_GE:
+                    if (thisv < bestv)
+                        return (1);
+                    else if (thisv > bestv)
+                        return (0);
+                break;
+                case KB_LT:
+                case KB_LE:
+                    if (thisv > bestv)
+                        return (1);
+                    else if (thisv < bestv)
+                        return (0);
+                break;
+                case KB_NEAR:
+                    if (thisv >= argv[j].a_w.w_float &&
+                        bestv >= argv[j].a_w.w_float)
+                    {
+                        if (thisv < bestv)
+                            return (1);
+                        else if (thisv > bestv)
+                            return (0);
+                    }
+                    else if (thisv <= argv[j].a_w.w_float &&
+                        bestv <= argv[j].a_w.w_float)
+                    {
+                        if (thisv > bestv)
+                            return (1);
+                        else if (thisv < bestv)
+                            return (0);
+                    }
+                    else
+                    {
+                        float d1 = thisv - argv[j].a_w.w_float,
+                            d2 = bestv - argv[j].a_w.w_float;
+                        if (d1 < 0)
+                            d1 = -d1;
+                        if (d2 < 0)
+                            d2 = -d2;
+
+                        if (d1 < d2)
+                            return (1);
+                        else if (d1 > d2)
+                            return (0);
+                    }
+                break;
+                    /* the other possibility ('=') never decides */
+            }
+        }
+        if (++j >= nkeys)    /* last key - increment field */
+            field++;
+        else field = x->x_keyvec[j].k_field,    /* else next key */
+                binop = x->x_keyvec[j].k_binop;
+    }
+    return (0);     /* a tie - keep the old one */
+}
+
+    /* try a line, lines being tried in order */
+static void text_search_try(t_text_search *x, t_atom *vec, int line,
+    int start, int thisn, int argc, t_atom *argv, int *bestlinep,
+    int *beststartp, int *failed)
+{
+    if (text_search_match(x, vec, start, thisn, argc, argv, failed) &&
+        (*bestlinep < 0 ||
+            text_search_better(x, vec, start, thisn, *beststartp, argc, argv)))
+                *bestlinep = line, *beststartp = start;
+}
+
+static unsigned int text_search_hash(t_text_search *x, t_atom *vec,
+    int start, t_atom *argv)
+{
+    unsigned int h = 2166136261u, i, k;
+    for (k = 0; k < (unsigned int)x->x_nhash; k++)
+    {
+        t_atom *a = (vec ? &vec[start + x->x_keyvec[k].k_field] : &argv[k]);
+        h = (h ^ a->a_type) * 16777619u;
+        if (a->a_type == A_FLOAT)
+        {
+            t_float f = (a->a_w.w_float == 0 ? 0 : a->a_w.w_float);
+            unsigned char *cp = (unsigned char *)&f;
+            for (i = 0; i < sizeof(f); i++)
+                h = (h ^ cp[i]) * 16777619u;
+        }
+        else if (a->a_type == A_SYMBOL)
+        {
+            size_t p = (size_t)a->a_w.w_symbol;
+            for (i = 0; i < sizeof(p); i++, p >>= 8)
+                h = (h ^ (p & 0xff)) * 16777619u;
+        }
+    }
+    return (h);
+}
+
+static void text_search_hashline(t_text_search *x, int i)
+{
+    int bucket = text_search_hash(x, binbuf_getvec(x->x_ibuf),
+        x->x_lines[i].l_start, 0) & (x->x_hashsize - 1);
+    x->x_lines[i].l_next = -1;
+    if (x->x_hashhead[bucket] < 0)
+        x->x_hashhead[bucket] = i;
+    else x->x_lines[x->x_hashtail[bucket]].l_next = i;
+    x->x_hashtail[bucket] = i;
+}
+
+static void text_search_unindex(t_text_search *x)
+{
+    if (x->x_lines)
+        freebytes(x->x_lines, x->x_linesize * sizeof(*x->x_lines));
+    if (x->x_hashhead)
+    {
+        freebytes(x->x_hashhead, x->x_hashsize * sizeof(*x->x_hashhead));
+        freebytes(x->x_hashtail, x->x_hashsize * sizeof(*x->x_hashtail));
+    }
+    if (x->x_sort)
+        freebytes(x->x_sort, x->x_sortsize * sizeof(*x->x_sort));
+    x->x_lines = 0;
+    x->x_hashhead = x->x_hashtail = 0;
+    x->x_sort = 0;
+    x->x_nlines = x->x_linesize = x->x_hashsize = 0;
+    x->x_nsorted = x->x_sortsize = 0;
+    x->x_inatom = x->x_inline = x->x_inan = 0;
+    x->x_ibuf = 0;
+}
+
+    /* add a line to the index, if it could match */
+static void text_search_addline(t_text_search *x, t_atom *vec, int line,
+    int start, int thisn)
+{
+    int i, field = x->x_keyvec[0].k_field;
+    t_searchline *l;
+    if (x->x_nhash)
+    {
+        for (i = 0; i < x->x_nhash; i++)
+            if (x->x_keyvec[i].k_field >= thisn)
+                return;
+    }
+    else if (field >= thisn || vec[start+field].a_type != A_FLOAT)
+        return;
+    if (x->x_nlines == x->x_linesize)
+    {
+        int newsize = (x->x_linesize ? 2 * x->x_linesize : 64);
+        x->x_lines = (t_searchline *)resizebytes(x->x_lines,
+            x->x_linesize * sizeof(*x->x_lines), newsize * sizeof(*x->x_lines));
+        x->x_linesize = newsize;
+    }
+    l = &x->x_lines[x->x_nlines];
+    l->l_line = line;
+    l->l_start = start;
+    l->l_n = thisn;
+    if (x->x_nhash)
+    {
+        if (x->x_nlines >= x->x_hashsize)   /* grow and rehash */
+        {
+            int newsize = (x->x_hashsize ? 4 * x->x_hashsize : 256);
+            if (x->x_hashhead)
+            {
+                freebytes(x->x_hashhead,
+                    x->x_hashsize * sizeof(*x->x_hashhead));
+                freebytes(x->x_hashtail,
+                    x->x_hashsize * sizeof(*x->x_hashtail));
+            }
+            x->x_hashsize = newsize;
+            x->x_hashhead = (int *)getbytes(newsize * sizeof(int));
+            x->x_hashtail = (int *)getbytes(newsize * sizeof(int));
+            for (i = 0; i < newsize; i++)
+                x->x_hashhead[i] = -1;
+            for (i = 0; i < x->x_nlines; i++)
+                text_search_hashline(x, i);
+        }
+        text_search_hashline(x, x->x_nlines);
+    }
+    else
+    {
+        t_float f = vec[start+field].a_w.w_float;
+        if (f != f)
+            x->x_inan = 1;
+        if (x->x_nlines == x->x_sortsize)
+        {
+            x->x_sort = (t_searchsort *)resizebytes(x->x_sort,
+                x->x_sortsize * sizeof(*x->x_sort),
+                    x->x_linesize * sizeof(*x->x_sort));
+            x->x_sortsize = x->x_linesize;
+        }
+        x->x_sort[x->x_nlines].s_value = f;
+        x->x_sort[x->x_nlines].s_line = x->x_nlines;
+    }
+    x->x_nlines++;
+}
+
+    /* bring the index up to date with the binbuf */
+static void text_search_reindex(t_text_search *x, t_binbuf *b)
+{
+    t_atom *vec = binbuf_getvec(b);
+    int n = binbuf_getnatom(b), i, thisstart;
+    if (b != x->x_ibuf || binbuf_getserial(b) != x->x_iserial ||
+        n < x->x_inatom)
+    {
+        text_search_unindex(x);
+        x->x_ibuf = b;
+        x->x_iserial = binbuf_getserial(b);
+    }
+    for (i = thisstart = x->x_inatom; i < n; i++)
+        if (vec[i].a_type == A_SEMI || vec[i].a_type == A_COMMA)
+    {
+        text_search_addline(x, vec, x->x_inline++, thisstart, i - thisstart);
+        x->x_inatom = thisstart = i+1;
+    }
+}
+
+static int text_search_sortcompare(const void *z1, const void *z2)
+{
+    const t_searchsort *s1 = (const t_searchsort *)z1,
+        *s2 = (const t_searchsort *)z2;
+    if (s1->s_value < s2->s_value)
+        return (-1);
+    else if (s1->s_value > s2->s_value)
+        return (1);
+    else return (s1->s_line - s2->s_line);
+}
+
+    /* sort lines added since the last search and merge them in */
+static void text_search_sort(t_text_search *x)
+{
+    int nold = x->x_nsorted, nnew = x->x_nlines - nold, i, j, k;
+    t_searchsort *merged;
+    if (!nnew)
+        return;
+    qsort(x->x_sort + nold, nnew, sizeof(*x->x_sort),
+        text_search_sortcompare);
+    if (nold && text_search_sortcompare(&x->x_sort[nold-1],
+        &x->x_sort[nold]) > 0)
+    {
+        merged = (t_searchsort *)getbytes(x->x_nlines * sizeof(*merged));
+        for (i = 0, j = nold, k = 0; k < x->x_nlines; k++)
+            merged[k] = (j >= x->x_nlines || (i < nold &&
+                text_search_sortcompare(&x->x_sort[i], &x->x_sort[j]) < 0) ?
+                    x->x_sort[i++] : x->x_sort[j++]);
+        memcpy(x->x_sort, merged, x->x_nlines * sizeof(*merged));
+        freebytes(merged, x->x_nlines * sizeof(*merged));
+    }
+    x->x_nsorted = x->x_nlines;
+}
+
+    /* try the lines from x_sort[from] to x_sort[to] (inclusive) */
+static void text_search_trysorted(t_text_search *x, t_atom *vec, int from,
+    int to, int argc, t_atom *argv, int *bestlinep, int *beststartp,
+    int *failed)
+{
+    for (; from <= to; from++)
+    {
+        t_searchline *l = &x->x_lines[x->x_sort[from].s_line];
+        text_search_try(x, vec, l->l_line, l->l_start, l->l_n,
+            argc, argv, bestlinep, beststartp, failed);
+    }
+}
+
+    /* find the lines with the best value for the first key (those with
+    any other value can't win) and try those */
+static void text_search_bysort(t_text_search *x, t_atom *vec, int argc,
+    t_atom *argv, int *bestlinep, int *beststartp, int *failed)
+{
+    t_float v = argv[0].a_w.w_float;
+    int binop = x->x_keyvec[0].k_binop, n = x->x_nlines, lo, hi, mid,
+        up = -1, down = -1, upend = -1, downstart = -1, dummy = 0;
+    t_searchsort *s = x->x_sort;
+    text_search_sort(x);
+        /* lo is the first line with a value >= v (or > v for ">") */
+    for (lo = 0, hi = n; lo < hi; )
+    {
+        mid = (lo + hi) / 2;
+        if (s[mid].s_value < v || (binop == KB_GT && s[mid].s_value == v))
+            lo = mid + 1;
+        else hi = mid;
+    }
+        /* walk up and/or down to the first line that matches */
+    if (binop == KB_GT || binop == KB_GE || binop == KB_NEAR)
+        for (up = lo; up < n; up++)
+            if (text_search_match(x, vec,
+                x->x_lines[s[up].s_line].l_start,
+                x->x_lines[s[up].s_line].l_n, argc, argv, &dummy))
+                    break;
+    if (binop == KB_LT || binop == KB_LE || binop == KB_NEAR)
+    {
+            /* for "<=" start from the last line equal to v */
+        if (binop == KB_LE)
+            while (lo < n && s[lo].s_value == v)
+                lo++;
+        for (down = lo - 1; down >= 0; down--)
+            if (text_search_match(x, vec,
+                x->x_lines[s[down].s_line].l_start,
+                x->x_lines[s[down].s_line].l_n, argc, argv, &dummy))
+                    break;
+    }
+    if (up >= n)
+        up = -1;
+    if (binop == KB_NEAR && up >= 0 && down >= 0)
+    {
+        float d1 = s[up].s_value - v, d2 = s[down].s_value - v;
+        if (d1 < 0)
+            d1 = -d1;
+        if (d2 < 0)
+            d2 = -d2;
+        if (d1 < d2)
+            down = -1;
+        else if (d2 < d1)
+            up = -1;
+    }
+    if (up >= 0)
+        for (upend = up; upend + 1 < n &&
+            s[upend + 1].s_value == s[up].s_value; upend++)
+                ;
+    if (down >= 0)
+        for (downstart = down; downstart > 0 &&
+            s[downstart - 1].s_value == s[down].s_value; downstart--)
+                ;
+        /* try them in order of line number */
+    if (up >= 0 && down >= 0)
+    {
+        int i = downstart, j = up;
+        while (i <= down || j <= upend)
+        {
+            if (j > upend || (i <= down && s[i].s_line < s[j].s_line))
+                text_search_trysorted(x, vec, i, i, argc, argv,
+                    bestlinep, beststartp, failed), i++;
+            else text_search_trysorted(x, vec, j, j, argc, argv,
+                    bestlinep, beststartp, failed), j++;
+        }
+    }
+    else if (up >= 0)
+        text_search_trysorted(x, vec, up, upend, argc, argv,
+            bestlinep, beststartp, failed);
+    else if (down >= 0)
+        text_search_trysorted(x, vec, downstart, down, argc, argv,
+            bestlinep, beststartp, failed);
+}
+
+    /* search using the index; returns 0 if it can't be used */
+static int text_search_indexed(t_text_search *x, t_binbuf *b,
+    int argc, t_atom *argv, int *bestlinep, int *failed)
+{
+    t_atom *vec = binbuf_getvec(b);
+    int n = binbuf_getnatom(b), i, j, lineno, thisstart, beststart = -1;
+        /* leave the odd cases to the full search */
+    if (argc < (x->x_nhash ? x->x_nhash : 1))
+        return (0);
+    for (j = 0; j < argc; j++)
+        if (argv[j].a_type != A_FLOAT &&
+            x->x_keyvec[j < x->x_nkeys ? j : x->x_nkeys-1].k_binop != KB_EQ)
+                return (0);
+    if (!x->x_nhash && (argv[0].a_type != A_FLOAT ||
+        argv[0].a_w.w_float != argv[0].a_w.w_float))
+            return (0);
+    text_search_reindex(x, b);
+    if (!x->x_nhash && x->x_inan)
+        return (0);
+    *bestlinep = -1;
+    if (x->x_nhash && x->x_hashsize)
+    {
+        for (i = x->x_hashhead[text_search_hash(x, 0, 0, argv) &
+            (x->x_hashsize - 1)]; i >= 0; i = x->x_lines[i].l_next)
+                text_search_try(x, vec, x->x_lines[i].l_line,
+                    x->x_lines[i].l_start, x->x_lines[i].l_n, argc, argv,
+                        bestlinep, &beststart, failed);
+    }
+    else if (!x->x_nhash)
+        text_search_bysort(x, vec, argc, argv, bestlinep, &beststart, failed);
+        /* then whatever follows the last semicolon or comma */
+    for (i = thisstart = x->x_inatom, lineno = x->x_inline; i < n; i++)
+        if (vec[i].a_type == A_SEMI || vec[i].a_type == A_COMMA || i == n-1)
+    {
+        text_search_try(x, vec, lineno++, thisstart, i - thisstart,
+            argc, argv, bestlinep, &beststart, failed);
+        thisstart = i+1;
+    }
+    return (1);
+}
+
 static void text_search_list(t_text_search *x,
     t_symbol *s, int argc, t_atom *argv)
 {
@@ -1349,151 +1845,18 @@ static void text_search_list(t_text_search *x,
     n = binbuf_getnatom(b);
     if (nkeys < 1)
         bug("text_search");
+    if (x->x_index && text_search_indexed(x, b, argc, argv, &bestline,
+        &failed))
+    {
+        outlet_float(x->x_out1, bestline);
+        return;
+    }
     for (i = lineno = thisstart = 0; i < n; i++)
     {
         if (vec[i].a_type == A_SEMI || vec[i].a_type == A_COMMA || i == n-1)
         {
-            int thisn = i - thisstart, j, field = x->x_keyvec[0].k_field,
-                binop = x->x_keyvec[0].k_binop;
-                /* do we match? */
-            for (j = 0; j < argc; )
-            {
-                if (field >= thisn ||
-                    vec[thisstart+field].a_type != argv[j].a_type)
-                        goto nomatch;
-                if (argv[j].a_type == A_FLOAT)      /* arg is a float */
-                {
-                    switch (binop)
-                    {
-                        case KB_EQ:
-                            if (vec[thisstart+field].a_w.w_float !=
-                                argv[j].a_w.w_float)
-                                    goto nomatch;
-                        break;
-                        case KB_GT:
-                            if (vec[thisstart+field].a_w.w_float <=
-                                argv[j].a_w.w_float)
-                                    goto nomatch;
-                        break;
-                        case KB_GE:
-                            if (vec[thisstart+field].a_w.w_float <
-                                argv[j].a_w.w_float)
-                                    goto nomatch;
-                        break;
-                        case KB_LT:
-                            if (vec[thisstart+field].a_w.w_float >=
-                                argv[j].a_w.w_float)
-                                    goto nomatch;
-                        break;
-                        case KB_LE:
-                            if (vec[thisstart+field].a_w.w_float >
-                                argv[j].a_w.w_float)
-                                    goto nomatch;
-                        break;
-                            /* the other possibility ('near') never fails */
-                    }
-                }
-                else                                /* arg is a symbol */
-                {
-                    if (binop != KB_EQ)
-                    {
-                        if (!failed)
-                        {
-                            pd_error(x,
-                    "text search (%s): only exact matches allowed for symbols",
-                                argv[j].a_w.w_symbol->s_name);
-                            failed = 1;
-                        }
-                        goto nomatch;
-                    }
-                    if (vec[thisstart+field].a_w.w_symbol !=
-                        argv[j].a_w.w_symbol)
-                            goto nomatch;
-                }
-                if (++j >= nkeys)    /* if at last key just increment field */
-                    field++;
-                else field = x->x_keyvec[j].k_field,    /* else next key */
-                        binop = x->x_keyvec[j].k_binop;
-            }
-                /* the line matches.  Now, if there is a previous match, are
-                we better than it? */
-            if (bestline >= 0)
-            {
-                field = x->x_keyvec[0].k_field;
-                binop = x->x_keyvec[0].k_binop;
-                for (j = 0; j < argc; )
-                {
-                    if (field >= thisn
-                        || vec[thisstart+field].a_type != argv[j].a_type)
-                            bug("text search 2");
-                    if (argv[j].a_type == A_FLOAT)      /* arg is a float */
-                    {
-                        float thisv = vec[thisstart+field].a_w.w_float,
-                            bestv = (beststart >= 0 ?
-                                vec[beststart+field].a_w.w_float : -1e20);
-                        switch (binop)
-                        {
-                            case KB_GT:
-                            case KB_GE:
-                                if (thisv < bestv)
-                                    goto replace;
-                                else if (thisv > bestv)
-                                    goto nomatch;
-                            break;
-                            case KB_LT:
-                            case KB_LE:
-                                if (thisv > bestv)
-                                    goto replace;
-                                else if (thisv < bestv)
-                                    goto nomatch;
-                            break;
-                            case KB_NEAR:
-                                if (thisv >= argv[j].a_w.w_float &&
-                                    bestv >= argv[j].a_w.w_float)
-                                {
-                                    if (thisv < bestv)
-                                        goto replace;
-                                    else if (thisv > bestv)
-                                        goto nomatch;
-                                }
-                                else if (thisv <= argv[j].a_w.w_float &&
-                                    bestv <= argv[j].a_w.w_float)
-                                {
-                                    if (thisv > bestv)
-                                        goto replace;
-                                    else if (thisv < bestv)
-                                        goto nomatch;
-                                }
-                                else
-                                {
-                                    float d1 = thisv - argv[j].a_w.w_float,
-                                        d2 = bestv - argv[j].a_w.w_float;
-                                    if (d1 < 0)
-                                        d1 = -d1;
-                                    if (d2 < 0)
-                                        d2 = -d2;
-
-                                    if (d1 < d2)
-                                        goto replace;
-                                    else if (d1 > d2)
-                                        goto nomatch;
-                                }
-                            break;
-                                /* the other possibility ('=') never decides */
-                        }
-                    }
-                    if (++j >= nkeys)    /* last key - increment field */
-                        field++;
-                    else field = x->x_keyvec[j].k_field,    /* else next key */
-                            binop = x->x_keyvec[j].k_binop;
-                }
-                goto nomatch;   /* a tie - keep the old one */
-            replace:
-                bestline = lineno, beststart = thisstart;
-            }
-                /* no previous match so we're best */
-            else bestline = lineno, beststart = thisstart;
-        nomatch:
+            text_search_try(x, vec, lineno, thisstart, i - thisstart,
+                argc, argv, &bestline, &beststart, &failed);
             lineno++;
             thisstart = i+1;
         }
@@ -1501,6 +1864,13 @@ static void text_search_list(t_text_search *x,
     outlet_float(x->x_out1, bestline);
 }
 
+static void text_search_free(t_text_search *x)
+{
+    text_search_unindex(x);
+    freebytes(x->x_keyvec, x->x_nkeys * sizeof(*x->x_keyvec));
+    text_client_free(&x->x_tc);
+}
+
 /* ---------------- text_sequence object - sequencer ----------- */
 t_class *text_sequence_class;
 
@@ -1804,14 +2174,11 @@ static void text_sequence_step(t_text_sequence *x)
 static void text_sequence_line(t_text_sequence *x, t_floatarg f)
 {
     t_binbuf *b = text_client_getbuf(&x->x_tc);
-    int n, start, end;
-    t_atom *vec;
+    int start, end;
     if (!b)
        return;
     x->x_lastto = 0;
-    vec = binbuf_getvec(b);
-    n = binbuf_getnatom(b);
-    if (!text_nthline(n, vec, f, &start, &end))
+    if (!binbuf_getline(b, f, &start, &end))
     {
         pd_error(x, "text sequence: line number %d out of range", (int)f);
         x->x_onset = 0x7fffffff;
@@ -2294,7 +2661,7 @@ void x_qlist_setup(void )
     class_sethelpsymbol(text_fromlist_class, gensym("text-object"));
 
     text_search_class = class_new(gensym("text search"),
-        (t_newmethod)text_search_new, (t_method)text_client_free,
+        (t_newmethod)text_search_new, (t_method)text_search_free,
             sizeof(t_text_search), 0, A_GIMME, 0);
     class_addlist(text_search_class, text_search_list);
     class_sethelpsymbol(text_search_class, gensym("text-object"));
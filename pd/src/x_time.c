@@ -5,6 +5,7 @@
 /* clock objects */
 
 #include "m_pd.h"
+#include "m_imp.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -506,6 +507,13 @@ static void *pipe_new(t_symbol *s, int argc, t_atom *argv)
     return (x);
 }
 
+    /* a hang and its pointers are allocated in one block */
+static size_t pipe_hangsize(t_pipe *x)
+{
+    return (sizeof(t_hang) + (x->x_n - 1) * sizeof(union word) +
+        x->x_nptr * sizeof(t_gpointer));
+}
+
 static void hang_free(t_hang *h)
 {
     t_pipe *x = h->h_owner;
@@ -513,9 +521,8 @@ static void hang_free(t_hang *h)
     int i;
     for (gp = h->h_gp, i = x->x_nptr; i--; gp++)
         gpointer_unset(gp);
-    freebytes(h->h_gp, x->x_nptr * sizeof(*h->h_gp));
     clock_free(h->h_clock);
-    freebytes(h, sizeof(*h) + (x->x_n - 1) * sizeof(*h->h_vec));
+    pool_freebytes(h, pipe_hangsize(x));
 }
 
 static void hang_tick(t_hang *h)
@@ -554,14 +561,13 @@ static void hang_tick(t_hang *h)
 
 static void pipe_list(t_pipe *x, t_symbol *s, int ac, t_atom *av)
 {
-    t_hang *h = (t_hang *)
-        getbytes(sizeof(*h) + (x->x_n - 1) * sizeof(*h->h_vec));
+    t_hang *h = (t_hang *)pool_getbytes(pipe_hangsize(x));
     t_gpointer *gp, *gp2;
     t_pipeout *p;
     int i, n = x->x_n;
     t_atom *ap;
     t_word *w;
-    h->h_gp = (t_gpointer *)getbytes(x->x_nptr * sizeof(t_gpointer));
+    h->h_gp = (t_gpointer *)(h->h_vec + n);
     if (ac > n)
     {
         if (av[n].a_type == A_FLOAT)
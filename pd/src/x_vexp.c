@@ -1629,6 +1629,648 @@ cal_sigidx(struct ex_ex *optr,  /* The output value */
         return (1);
 }
 
+/*
+ * The compiler.  Rather than walking the prefix array for every evaluation
+ * (and, for expr~, allocating a vector for every node in every block), the
+ * expressions are turned once into a flat list of instructions, each one
+ * computing a value "slot" from others.  Constant subexpressions are worked
+ * out in advance, and pure subexpressions that occur more than once are
+ * computed once.  For expr~ each instruction on a signal is one loop over
+ * the block, into a buffer that is shared with other slots as soon as its
+ * value is no longer needed.  Whatever the compiler doesn't handle itself
+ * (tables, variables, stores, symbols, $x?[n], ...) becomes an EC_EVAL
+ * instruction that calls ex_eval() on that part of the array, so the
+ * compiled code always computes what ex_eval() would.
+ */
+
+#define EX_TOFLOAT(e)   ((e)->ex_type == ET_INT ? (t_float)(e)->ex_int : \
+                                                                (e)->ex_flt)
+
+/*
+ * ex_skip -- return the node after the subtree starting at eptr
+ */
+static struct ex_ex *
+ex_skip(struct ex_ex *eptr)
+{
+        long n;
+
+        switch (eptr->ex_type) {
+        case ET_OP:
+                n = unary_op(eptr->ex_op) ? 1 : 2;
+                break;
+        case ET_FUNC:
+                n = ((t_ex_func *)eptr->ex_ptr)->f_argc;
+                break;
+        case ET_TBL:
+        case ET_SI:
+        case ET_XI:
+        case ET_YO:
+                n = 1;
+                break;
+        default:
+                n = 0;
+        }
+        for (eptr++; n > 0 && eptr->ex_type; n--)
+                eptr = ex_skip(eptr);
+        return (eptr);
+}
+
+/*
+ * ex_hasnode -- does the subtree contain a signal inlet (vec != 0), or
+ *               anything that shouldn't be computed unless asked for,
+ *               i.e. side effects or a division (vec == 0)
+ */
+static int
+ex_hasnode(struct ex_ex *eptr, int vec)
+{
+        struct ex_ex *end = ex_skip(eptr);
+
+        for (; eptr < end; eptr++) {
+                if (vec && eptr->ex_type == ET_VI)
+                        return (1);
+                if (!vec && ((eptr->ex_type == ET_OP &&
+                    (eptr->ex_op == OP_STORE || eptr->ex_op == OP_DIV ||
+                    eptr->ex_op == OP_MOD)) || (eptr->ex_type == ET_FUNC &&
+                    !strcmp(((t_ex_func *)eptr->ex_ptr)->f_name, "random"))))
+                        return (1);
+        }
+        return (0);
+}
+
+static int
+ex_newslot(t_expr *expr, int kind)
+{
+        int n = expr->exp_nslot;
+
+        expr->exp_slot = (struct ex_ex *)fts_realloc(expr->exp_slot,
+                                                (n + 1) * sizeof (struct ex_ex));
+        expr->exp_slotkind = (char *)fts_realloc(expr->exp_slotkind, n + 1);
+        expr->exp_slotbuf = (int *)fts_realloc(expr->exp_slotbuf,
+                                                        (n + 1) * sizeof (int));
+        if (!expr->exp_slot || !expr->exp_slotkind || !expr->exp_slotbuf)
+                return (-1);
+        expr->exp_slot[n].ex_type = (kind == EK_VEC || kind == EK_VIN) ?
+                                                                ET_VI : ET_INT;
+        expr->exp_slot[n].ex_int = 0;
+        expr->exp_slotkind[n] = kind;
+        expr->exp_slotbuf[n] = -1;
+        return (expr->exp_nslot++);
+}
+
+static int
+ex_constslot(t_expr *expr, struct ex_ex *val)
+{
+        int i;
+
+        for (i = 0; i < expr->exp_nslot; i++)
+                if (expr->exp_slotkind[i] == EK_CONST &&
+                    expr->exp_slot[i].ex_type == val->ex_type &&
+                    (val->ex_type == ET_INT ?
+                        expr->exp_slot[i].ex_int == val->ex_int :
+                        expr->exp_slot[i].ex_flt == val->ex_flt))
+                        return (i);
+        if ((i = ex_newslot(expr, EK_CONST)) < 0)
+                return (-1);
+        expr->exp_slot[i] = *val;
+        return (i);
+}
+
+#define ex_isvec(expr, i)       ((expr)->exp_slotkind[i] >= EK_VEC)
+
+/*
+ * ex_emit -- add an instruction, unless its value is constant or already
+ *            computed; returns the slot of the value
+ */
+static int
+ex_emit(t_expr *expr, struct ex_code *c, int vec, int from)
+{
+        int i, pure, konst;
+        struct ex_code *c2;
+
+        for (i = 0, konst = 1; i < c->c_argc; i++) {
+                if (ex_isvec(expr, c->c_arg[i]))
+                        vec = 1;
+                if (expr->exp_slotkind[c->c_arg[i]] != EK_CONST)
+                        konst = 0;
+        }
+        pure = c->c_type != EC_EVAL && !(c->c_type == EC_FUNC &&
+                                !strcmp(((t_ex_func *)c->c_func)->f_name, "random"));
+        if (pure && c->c_argc && konst && c->c_type != EC_LOAD &&
+            !((c->c_op == OP_DIV || c->c_op == OP_MOD) && c->c_type == EC_OP &&
+                !EX_TOFLOAT(&expr->exp_slot[c->c_arg[1]]))) {
+                /* work it out now */
+                struct ex_ex val;
+
+                if ((c->c_dst = ex_newslot(expr, EK_SCALAR)) < 0)
+                        return (-1);
+                expr->exp_code = (struct ex_code *)fts_realloc(expr->exp_code,
+                                (expr->exp_ncode + 1) * sizeof (struct ex_code));
+                if (!expr->exp_code)
+                        return (-1);
+                expr->exp_code[expr->exp_ncode] = *c;
+                ex_run(expr, expr->exp_ncode, expr->exp_ncode + 1, 0);
+                val = expr->exp_slot[c->c_dst];
+                expr->exp_nslot--;
+                if (val.ex_type != ET_INT && val.ex_type != ET_FLT)
+                        return (-1);
+                return (ex_constslot(expr, &val));
+        }
+        if (pure)
+                for (c2 = expr->exp_code + from;
+                    c2 < expr->exp_code + expr->exp_ncode; c2++)
+                        if (c2->c_type == c->c_type && c2->c_op == c->c_op &&
+                            c2->c_func == c->c_func && c2->c_argc == c->c_argc &&
+                            !memcmp(c2->c_arg, c->c_arg,
+                                                c->c_argc * sizeof (int)))
+                                return (c2->c_dst);
+        if ((c->c_dst = ex_newslot(expr, c->c_type == EC_VIN ? EK_VIN :
+                                        (vec ? EK_VEC : EK_SCALAR))) < 0)
+                return (-1);
+        expr->exp_code = (struct ex_code *)fts_realloc(expr->exp_code,
+                                (expr->exp_ncode + 1) * sizeof (struct ex_code));
+        if (!expr->exp_code)
+                return (-1);
+        expr->exp_code[expr->exp_ncode++] = *c;
+        return (c->c_dst);
+}
+
+/*
+ * ex_compnode -- compile the subtree at *eptrp, leaving *eptrp past it;
+ *                returns the slot of its value, or -1 on failure
+ */
+static int
+ex_compnode(t_expr *expr, struct ex_ex **eptrp, int from)
+{
+        struct ex_ex *eptr = *eptrp, *ap;
+        struct ex_code c;
+        t_ex_func *f;
+        int i;
+
+        *eptrp = ex_skip(eptr);
+        memset(&c, 0, sizeof (c));
+        switch (eptr->ex_type) {
+        case ET_INT:
+        case ET_FLT:
+                return (ex_constslot(expr, eptr));
+        case ET_II:
+        case ET_FI:
+                if (eptr->ex_int == -1)
+                        break;
+                c.c_type = EC_LOAD;
+                c.c_op = eptr->ex_int;
+                c.c_arg[0] = eptr->ex_type;
+                return (ex_emit(expr, &c, 0, from));
+        case ET_VI:
+                if (!IS_EXPR_TILDE(expr))
+                        break;
+                c.c_type = EC_VIN;
+                c.c_op = eptr->ex_int;
+                return (ex_emit(expr, &c, 1, from));
+        case ET_XI0:
+        case ET_YOM1:
+                if (!IS_FEXPR_TILDE(expr))
+                        break;
+                c.c_type = eptr->ex_type == ET_XI0 ? EC_XI0 : EC_YOM1;
+                c.c_op = eptr->ex_int;
+                return (ex_emit(expr, &c, 0, from));
+        case ET_OP:
+                if (eptr->ex_op == OP_STORE)
+                        break;
+                c.c_type = EC_OP;
+                c.c_op = eptr->ex_op;
+                c.c_argc = unary_op(eptr->ex_op) ? 1 : 2;
+                for (i = 0, ap = eptr + 1; i < c.c_argc; i++)
+                        if ((c.c_arg[i] = ex_compnode(expr, &ap, from)) < 0)
+                                return (-1);
+                return (ex_emit(expr, &c, 0, from));
+        case ET_FUNC:
+                f = (t_ex_func *)eptr->ex_ptr;
+                if (f->f_argc > 3)
+                        break;
+                for (i = 0, ap = eptr + 1; i < f->f_argc; i++, ap = ex_skip(ap))
+                        if (ap->ex_type == ET_SYM || ap->ex_type == ET_VSYM)
+                                break;
+                if (i < f->f_argc)
+                        break;
+                if (f->f_func == (void (*))ex_if) {
+                        /* both sides are computed, so they had better be pure */
+                        ap = ex_skip(eptr + 1);
+                        if (ex_hasnode(ap, 0) || ex_hasnode(ex_skip(ap), 0))
+                                break;
+                        c.c_type = EC_IF;
+                } else
+                        c.c_type = EC_FUNC;
+                c.c_func = (struct ex_funcs *)f;
+                c.c_argc = f->f_argc;
+                for (i = 0, ap = eptr + 1; i < c.c_argc; i++)
+                        if ((c.c_arg[i] = ex_compnode(expr, &ap, from)) < 0)
+                                return (-1);
+                return (ex_emit(expr, &c, 0, from));
+        }
+        c.c_type = EC_EVAL;
+        c.c_tree = eptr;
+        return (ex_emit(expr, &c,
+                        IS_EXPR_TILDE(expr) && ex_hasnode(eptr, 1), from));
+}
+
+/*
+ * ex_compile -- compile all the expressions; returns 1 on failure, in which
+ *               case they are evaluated by ex_eval() as before
+ */
+int
+ex_compile(t_expr *expr)
+{
+        int i, j, k, nfree, *lastuse, *freebuf;
+        struct ex_ex *eptr;
+        struct ex_code *c;
+
+        expr->exp_ncode = expr->exp_nslot = expr->exp_nvbuf = 0;
+        for (i = 0; i < expr->exp_nexpr; i++) {
+                expr->exp_codeseg[i] = expr->exp_ncode;
+                eptr = expr->exp_stack[i];
+                /*
+                 * expr evaluates its expressions last to first, sending
+                 * out each result as it goes, so they can't share values
+                 */
+                if (!eptr->ex_type || (expr->exp_result[i] = ex_compnode(expr,
+                    &eptr, IS_EXPR(expr) ? expr->exp_ncode : 0)) < 0 ||
+                    eptr->ex_type)
+                        goto fail;
+        }
+        expr->exp_codeseg[i] = expr->exp_ncode;
+        /*
+         * give the vector slots buffers, reusing a buffer once the last
+         * instruction to look at its slot has run
+         */
+        lastuse = (int *)fts_malloc((expr->exp_nslot + 1) * sizeof (int));
+        freebuf = (int *)fts_malloc((expr->exp_nslot + 1) * sizeof (int));
+        if (!lastuse || !freebuf) {
+                if (lastuse)
+                        fts_free(lastuse);
+                goto fail;
+        }
+        for (i = 0; i < expr->exp_nslot; i++)
+                lastuse[i] = -1;
+        for (k = 0, c = expr->exp_code; k < expr->exp_ncode; k++, c++)
+                for (j = 0; j < c->c_argc; j++)
+                        lastuse[c->c_arg[j]] = k;
+        for (i = 0; i < expr->exp_nexpr; i++)
+                lastuse[expr->exp_result[i]] = expr->exp_ncode;
+        for (k = nfree = 0, c = expr->exp_code; k < expr->exp_ncode; k++, c++) {
+                for (j = 0; j < c->c_argc; j++)
+                        if (expr->exp_slotkind[c->c_arg[j]] == EK_VEC &&
+                            lastuse[c->c_arg[j]] == k) {
+                                freebuf[nfree++] = expr->exp_slotbuf[c->c_arg[j]];
+                                lastuse[c->c_arg[j]] = -1;
+                        }
+                if (expr->exp_slotkind[c->c_dst] == EK_VEC) {
+                        expr->exp_slotbuf[c->c_dst] = nfree ?
+                                freebuf[--nfree] : expr->exp_nvbuf++;
+                        if (lastuse[c->c_dst] < k)
+                                freebuf[nfree++] = expr->exp_slotbuf[c->c_dst];
+                }
+        }
+        fts_free(lastuse);
+        fts_free(freebuf);
+        /*
+         * a single expr~ whose value comes from the last instruction can
+         * compute straight into the outlet
+         */
+        expr->exp_direct = IS_EXPR_TILDE(expr) && expr->exp_nexpr == 1 &&
+                expr->exp_ncode &&
+                expr->exp_code[expr->exp_ncode - 1].c_dst == expr->exp_result[0] &&
+                expr->exp_slotkind[expr->exp_result[0]] == EK_VEC;
+        return (0);
+fail:
+        ex_freecode(expr);
+        return (1);
+}
+
+void
+ex_freecode(t_expr *expr)
+{
+        if (expr->exp_code)
+                fts_free(expr->exp_code);
+        if (expr->exp_slot)
+                fts_free(expr->exp_slot);
+        if (expr->exp_slotkind)
+                fts_free(expr->exp_slotkind);
+        if (expr->exp_slotbuf)
+                fts_free(expr->exp_slotbuf);
+        if (expr->exp_vbuf)
+                fts_free(expr->exp_vbuf);
+        expr->exp_code = 0;
+        expr->exp_slot = 0;
+        expr->exp_slotkind = 0;
+        expr->exp_slotbuf = 0;
+        expr->exp_vbuf = 0;
+        expr->exp_ncode = expr->exp_nslot = expr->exp_nvbuf = 0;
+        expr->exp_vbufsize = 0;
+}
+
+/*
+ * ex_dspcode -- (re)allocate the vector buffers for the current vector size
+ */
+void
+ex_dspcode(t_expr *expr)
+{
+        int i;
+
+        if (!expr->exp_code || !expr->exp_nvbuf)
+                return;
+        if (expr->exp_vbufsize != expr->exp_vsize) {
+                if (expr->exp_vbuf)
+                        fts_free(expr->exp_vbuf);
+                expr->exp_vbuf = (t_float *)fts_calloc(expr->exp_nvbuf *
+                                        expr->exp_vsize, sizeof (t_float));
+                if (!expr->exp_vbuf) {
+                        post_error((fts_object_t *) expr,
+                                        "expr: out of memory for vectors");
+                        ex_freecode(expr);
+                        return;
+                }
+                expr->exp_vbufsize = expr->exp_vsize;
+        }
+        for (i = 0; i < expr->exp_nslot; i++)
+                if (expr->exp_slotkind[i] == EK_VEC)
+                        expr->exp_slot[i].ex_vec = expr->exp_vbuf +
+                                        expr->exp_slotbuf[i] * expr->exp_vsize;
+}
+
+/*
+ * ex_copyout -- put a result into a signal vector
+ */
+void
+ex_copyout(t_expr *expr, struct ex_ex *res, t_float *out)
+{
+        if (res->ex_type == ET_VI || res->ex_type == ET_VEC) {
+                if (res->ex_vec != out)
+                        memcpy(out, res->ex_vec,
+                                        expr->exp_vsize * sizeof (t_float));
+        } else
+                ex_mkvector(out, EX_TOFLOAT(res), expr->exp_vsize);
+}
+
+/*
+ * binary operators on signals, with "l" and "r" the left and right values,
+ * and "dz" set on a division by zero
+ */
+#define EXV_BINARY(E)                                                   \
+        if (lp && rp)                                                   \
+                for (i = 0; i < n; i++) {                               \
+                        l = lp[i]; r = rp[i]; op[i] = (E);              \
+                }                                                       \
+        else if (lp)                                                    \
+                for (i = 0; i < n; i++) {                               \
+                        l = lp[i]; op[i] = (E);                         \
+                }                                                       \
+        else                                                            \
+                for (i = 0; i < n; i++) {                               \
+                        r = rp[i]; op[i] = (E);                         \
+                }                                                       \
+        break;
+
+/* and on scalars, typed as in EVAL() above */
+#define EXS_BINARY(E)                                                   \
+        if (a->ex_type == ET_INT && b->ex_type == ET_INT) {             \
+                long l = a->ex_int, r = b->ex_int;                      \
+                d->ex_type = ET_INT;                                    \
+                d->ex_int = (E);                                        \
+        } else {                                                        \
+                t_float l = EX_TOFLOAT(a), r = EX_TOFLOAT(b);           \
+                d->ex_type = ET_FLT;                                    \
+                d->ex_flt = (E);                                        \
+        }                                                               \
+        break;
+
+static void
+ex_runop(t_expr *expr, struct ex_code *c)
+{
+        struct ex_ex *d = &expr->exp_slot[c->c_dst];
+        struct ex_ex *a = &expr->exp_slot[c->c_arg[0]];
+        struct ex_ex *b = &expr->exp_slot[c->c_arg[1]];
+        int i, n = expr->exp_vsize, dz = 0;
+        t_float *op, *lp, *rp, l, r;
+
+        if (d->ex_type != ET_VI) {
+                if (c->c_argc == 1) switch (c->c_op) {
+                case OP_NOT:
+                        if (a->ex_type == ET_INT)
+                                d->ex_int = !a->ex_int;
+                        else
+                                d->ex_flt = !a->ex_flt;
+                        d->ex_type = a->ex_type;
+                        return;
+                case OP_NEG:
+                        if (a->ex_type == ET_INT)
+                                d->ex_int = ~a->ex_int;
+                        else
+                                d->ex_flt = ~((long)a->ex_flt);
+                        d->ex_type = a->ex_type;
+                        return;
+                case OP_UMINUS:
+                        if (a->ex_type == ET_INT)
+                                d->ex_int = -a->ex_int;
+                        else
+                                d->ex_flt = -a->ex_flt;
+                        d->ex_type = a->ex_type;
+                        return;
+                }
+                switch (c->c_op) {
+                case OP_MUL:    EXS_BINARY(l * r);
+                case OP_ADD:    EXS_BINARY(l + r);
+                case OP_SUB:    EXS_BINARY(l - r);
+                case OP_LT:     EXS_BINARY(l < r);
+                case OP_LE:     EXS_BINARY(l <= r);
+                case OP_GT:     EXS_BINARY(l > r);
+                case OP_GE:     EXS_BINARY(l >= r);
+                case OP_EQ:     EXS_BINARY(l == r);
+                case OP_NE:     EXS_BINARY(l != r);
+                case OP_SL:     EXS_BINARY(((int)l) << ((int)r));
+                case OP_SR:     EXS_BINARY(((int)l) >> ((int)r));
+                case OP_AND:    EXS_BINARY(((int)l) & ((int)r));
+                case OP_XOR:    EXS_BINARY(((int)l) ^ ((int)r));
+                case OP_OR:     EXS_BINARY(((int)l) | ((int)r));
+                case OP_LAND:   EXS_BINARY(((int)l) && ((int)r));
+                case OP_LOR:    EXS_BINARY(((int)l) || ((int)r));
+                case OP_MOD:    EXS_BINARY(((int)r) ?
+                                        ((int)l) % ((int)r) : (dz = 1, 0));
+                case OP_DIV:    EXS_BINARY(r ? l / r : (dz = 1, 0));
+                }
+                if (dz)
+                        ex_dzdetect(expr);
+                return;
+        }
+        op = d->ex_vec;
+        lp = rp = 0;
+        l = r = 0;
+        if (a->ex_type == ET_VI)
+                lp = a->ex_vec;
+        else
+                l = EX_TOFLOAT(a);
+        if (c->c_argc == 1) switch (c->c_op) {
+        case OP_NOT:
+                for (i = 0; i < n; i++)
+                        op[i] = !lp[i];
+                return;
+        case OP_NEG:
+                for (i = 0; i < n; i++)
+                        op[i] = ~((long)lp[i]);
+                return;
+        case OP_UMINUS:
+                for (i = 0; i < n; i++)
+                        op[i] = -lp[i];
+                return;
+        }
+        if (b->ex_type == ET_VI)
+                rp = b->ex_vec;
+        else
+                r = EX_TOFLOAT(b);
+        switch (c->c_op) {
+        case OP_MUL:    EXV_BINARY(l * r);
+        case OP_ADD:    EXV_BINARY(l + r);
+        case OP_SUB:    EXV_BINARY(l - r);
+        case OP_LT:     EXV_BINARY(l < r);
+        case OP_LE:     EXV_BINARY(l <= r);
+        case OP_GT:     EXV_BINARY(l > r);
+        case OP_GE:     EXV_BINARY(l >= r);
+        case OP_EQ:     EXV_BINARY(l == r);
+        case OP_NE:     EXV_BINARY(l != r);
+        case OP_SL:     EXV_BINARY(((int)l) << ((int)r));
+        case OP_SR:     EXV_BINARY(((int)l) >> ((int)r));
+        case OP_AND:    EXV_BINARY(((int)l) & ((int)r));
+        case OP_XOR:    EXV_BINARY(((int)l) ^ ((int)r));
+        case OP_OR:     EXV_BINARY(((int)l) | ((int)r));
+        case OP_LAND:   EXV_BINARY(((int)l) && ((int)r));
+        case OP_LOR:    EXV_BINARY(((int)l) || ((int)r));
+        case OP_MOD:    EXV_BINARY(((int)r) ?
+                                ((int)l) % ((int)r) : (dz = 1, 0));
+        case OP_DIV:    EXV_BINARY(r ? l / r : (dz = 1, 0));
+        }
+        if (dz)
+                ex_dzdetect(expr);
+}
+
+/*
+ * ex_runif -- if() on values already computed
+ */
+static void
+ex_runif(t_expr *expr, struct ex_code *c)
+{
+        struct ex_ex *d = &expr->exp_slot[c->c_dst];
+        struct ex_ex *cond = &expr->exp_slot[c->c_arg[0]];
+        struct ex_ex *a = &expr->exp_slot[c->c_arg[1]];
+        struct ex_ex *b = &expr->exp_slot[c->c_arg[2]];
+        int i, n = expr->exp_vsize;
+        t_float *op, *cp, *lp, *rp, l, r;
+
+        if (cond->ex_type != ET_VI) {
+                struct ex_ex *res = (cond->ex_type == ET_INT ? cond->ex_int != 0 :
+                                                        cond->ex_flt != 0) ? a : b;
+                if (d->ex_type == ET_VI)
+                        ex_copyout(expr, res, d->ex_vec);
+                else
+                        *d = *res;
+                return;
+        }
+        op = d->ex_vec;
+        cp = cond->ex_vec;
+        lp = a->ex_type == ET_VI ? a->ex_vec : 0;
+        rp = b->ex_type == ET_VI ? b->ex_vec : 0;
+        l = lp ? 0 : EX_TOFLOAT(a);
+        r = rp ? 0 : EX_TOFLOAT(b);
+        for (i = 0; i < n; i++)
+                op[i] = cp[i] ? (lp ? lp[i] : l) : (rp ? rp[i] : r);
+}
+
+/*
+ * ex_run -- run the instructions from "from" up to "to"; "idx" is the
+ *           sample number for fexpr~
+ */
+void
+ex_run(t_expr *expr, int from, int to, int idx)
+{
+        struct ex_code *c;
+        struct ex_ex *d, args[3], res;
+        int i;
+
+        for (c = expr->exp_code + from; c < expr->exp_code + to; c++) {
+                d = &expr->exp_slot[c->c_dst];
+                switch (c->c_type) {
+                case EC_LOAD:
+                        if (c->c_arg[0] == ET_II) {
+                                d->ex_type = ET_INT;
+                                d->ex_int = expr->exp_var[c->c_op].ex_int;
+                        } else {
+                                d->ex_type = ET_FLT;
+                                d->ex_flt = expr->exp_var[c->c_op].ex_flt;
+                        }
+                        break;
+                case EC_VIN:
+                        d->ex_vec = expr->exp_var[c->c_op].ex_vec;
+                        break;
+                case EC_XI0:
+                        d->ex_type = ET_FLT;
+                        d->ex_flt = expr->exp_var[c->c_op].ex_vec[idx];
+                        break;
+                case EC_YOM1:
+                        d->ex_type = ET_FLT;
+                        if (idx == 0)
+                                d->ex_flt = expr->exp_p_res[c->c_op]
+                                                        [expr->exp_vsize - 1];
+                        else
+                                d->ex_flt = expr->exp_tmpres[c->c_op][idx - 1];
+                        break;
+                case EC_OP:
+                        ex_runop(expr, c);
+                        break;
+                case EC_IF:
+                        ex_runif(expr, c);
+                        break;
+                case EC_FUNC:
+                        for (i = 0; i < c->c_argc; i++)
+                                args[i] = expr->exp_slot[c->c_arg[i]];
+                        if (d->ex_type == ET_VI) {
+                                res.ex_type = ET_VEC;
+                                res.ex_vec = d->ex_vec;
+                        } else {
+                                res.ex_type = 0;
+                                res.ex_int = 0;
+                        }
+                        (*((t_ex_func *)c->c_func)->f_func)(expr, c->c_argc,
+                                                                args, &res);
+                        goto store;
+                case EC_EVAL:
+                        if (d->ex_type == ET_VI) {
+                                res.ex_type = ET_VEC;
+                                res.ex_vec = d->ex_vec;
+                        } else {
+                                res.ex_type = 0;
+                                res.ex_int = 0;
+                        }
+                        if (!ex_eval(expr, c->c_tree, &res, idx) &&
+                                                        res.ex_type != ET_VEC) {
+                                res.ex_type = ET_INT;
+                                res.ex_int = 0;
+                        }
+                store:
+                        if (d->ex_type == ET_VI) {
+                                /* the result may not be where we asked */
+                                ex_copyout(expr, &res, d->ex_vec);
+                                if (res.ex_type == ET_VEC &&
+                                                        res.ex_vec != d->ex_vec)
+                                        fts_free(res.ex_vec);
+                        } else if (res.ex_type == ET_VEC) {
+                                fts_free(res.ex_vec);
+                                d->ex_type = ET_INT;
+                                d->ex_int = 0;
+                        } else
+                                *d = res;
+                        break;
+                }
+        }
+}
+
 /*
  * getoken -- return 1 on syntax error otherwise 0
  */
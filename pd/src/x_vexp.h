@@ -184,6 +184,36 @@ struct ex_ex {
 #define EE_NOTABLE      0x08    /* NO TABLE */
 #define EE_NOVAR        0x10    /* NO VARIABLE */
 
+/*
+ * the compiled form of the expressions: a list of instructions, each of
+ * which computes one value slot from up to three others
+ */
+struct ex_code {
+        int c_type;             /* EC_... below */
+        int c_argc;             /* number of operand slots */
+        long c_op;              /* the operator, or the inlet number */
+        struct ex_funcs *c_func;        /* the function for EC_FUNC */
+        struct ex_ex *c_tree;   /* the subtree for EC_EVAL */
+        int c_dst;              /* slot of the result */
+        int c_arg[3];           /* slots of the operands */
+};
+
+/* defines for c_type */
+#define EC_LOAD         1       /* value of a float or int inlet */
+#define EC_VIN          2       /* signal inlet */
+#define EC_XI0          3       /* $x?[0] for fexpr~ */
+#define EC_YOM1         4       /* $y?[-1] for fexpr~ */
+#define EC_OP           5       /* unary or binary operator */
+#define EC_FUNC         6       /* function call */
+#define EC_IF           7       /* if() */
+#define EC_EVAL         8       /* anything else, left to ex_eval() */
+
+/* defines for exp_slotkind */
+#define EK_SCALAR       0       /* an int or a float computed by the code */
+#define EK_CONST        1       /* an int or a float known in advance */
+#define EK_VEC          2       /* a signal vector computed by the code */
+#define EK_VIN          3       /* a signal inlet's vector */
+
 typedef struct expr {
 #ifdef PD
         t_object exp_ob;
@@ -211,6 +241,18 @@ typedef struct expr {
         int exp_vsize;                  /* the size of the signal vector */
         int exp_nivec;                  /* # of vector inlets */
         t_float exp_f;          /* control value to be transformed to signal */
+        struct ex_code *exp_code;       /* the compiled expressions */
+        int exp_ncode;
+        int exp_codeseg[MAX_VARS + 1];  /* where each expression's code starts */
+        int exp_result[MAX_VARS];       /* the slot holding each result */
+        struct ex_ex *exp_slot;         /* the values computed by the code */
+        char *exp_slotkind;             /* EK_... above */
+        int *exp_slotbuf;               /* which buffer an EK_VEC slot uses */
+        int exp_nslot;
+        t_float *exp_vbuf;              /* buffers for the EK_VEC slots */
+        int exp_nvbuf;                  /* number of buffers */
+        int exp_vbufsize;               /* vector size they were made for */
+        int exp_direct;                 /* expr~ computes into its outlet */
 } t_expr;
 
 typedef struct ex_funcs {
@@ -231,6 +273,11 @@ max_ex_tab(struct expr *expr, t_symbol *s, struct ex_ex *arg,
 extern int max_ex_var(struct expr *expr, t_symbol *s, struct ex_ex *optr,
                                                                                                                                         int idx);
 extern int max_ex_var_store(struct expr *, t_symbol *, struct ex_ex *, struct ex_ex *);
+extern int ex_compile(struct expr *expr);
+extern void ex_freecode(struct expr *expr);
+extern void ex_dspcode(struct expr *expr);
+extern void ex_run(struct expr *expr, int from, int to, int idx);
+extern void ex_copyout(struct expr *expr, struct ex_ex *res, t_float *out);
 extern int ex_getsym(char *p, t_symbol **s);
 extern const char *ex_symname(t_symbol *s);
 void ex_mkvector(t_float *fp, t_float x, int size);
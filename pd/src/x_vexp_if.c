@@ -160,7 +160,7 @@ expr_ff(t_expr *x)
                 if (x->exp_tmpres[i])
                         fts_free(x->exp_tmpres[i]);
         }
-
+        ex_freecode(x);
 
 }
 
@@ -198,7 +198,10 @@ expr_bang(t_expr *x)
                 return;
 
         for (i = x->exp_nexpr - 1; i > -1 ; i--) {
-                if (!ex_eval(x, x->exp_stack[i], &x->exp_res[i], 0)) {
+                if (x->exp_code) {
+                        ex_run(x, x->exp_codeseg[i], x->exp_codeseg[i + 1], 0);
+                        x->exp_res[i] = x->exp_slot[x->exp_result[i]];
+                } else if (!ex_eval(x, x->exp_stack[i], &x->exp_res[i], 0)) {
                         /*fprintf(stderr,"expr_bang(error evaluation)\n"); */
                 /*  SDY now that we have mutiple ones, on error we should
                  * continue
@@ -294,6 +297,14 @@ Nexpr_new(t_symbol *s, int ac, t_atom *av)
                 x->exp_vsize = 0;
         }
         x->exp_f = 0; /* save the control value to be transformed to signal */
+        x->exp_code = 0;
+        x->exp_slot = 0;
+        x->exp_slotkind = 0;
+        x->exp_slotbuf = 0;
+        x->exp_vbuf = 0;
+        x->exp_ncode = x->exp_nslot = x->exp_nvbuf = 0;
+        x->exp_vbufsize = 0;
+        x->exp_direct = 0;
 
 
         if (expr_donew(x, ac, av))
@@ -387,6 +398,7 @@ SDY the following coredumps why?
         }
         for (i = 0; i < MAX_VARS; i++)
                 x->exp_p_var[i] = fts_calloc(x->exp_vsize, sizeof (t_float));
+        ex_compile(x);
 
         return (x);
 }
@@ -412,6 +424,27 @@ expr_perform(t_int *w)
                 return (w + 2);
         }
 
+        if (IS_EXPR_TILDE(x) && x->exp_code) {
+                if (x->exp_direct)
+                        x->exp_slot[x->exp_result[0]].ex_vec =
+                                                        x->exp_res[0].ex_vec;
+                ex_run(x, 0, x->exp_ncode, 0);
+                if (x->exp_nexpr == 1) {
+                        if (!x->exp_direct)
+                                ex_copyout(x, &x->exp_slot[x->exp_result[0]],
+                                                        x->exp_res[0].ex_vec);
+                } else {
+                        for (i = 0; i < x->exp_nexpr; i++)
+                                ex_copyout(x, &x->exp_slot[x->exp_result[i]],
+                                                        x->exp_tmpres[i]);
+                        n = x->exp_vsize * sizeof(t_float);
+                        for (i = 0; i < x->exp_nexpr; i++)
+                                memcpy(x->exp_res[i].ex_vec, x->exp_tmpres[i],
+                                                                        n);
+                }
+                return (w + 2);
+        }
+
         if (IS_EXPR_TILDE(x)) {
                 /*
                  * if we have only one expression, we can right on
@@ -444,6 +477,17 @@ expr_perform(t_int *w)
          * since the output buffer could be the same as one of the inputs
          * we need to keep the output in  a different buffer
          */
+        if (x->exp_code) {
+                for (i = 0; i < x->exp_vsize; i++) {
+                        ex_run(x, 0, x->exp_ncode, i);
+                        for (j = 0; j < x->exp_nexpr; j++) {
+                                res = x->exp_slot[x->exp_result[j]];
+                                x->exp_tmpres[j][i] = res.ex_type == ET_INT ?
+                                        (t_float) res.ex_int : res.ex_flt;
+                        }
+                }
+                goto save;
+        }
         for (i = 0; i < x->exp_vsize; i++) for (j = 0; j < x->exp_nexpr; j++) {
                 res.ex_type = 0;
                 res.ex_int = 0;
@@ -464,6 +508,7 @@ expr_perform(t_int *w)
          * inputs need to be copied first as the output buffer can be
          * same as an input buffer
          */
+save:
         n = x->exp_vsize * sizeof(t_float);
         for (i = 0; i < MAX_VARS; i++)
                 if (x->exp_var[i].ex_type == ET_XI)
@@ -512,6 +557,7 @@ expr_dsp(t_expr *x, t_signal **sp)
                 abort();
         }
 
+        ex_dspcode(x);
         dsp_add(expr_perform, 1, (t_int *) x);
 
         /*
@@ -888,10 +934,11 @@ max_ex_tab(struct expr *expr, fts_symbol_t s, struct ex_ex *arg,
 #ifdef PD
         t_garray *garray;
         int size, indx;
-        t_word *wvec;
+        t_float *fvec;
+        int stride;
 
         if (!s || !(garray = (t_garray *)pd_findbyclass(s, garray_class)) ||
-            !garray_getfloatwords(garray, &size, &wvec))
+            !garray_getfloatvec(garray, &size, &fvec, &stride))
         {
                 optr->ex_type = ET_FLT;
                 optr->ex_flt = 0;
@@ -915,7 +962,7 @@ max_ex_tab(struct expr *expr, fts_symbol_t s, struct ex_ex *arg,
         }
         if (indx < 0) indx = 0;
         else if (indx >= size) indx = size - 1;
-        optr->ex_flt = wvec[indx].w_float;
+        optr->ex_flt = fvec[indx * stride];
 #else /* MSP */
         /*
          * table lookup not done for MSP yet
@@ -948,10 +995,11 @@ max_ex_tab_store(struct expr *expr, t_symbol *s, struct ex_ex *arg,
 #ifdef PD
         t_garray *garray;
         int size, indx;
-        t_word *wvec;
+        t_float *fvec;
+        int stride;
 
         if (!s || !(garray = (t_garray *)pd_findbyclass(s, garray_class)) ||
-                !garray_getfloatwords(garray, &size, &wvec)) {
+                !garray_getfloatvec(garray, &size, &fvec, &stride)) {
                 optr->ex_type = ET_FLT;
                 optr->ex_flt = 0;
                 if (s)
@@ -983,10 +1031,10 @@ max_ex_tab_store(struct expr *expr, t_symbol *s, struct ex_ex *arg,
         *optr = *rval;
         switch (rval->ex_type) {
         case ET_INT:
-                wvec[indx].w_float = rval->ex_int;
+                fvec[indx * stride] = rval->ex_int;
                                 break;
         case ET_FLT:
-                wvec[indx].w_float = rval->ex_flt;
+                fvec[indx * stride] = rval->ex_flt;
                                 break;
         default:
                 pd_error(expr, "expr:bad right value type '%ld'", rval->ex_type);
@@ -1028,9 +1076,9 @@ max_ex_var(struct expr *expr, t_symbol *var, struct ex_ex *optr, int idx)
 #ifdef PD /* this goes to the end of this file as the following functions
            * should be defined in the expr object in MSP
            */
-#define ISTABLE(sym, garray, size, vec)                               \
+#define ISTABLE(sym, garray, size, vec, stride)                       \
 if (!sym || !(garray = (t_garray *)pd_findbyclass(sym, garray_class)) || \
-                !garray_getfloatwords(garray, &size, &vec))  {          \
+                !garray_getfloatvec(garray, &size, &vec, &stride))  {   \
         optr->ex_type = ET_FLT;                                         \
         optr->ex_int = 0;                                               \
         error("no such table '%s'", sym?(sym->s_name):"(null)");                       \
@@ -1046,7 +1094,8 @@ ex_size(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
         t_symbol *s;
         t_garray *garray;
         int size;
-        t_word *wvec;
+        t_float *fvec;
+        int stride;
 
         if (argv->ex_type != ET_SYM)
         {
@@ -1058,7 +1107,7 @@ ex_size(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
 
         s = (fts_symbol_t ) argv->ex_ptr;
 
-        ISTABLE(s, garray, size, wvec);
+        ISTABLE(s, garray, size, fvec, stride);
 
         optr->ex_type = ET_INT;
         optr->ex_int = size;
@@ -1074,7 +1123,8 @@ ex_sum(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
         t_symbol *s;
         t_garray *garray;
         int size;
-        t_word *wvec;
+        t_float *fvec;
+        int stride;
         t_float sum;
         int indx;
 
@@ -1088,10 +1138,10 @@ ex_sum(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
 
         s = (fts_symbol_t ) argv->ex_ptr;
 
-        ISTABLE(s, garray, size, wvec);
+        ISTABLE(s, garray, size, fvec, stride);
 
         for (indx = 0, sum = 0; indx < size; indx++)
-                sum += wvec[indx].w_float;
+                sum += fvec[indx * stride];
 
         optr->ex_type = ET_FLT;
         optr->ex_flt = sum;
@@ -1108,7 +1158,8 @@ ex_Sum(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
         t_symbol *s;
         t_garray *garray;
         int size;
-        t_word *wvec;
+        t_float *fvec;
+        int stride;
         t_float sum;
         int indx, n1, n2;
 
@@ -1122,7 +1173,7 @@ ex_Sum(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
 
         s = (fts_symbol_t ) argv->ex_ptr;
 
-        ISTABLE(s, garray, size, wvec);
+        ISTABLE(s, garray, size, fvec, stride);
 
                 switch((++argv)->ex_type) {
                 case ET_INT:
@@ -1158,7 +1209,7 @@ ex_Sum(t_expr *e, long int argc, struct ex_ex *argv, struct ex_ex *optr)
 
         for (indx = n1, sum = 0; indx <= n2; indx++)
                         if (indx >= 0 && indx < size)
-                                sum += wvec[indx].w_float;
+                                sum += fvec[indx * stride];
 
         optr->ex_type = ET_FLT;
         optr->ex_flt = sum;
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+
+# Run the benchmark patches in scripts/benchmarks with a headless Pd and
+# print (or save) the results as JSON.
+#
+# Each patch measures itself with [realtime] and reports its figures by
+# printing lines of the form "bench: <benchmark> <metric> <value>" before it
+# quits.  Metrics ending in "_per_second" are better when higher, metrics
+# ending in "_ms" better when lower.  Patch names starting with "_" are
+# abstractions used by the others and aren't run.
+#
+# usage: benchmark.py [--pd PD] [--runs N] [--output FILE]
+#                     [--baseline FILE] [--threshold FRACTION] [name ...]
+#
+# With --baseline, the results are compared with an earlier run and the
+# script exits with status 1 if any metric got worse by more than the
+# threshold (10% by default).
+#
+# A run fails if Pd reports an error (an object that couldn't be created, a
+# connection that failed, or any "error:" line), exits with a non-zero
+# status, or prints no results.  A benchmark with a failed run gets no
+# metrics in the report, and the script then exits with status 2.
+
+import argparse, glob, json, os, platform, re, subprocess, sys, time
+
+benchdir = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+    'benchmarks')
+
+    # Pd's output when a patch didn't load or run as written
+failure = re.compile(r"couldn't create|connection failed|^error:",
+    re.MULTILINE)
+
+def run_patch(pd, patch, timeout):
+    """run one patch and return its metrics and the process's wall time;
+    the metrics are None if the run failed"""
+    cmd = [pd, '-noprefs', '-nogui', '-nosound', '-batch', '-r', '44100',
+        os.path.basename(patch)]
+    start = time.time()
+    proc = subprocess.run(cmd, cwd=benchdir, stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT, universal_newlines=True, timeout=timeout)
+    elapsed = time.time() - start
+    metrics = {}
+    for line in proc.stdout.splitlines():
+        words = line.split()
+        if len(words) == 4 and words[0] == 'bench:':
+            try:
+                metrics[words[2]] = float(words[3])
+            except ValueError:
+                pass
+    bad = failure.search(proc.stdout)
+    if bad or proc.returncode or not metrics:
+        sys.stderr.write('%s: failed (%s)\n%s' % (patch,
+            bad.group(0) if bad else 'exit status %d' % proc.returncode
+                if proc.returncode else 'no results', proc.stdout))
+        return None, elapsed
+    return metrics, elapsed
+
+def better(metric, a, b):
+    """true if value a is better than value b for this metric"""
+    if metric.endswith('_ms') or metric.endswith('_seconds'):
+        return a < b
+    return a > b
+
+def compare(results, baseline, threshold):
+    """print the metrics that got worse than the baseline; return count"""
+    nworse = 0
+    for name, metrics in sorted(results.items()):
+        old = baseline.get('benchmarks', {}).get(name, {})
+        for metric, value in sorted(metrics.items()):
+            if metric not in old or not old[metric] or \
+                metric == 'process_seconds':
+                continue
+            change = value / old[metric] - 1
+            if not better(metric, value, old[metric]) and \
+                abs(change) > threshold:
+                sys.stderr.write('regression: %s %s %g -> %g (%+.1f%%)\n' %
+                    (name, metric, old[metric], value, 100 * change))
+                nworse += 1
+    return nworse
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='run the Pd benchmark corpus and report JSON')
+    parser.add_argument('--pd', default='pd-l2ork',
+        help='Pd executable (default: pd-l2ork in PATH)')
+    parser.add_argument('--runs', type=int, default=3,
+        help='runs per benchmark; the best one counts (default: 3)')
+    parser.add_argument('--output', '-o', help='write JSON to this file')
+    parser.add_argument('--baseline', '-b',
+        help='JSON from an earlier run to compare with')
+    parser.add_argument('--threshold', '-t', type=float, default=0.1,
+        help='tolerated slowdown against the baseline (default: 0.1)')
+    parser.add_argument('--timeout', type=float, default=300,
+        help='seconds before a benchmark is given up on (default: 300)')
+    parser.add_argument('names', nargs='*',
+        help='benchmarks to run (default: all)')
+    args = parser.parse_args()
+
+    patches = sorted(p for p in glob.glob(os.path.join(benchdir, '*.pd'))
+        if not os.path.basename(p).startswith('_'))
+    if args.names:
+        patches = [p for p in patches
+            if os.path.basename(p)[:-3] in args.names]
+    pd = args.pd
+    if os.path.sep in pd:
+        pd = os.path.abspath(pd)
+
+    results = {}
+    failed = []
+    for patch in patches:
+        name = os.path.basename(patch)[:-3]
+        best = {}
+        for i in range(args.runs):
+            metrics, elapsed = run_patch(pd, patch, args.timeout)
+            if metrics is None:
+                failed.append(name)
+                best = {}
+                break
+            metrics['process_seconds'] = elapsed
+            for metric, value in metrics.items():
+                if metric not in best or better(metric, value, best[metric]):
+                    best[metric] = value
+        results[name] = best
+        sys.stderr.write('%s: %s\n' % (name, ', '.join('%s %g' % kv
+            for kv in sorted(best.items())) or 'FAILED'))
+
+    report = {
+        'pd': pd,
+        'host': platform.node(),
+        'machine': platform.machine(),
+        'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'runs': args.runs,
+        'benchmarks': results,
+    }
+    text = json.dumps(report, indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print(text)
+
+    nworse = 0
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        nworse = compare(results, baseline, args.threshold)
+    if failed:
+        sys.stderr.write('failed: %s\n' % ' '.join(failed))
+        sys.exit(2)
+    if nworse:
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()
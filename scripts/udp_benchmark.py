@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+# Measure how many FUDI datagrams per second a headless Pd can take in with
+# [netreceive -u], over the loopback interface.
+#
+# The patches in scripts/benchmarks run with -batch, where sockets aren't
+# polled, so this one drives a Pd of its own.  Pd is stopped while a burst
+# of datagrams is queued up in its socket, then let go to read them, so
+# that it sees them the way it would after a long DSP tick; the figure
+# reported is datagrams received per second of Pd's CPU time, along with
+# the fraction that arrived (the rest overflowed the socket buffer).
+#
+# usage: udp_benchmark.py [--pd PD] [--bursts N] [--size N] [--port N]
+
+import argparse, os, signal, socket, subprocess, sys, tempfile, time
+
+patch = '''#N canvas 0 0 450 300 10;
+#X obj 10 10 netreceive -u %d;
+#X obj 10 40 route report quit;
+#X obj 200 70 t b;
+#X obj 200 100 f;
+#X obj 240 100 + 1;
+#X obj 10 100 f;
+#X obj 10 130 print received;
+#X msg 100 70 \\; pd quit;
+#X connect 0 0 1 0;
+#X connect 1 0 5 0;
+#X connect 1 1 7 0;
+#X connect 1 2 2 0;
+#X connect 2 0 3 0;
+#X connect 3 0 4 0;
+#X connect 4 0 3 1;
+#X connect 4 0 5 1;
+#X connect 5 0 6 0;
+'''
+
+def cputime(pid):
+    """user and system time of a process in seconds"""
+    with open('/proc/%d/stat' % pid) as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='measure netreceive UDP capacity over loopback')
+    parser.add_argument('--pd', default='pd-l2ork',
+        help='Pd executable (default: pd-l2ork in PATH)')
+    parser.add_argument('--bursts', type=int, default=2000,
+        help='number of bursts (default: 2000)')
+    parser.add_argument('--size', type=int, default=250,
+        help='datagrams per burst (default: 250)')
+    parser.add_argument('--port', type=int, default=3457,
+        help='UDP port (default: 3457)')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as dir:
+        with open(os.path.join(dir, 'udp.pd'), 'w') as f:
+            f.write(patch % args.port)
+        proc = subprocess.Popen([args.pd, '-noprefs', '-nogui', '-nosound',
+            'udp.pd'], cwd=dir, stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT, universal_newlines=True)
+        time.sleep(1.5)
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.connect(('127.0.0.1', args.port))
+        message = b'n 1 2.5 foo;\n'
+        sent = 0
+        cpu = cputime(proc.pid)
+        for i in range(args.bursts):
+            os.kill(proc.pid, signal.SIGSTOP)
+            for j in range(args.size):
+                sock.send(message)
+            sent += args.size
+            os.kill(proc.pid, signal.SIGCONT)
+            time.sleep(0.002)
+        time.sleep(0.5)
+        cpu = cputime(proc.pid) - cpu
+        sock.send(b'report;\n')
+        time.sleep(0.2)
+        sock.send(b'quit;\n')
+        output = proc.communicate(timeout=10)[0]
+
+    received = 0
+    for line in output.splitlines():
+        if line.startswith('received:'):
+            received = int(float(line.split()[-1]))
+    if not received:
+        sys.stderr.write('no result from Pd:\n' + output)
+        sys.exit(1)
+    print('bench: netreceive_udp datagrams_per_cpu_second %.0f' %
+        (received / max(cpu, 1e-6)))
+    print('bench: netreceive_udp received_fraction %.3f' % (received / sent))
+
+if __name__ == '__main__':
+    main()